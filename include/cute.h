@@ -25,6 +25,7 @@
 #include "cute_app.h"
 #include "cute_aabb_tree.h"
 #include "cute_alloc.h"
+#include "cute_arena.h"
 #include "cute_array.h"
 #include "cute_aseprite_cache.h"
 #include "cute_audio.h"
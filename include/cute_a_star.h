@@ -65,10 +65,14 @@ struct a_star_input_t
 
 /**
  * Represents the shortest path between two points as an array of 2d vectors.
- * The vectors x and y can be sized before calling `a_star` to avoid dynamic allocations.
+ * The vectors x and y can be sized before calling `a_star` to avoid dynamic allocations, or
+ * constructed with an allocator context such as `app_frame_arena()` to keep them off the heap.
  */
 struct a_star_output_t
 {
+	CUTE_INLINE a_star_output_t() { }
+	CUTE_INLINE a_star_output_t(void* user_allocator_context) : x(user_allocator_context), y(user_allocator_context) { }
+
 	array<int> x;
 	array<int> y;
 };
@@ -22,10 +22,43 @@
 #ifndef CUTE_ALLOC_H
 #define CUTE_ALLOC_H
 
+#include "cute_defines.h"
+
+#include <stdlib.h>
+
+namespace cute
+{
+
+/**
+ * Every `user_allocator_context` in CF is either NULL, meaning `malloc` and `free`, or points to an
+ * `allocator_t`. This lets allocators such as `arena_t` be plugged in at any call site. Define
+ * `CUTE_ALLOC` and `CUTE_FREE` before including CF to take over allocation entirely instead.
+ */
+struct allocator_t
+{
+	void* (*alloc_fn)(size_t size, void* udata) = NULL;
+	void (*free_fn)(void* ptr, void* udata) = NULL;
+	void* udata = NULL;
+};
+
+CUTE_INLINE void* allocator_alloc(size_t size, void* user_ctx)
+{
+	allocator_t* allocator = (allocator_t*)user_ctx;
+	return allocator ? allocator->alloc_fn(size, allocator->udata) : malloc(size);
+}
+
+CUTE_INLINE void allocator_free(void* ptr, void* user_ctx)
+{
+	allocator_t* allocator = (allocator_t*)user_ctx;
+	if (allocator) allocator->free_fn(ptr, allocator->udata);
+	else free(ptr);
+}
+
+}
+
 #if !defined(CUTE_ALLOC) && !defined(CUTE_FREE)
-#	include <stdlib.h>
-#	define CUTE_ALLOC(size, user_ctx) malloc(size)
-#	define CUTE_FREE(ptr, user_ctx) free(ptr)
+#	define CUTE_ALLOC(size, user_ctx) cute::allocator_alloc(size, user_ctx)
+#	define CUTE_FREE(ptr, user_ctx) cute::allocator_free(ptr, user_ctx)
 #endif
 
 #ifdef _MSC_VER
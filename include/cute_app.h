@@ -33,6 +33,8 @@ namespace cute
 {
 
 struct strpool_t;
+struct completion_queue_t;
+struct arena_t;
 
 #define CUTE_APP_OPTIONS_OPENGL_CONTEXT                 (1 << 0)
 #define CUTE_APP_OPTIONS_OPENGLES_CONTEXT               (1 << 1)
@@ -58,6 +60,8 @@ CUTE_API void CUTE_CALL app_do_mixing();
 CUTE_API ImGuiContext* CUTE_CALL app_init_imgui(bool no_default_font = false);
 CUTE_API sg_imgui_t* CUTE_CALL app_get_sokol_imgui();
 CUTE_API strpool_t* CUTE_CALL app_get_strpool();
+CUTE_API completion_queue_t* CUTE_CALL app_main_thread_queue();
+CUTE_API arena_t* CUTE_CALL app_frame_arena();
 
 CUTE_API error_t CUTE_CALL app_set_offscreen_buffer(int offscreen_w, int offscreen_h);
 
@@ -0,0 +1,86 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CUTE_ARENA_H
+#define CUTE_ARENA_H
+
+#include "cute_defines.h"
+
+namespace cute
+{
+
+/**
+ * A linear allocator, useful for scratch memory that all dies at once, such as temporaries built
+ * up over a single frame.
+ * 
+ * Allocations bump a pointer through large blocks, and are all released together by `arena_reset`
+ * in O(1). Blocks are kept around after a reset and reused, so an arena stops touching the heap
+ * once it has grown to fit the peak usage.
+ * 
+ * The arena can be passed as a `user_allocator_context` to any CF function or container. Calling
+ * `CUTE_FREE` on arena memory does nothing, the memory is reclaimed on the next reset instead.
+ * Arenas are not thread safe, see `arena_scratch` for one arena per thread.
+ */
+struct arena_t;
+
+/**
+ * Constructs a new arena. `block_size` is the size of each block fetched from the heap, and 0 picks
+ * a default of 64kb. Allocations bigger than `block_size` get a block of their own.
+ */
+CUTE_API arena_t* CUTE_CALL arena_make(size_t block_size = 0, void* user_allocator_context = NULL);
+
+/**
+ * Destroys an arena along with all memory allocated from it.
+ */
+CUTE_API void CUTE_CALL arena_destroy(arena_t* arena);
+
+/**
+ * Returns `size` bytes aligned to `alignment`, which must be a power of two.
+ */
+CUTE_API void* CUTE_CALL arena_alloc(arena_t* arena, size_t size, size_t alignment = 16);
+
+/**
+ * Releases all allocations at once.
+ */
+CUTE_API void CUTE_CALL arena_reset(arena_t* arena);
+
+/**
+ * Marks the current position of an arena. `arena_restore` releases everything allocated after the
+ * mark, which is handy for nesting short-lived temporaries within a longer lived arena.
+ */
+struct arena_mark_t
+{
+	void* block;
+	size_t offset;
+};
+
+CUTE_API arena_mark_t CUTE_CALL arena_save(arena_t* arena);
+CUTE_API void CUTE_CALL arena_restore(arena_t* arena, arena_mark_t mark);
+
+/**
+ * Returns an arena owned by the calling thread, created on first use and destroyed when the thread
+ * exits. It's never reset automatically, so wrap temporaries in `arena_save` and `arena_restore`.
+ */
+CUTE_API arena_t* CUTE_CALL arena_scratch();
+
+}
+
+#endif // CUTE_ARENA_H
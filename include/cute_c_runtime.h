@@ -112,4 +112,9 @@
 #	define CUTE_STRCHR strchr
 #endif
 
+#ifndef CUTE_QSORT
+#	include <stdlib.h>
+#	define CUTE_QSORT qsort
+#endif
+
 #endif // CUTE_C_RUNTIME_H
@@ -28,11 +28,19 @@
 namespace cute
 {
 
+// Producer and consumer state are kept `CUTE_SYNC_CACHELINE_SIZE` bytes apart to avoid false sharing.
 struct circular_buffer_t
 {
-	int index0 = 0;
-	int index1 = 0;
-	atomic_int_t size_left = atomic_zero();
+	// Consumer side.
+	atomic_int_t index0 = atomic_zero();
+	int cached_index1 = 0;
+	uint8_t pad0[CUTE_SYNC_CACHELINE_SIZE - sizeof(atomic_int_t) - sizeof(int)];
+
+	// Producer side.
+	atomic_int_t index1 = atomic_zero();
+	int cached_index0 = 0;
+	uint8_t pad1[CUTE_SYNC_CACHELINE_SIZE - sizeof(atomic_int_t) - sizeof(int)];
+
 	int capacity = 0;
 	uint8_t* data = NULL;
 	void* user_allocator_context = NULL;
@@ -46,6 +54,37 @@ CUTE_API void CUTE_CALL circular_buffer_reset(circular_buffer_t* buffer);
 CUTE_API int CUTE_CALL circular_buffer_push(circular_buffer_t* buffer, const void* data, int size);
 CUTE_API int CUTE_CALL circular_buffer_pull(circular_buffer_t* buffer, void* data, int size);
 
+/**
+ * Pushes up to `count` tightly packed elements of `element_size` bytes each, and publishes them to
+ * the consumer all at once. Returns the number of elements pushed.
+ */
+CUTE_API int CUTE_CALL circular_buffer_push_batch(circular_buffer_t* buffer, const void* elements, int element_size, int count);
+
+/**
+ * Pulls up to `count` elements of `element_size` bytes each. Returns the number of elements pulled.
+ */
+CUTE_API int CUTE_CALL circular_buffer_pull_batch(circular_buffer_t* buffer, void* elements, int element_size, int count);
+
+/**
+ * Zero-copy pushing. Points `span` at the free bytes up to where the buffer wraps around, and returns
+ * how many there are. Write into the span, then call `circular_buffer_commit_push` with the number
+ * of bytes written to hand them to the consumer. Producer only.
+ */
+CUTE_API int CUTE_CALL circular_buffer_reserve_push(circular_buffer_t* buffer, void** span);
+CUTE_API void CUTE_CALL circular_buffer_commit_push(circular_buffer_t* buffer, int size);
+
+/**
+ * Zero-copy pulling. Points `span` at the pushed bytes up to where the buffer wraps around, and
+ * returns how many there are. Read from the span, then call `circular_buffer_commit_pull` with the
+ * number of bytes consumed to give the space back to the producer. Consumer only.
+ */
+CUTE_API int CUTE_CALL circular_buffer_reserve_pull(circular_buffer_t* buffer, void** span);
+CUTE_API void CUTE_CALL circular_buffer_commit_pull(circular_buffer_t* buffer, int size);
+
+/**
+ * Not thread-safe, neither the producer nor the consumer may be using the buffer. Fails if
+ * `new_size_in_bytes` can not fit the bytes currently in the buffer.
+ */
 CUTE_API int CUTE_CALL circular_buffer_grow(circular_buffer_t* buffer, int new_size_in_bytes);
 
 }
@@ -39,6 +39,11 @@ using thread_id_t   = cute_thread_id_t;
 using thread_func_t = cute_thread_fn;
 using rw_lock_t     = cute_rw_lock_t;
 using threadpool_t  = cute_threadpool_t;
+using task_counter_t = cute_task_counter_t;
+using mpmc_queue_t  = cute_mpmc_queue_t;
+using spsc_ring_t   = cute_spsc_ring_t;
+using threadpool_options_t = cute_threadpool_options_t;
+using worker_stats_t = cute_worker_stats_t;
 
 CUTE_API mutex_t CUTE_CALL mutex_create();
 CUTE_API void CUTE_CALL mutex_destroy(mutex_t* mutex);
@@ -64,6 +69,7 @@ CUTE_API void CUTE_CALL thread_detach(thread_t* thread);
 CUTE_API thread_id_t CUTE_CALL thread_get_id(thread_t* thread);
 CUTE_API thread_id_t CUTE_CALL thread_id();
 CUTE_API error_t CUTE_CALL thread_wait(thread_t* thread);
+CUTE_API error_t CUTE_CALL thread_set_affinity(int core_index);
 
 CUTE_API int CUTE_CALL core_count();
 CUTE_API int CUTE_CALL cacheline_size();
@@ -84,24 +90,128 @@ CUTE_API void CUTE_CALL read_unlock(rw_lock_t* rw);
 CUTE_API void CUTE_CALL write_lock(rw_lock_t* rw);
 CUTE_API void CUTE_CALL write_unlock(rw_lock_t* rw);
 
+/**
+ * Bounded lock-free queue for any number of producer and consumer threads. Elements are copies of
+ * `element_size` bytes, and `capacity` is rounded up to a power of two. The `_many` functions move
+ * up to `count` tightly packed elements at once, and return how many were moved.
+ */
+CUTE_API mpmc_queue_t* CUTE_CALL mpmc_queue_create(int capacity, int element_size, void* user_allocator_context = NULL);
+CUTE_API void CUTE_CALL mpmc_queue_destroy(mpmc_queue_t* queue);
+CUTE_API bool CUTE_CALL mpmc_queue_try_push(mpmc_queue_t* queue, const void* element);
+CUTE_API bool CUTE_CALL mpmc_queue_try_pop(mpmc_queue_t* queue, void* element);
+CUTE_API int CUTE_CALL mpmc_queue_try_push_many(mpmc_queue_t* queue, const void* elements, int count);
+CUTE_API int CUTE_CALL mpmc_queue_try_pop_many(mpmc_queue_t* queue, void* elements, int count);
+
+/**
+ * Bounded lock-free ring for exactly one producer thread and one consumer thread. Cheaper than
+ * `mpmc_queue_t` when there is only a single thread on each side.
+ */
+CUTE_API spsc_ring_t* CUTE_CALL spsc_ring_create(int capacity, int element_size, void* user_allocator_context = NULL);
+CUTE_API void CUTE_CALL spsc_ring_destroy(spsc_ring_t* ring);
+CUTE_API bool CUTE_CALL spsc_ring_try_push(spsc_ring_t* ring, const void* element);
+CUTE_API bool CUTE_CALL spsc_ring_try_pop(spsc_ring_t* ring, void* element);
+CUTE_API int CUTE_CALL spsc_ring_try_push_many(spsc_ring_t* ring, const void* elements, int count);
+CUTE_API int CUTE_CALL spsc_ring_try_pop_many(spsc_ring_t* ring, void* elements, int count);
+
 typedef void (CUTE_CALL task_fn)(void* param);
 
 CUTE_API threadpool_t* CUTE_CALL threadpool_create(int thread_count, void* user_allocator_context = NULL);
 CUTE_API void CUTE_CALL threadpool_destroy(threadpool_t* pool);
-CUTE_API void CUTE_CALL threadpool_add_task(threadpool_t* pool, task_fn* task, void* param);
+CUTE_API void CUTE_CALL threadpool_add_task(threadpool_t* pool, task_fn* task, void* param, task_counter_t* counter = NULL);
 CUTE_API void CUTE_CALL threadpool_kick_and_wait(threadpool_t* pool);
 CUTE_API void CUTE_CALL threadpool_kick(threadpool_t* pool);
 
+/**
+ * Counters track groups of tasks. A counter must be zero-initialized before its first use, for
+ * example `task_counter_t counter = { };`, and can be reused once it's back to zero.
+ *
+ * `threadpool_add_task` increments `counter` (when not NULL), and the task decrements it once done.
+ * `threadpool_add_continuation` adds `task` to the pool once `dependency` reaches zero.
+ * `threadpool_wait_counter` helps perform tasks until `counter` reaches zero.
+ */
+CUTE_API void CUTE_CALL threadpool_add_continuation(threadpool_t* pool, task_counter_t* dependency, task_fn* task, void* param, task_counter_t* counter = NULL);
+CUTE_API void CUTE_CALL threadpool_wait_counter(threadpool_t* pool, task_counter_t* counter);
+CUTE_API int CUTE_CALL threadpool_thread_count(threadpool_t* pool);
+
+/**
+ * Creates a pool with named and optionally pinned worker threads, see `cute_threadpool_options_t`.
+ */
+CUTE_API threadpool_t* CUTE_CALL threadpool_create(int thread_count, const threadpool_options_t& options, void* user_allocator_context = NULL);
+
+/**
+ * Utilization statistics per worker, for `worker_index` from 0 to `threadpool_thread_count` - 1.
+ * Passing the thread count instead gives the tasks run by threads helping out while waiting. Busy
+ * and idle times lag slightly behind the task counts, see `cute_threadpool_get_stats`.
+ */
+CUTE_API worker_stats_t CUTE_CALL threadpool_get_stats(threadpool_t* pool, int worker_index);
+CUTE_API void CUTE_CALL threadpool_reset_stats(threadpool_t* pool);
+
+typedef void (CUTE_CALL parallel_for_fn)(int begin, int end, void* udata);
+typedef void (CUTE_CALL parallel_reduce_fn)(int begin, int end, void* partial, void* udata);
+typedef void (CUTE_CALL parallel_combine_fn)(void* result, const void* partial, void* udata);
+
+/**
+ * Calls `fn` over [begin, end), split into chunks of `grain` indices (the last chunk may be smaller).
+ * Chunks are spread over the pool's worker threads, and the calling thread works on chunks too.
+ * Returns once every chunk has finished. Pass 0 for `grain` to pick a chunk size automatically.
+ * With a NULL `pool`, or when the range fits in a single chunk, `fn` runs on the calling thread.
+ */
+CUTE_API void CUTE_CALL parallel_for(threadpool_t* pool, int begin, int end, int grain, parallel_for_fn* fn, void* udata = NULL);
+
+/**
+ * Like `parallel_for`, but each chunk accumulates into its own `partial` result of `result_size`
+ * bytes, and the partials are then merged into `result` with `combine`. `result` must hold the
+ * identity value on entry (such as 0 for sums), as each partial starts out as a copy of it. Partials
+ * are always combined on the calling thread in chunk order, so the result doesn't depend on timing.
+ * Partials are allocated with the `user_allocator_context` given to `threadpool_create`.
+ */
+CUTE_API void CUTE_CALL parallel_reduce(threadpool_t* pool, int begin, int end, int grain, void* result, size_t result_size, parallel_reduce_fn* fn, parallel_combine_fn* combine, void* udata = NULL);
+
 typedef void (CUTE_CALL promise_fn)(error_t status, void* param, void* promise_udata);
 
+/**
+ * A lock-free queue of finished promises, for running promise callbacks on one specific thread
+ * (usually the main thread) instead of on whichever thread finished the work. Any number of threads
+ * may post, and a single thread drains. See `app_main_thread_queue`.
+ */
+struct completion_queue_t;
+
+CUTE_API completion_queue_t* CUTE_CALL completion_queue_create(void* user_allocator_context = NULL);
+
+/**
+ * Runs any callbacks still in the queue, then frees it. Make sure no thread will post to the queue
+ * anymore before calling this.
+ */
+CUTE_API void CUTE_CALL completion_queue_destroy(completion_queue_t* queue);
+
+/**
+ * Queues up `callback` to be called with `status`, `param` and `promise_udata` during the next
+ * `completion_queue_drain`. Safe to call from any thread.
+ */
+CUTE_API void CUTE_CALL completion_queue_post(completion_queue_t* queue, promise_fn* callback, void* promise_udata, error_t status, void* param);
+
+/**
+ * Calls all callbacks posted so far on the calling thread, in the order they were posted. Callbacks
+ * posted while draining wait for the next drain. Returns the number of callbacks called.
+ */
+CUTE_API int CUTE_CALL completion_queue_drain(completion_queue_t* queue);
+
 struct promise_t
 {
 	CUTE_INLINE promise_t () { }
-	CUTE_INLINE promise_t (promise_fn* callback, void* promise_udata = NULL) : callback(callback), promise_udata(promise_udata) { }
-	CUTE_INLINE void invoke(error_t status, void* param) { callback(status, param, promise_udata); }
+	CUTE_INLINE promise_t (promise_fn* callback, void* promise_udata = NULL, completion_queue_t* deliver_to = NULL) : callback(callback), promise_udata(promise_udata), deliver_to(deliver_to) { }
+	CUTE_INLINE void invoke(error_t status, void* param)
+	{
+		if (deliver_to) completion_queue_post(deliver_to, callback, promise_udata, status, param);
+		else callback(status, param, promise_udata);
+	}
 
 	promise_fn* callback = NULL;
 	void* promise_udata = NULL;
+
+	// When set the callback doesn't run on the invoking thread, but is posted here instead. Pass in
+	// `app_main_thread_queue()` to have the callback run on the main thread during `app_update`.
+	completion_queue_t* deliver_to = NULL;
 };
 
 }
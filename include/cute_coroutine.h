@@ -24,6 +24,7 @@
 
 #include "cute_defines.h"
 #include "cute_error.h"
+#include "cute_concurrency.h"
 
 namespace cute
 {
@@ -53,6 +54,19 @@ namespace cute
 	CUTE_API size_t CUTE_CALL coroutine_space_remaining(coroutine_t* co);
 
 	CUTE_API coroutine_t* CUTE_CALL coroutine_currently_running();
+
+	CUTE_API error_t CUTE_CALL coroutine_await(coroutine_t* co, threadpool_t* pool, task_counter_t* counter);
+	CUTE_API error_t CUTE_CALL coroutine_await_read_entire_file(coroutine_t* co, threadpool_t* pool, const char* virtual_path, void** data_ptr, size_t* size = NULL, void* user_allocator_context = NULL);
+
+	struct coroutine_scheduler_t;
+
+	CUTE_API coroutine_scheduler_t* CUTE_CALL coroutine_scheduler_make(int stack_size = 0, void* user_allocator_context = NULL);
+	CUTE_API void CUTE_CALL coroutine_scheduler_destroy(coroutine_scheduler_t* scheduler);
+	CUTE_API coroutine_t* CUTE_CALL coroutine_scheduler_spawn(coroutine_scheduler_t* scheduler, coroutine_fn* fn, void* udata = NULL);
+	CUTE_API void CUTE_CALL coroutine_scheduler_update(coroutine_scheduler_t* scheduler, float dt);
+	CUTE_API int CUTE_CALL coroutine_scheduler_count(coroutine_scheduler_t* scheduler);
+	CUTE_API int CUTE_CALL coroutine_scheduler_waiting_count(coroutine_scheduler_t* scheduler);
+	CUTE_API int CUTE_CALL coroutine_scheduler_awaiting_count(coroutine_scheduler_t* scheduler);
 }
 
 #endif // CUTE_COROUTINE_H
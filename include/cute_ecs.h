@@ -27,6 +27,7 @@
 #include "cute_array.h"
 #include "cute_typeless_array.h"
 #include "cute_dictionary.h"
+#include "cute_concurrency.h"
 
 namespace cute
 {
@@ -45,6 +46,13 @@ struct entity_t
 
 static constexpr entity_t INVALID_ENTITY = { CUTE_INVALID_HANDLE };
 
+/**
+ * Integer id for a component type, handed out by `ecs_component_end`. Looking up components by id
+ * avoids hashing component type strings, and is the recommended way to fetch components in hot loops.
+ */
+typedef int component_id_t;
+static constexpr component_id_t INVALID_COMPONENT_ID = -1;
+
 CUTE_API void CUTE_CALL ecs_entity_begin();
 CUTE_API void CUTE_CALL ecs_entity_end();
 CUTE_API void CUTE_CALL ecs_entity_set_name(const char* entity_type);
@@ -56,9 +64,90 @@ CUTE_API bool CUTE_CALL entity_is_valid(entity_t entity);
 CUTE_API bool CUTE_CALL entity_is_type(entity_t entity, const char* entity_type);
 CUTE_API const char* CUTE_CALL entity_get_type_string(entity_t entity);
 CUTE_API bool CUTE_CALL entity_has_component(entity_t entity, const char* component_type);
+CUTE_API bool CUTE_CALL entity_has_component(entity_t entity, component_id_t component_id);
 CUTE_API void* CUTE_CALL entity_get_component(entity_t entity, const char* component_type);
+CUTE_API void* CUTE_CALL entity_get_component(entity_t entity, component_id_t component_id);
 CUTE_API void CUTE_CALL entity_destroy(entity_t entity);
+
+/**
+ * Delayed functions record structural changes to be played back later, at the end of `ecs_run_systems`
+ * or upon calling `ecs_flush_delayed_commands`. They can be safely called from within systems, even
+ * systems running in parallel, without any locks. Playback order is deterministic: commands are played
+ * back in system registration order, then by collection and range of entities, then in the order
+ * they were recorded.
+ *
+ * `entity_delayed_make` returns a stand-in entity, only valid to pass to other delayed functions
+ * before playback.
+ */
+CUTE_API entity_t CUTE_CALL entity_delayed_make(const char* entity_type);
 CUTE_API void CUTE_CALL entity_delayed_destroy(entity_t entity);
+CUTE_API void CUTE_CALL entity_delayed_set_component(entity_t entity, component_id_t component_id, const void* component, size_t size);
+
+/**
+ * Plays back all delayed commands. Must be called from the main thread, and not from within a system.
+ */
+CUTE_API void CUTE_CALL ecs_flush_delayed_commands();
+
+/**
+ * Returns a component just like `entity_get_component`, and records a write to it for change tracking.
+ */
+CUTE_API void* CUTE_CALL entity_get_component_for_write(entity_t entity, component_id_t component_id);
+
+/**
+ * Records a write to a component for change tracking, see `ecs_component_set_optional_change_tracking`.
+ */
+CUTE_API void CUTE_CALL ecs_mark_dirty(entity_t entity, component_id_t component_id);
+CUTE_API void CUTE_CALL ecs_mark_dirty(entity_t entity, const char* component_type);
+
+/**
+ * Returns true if the component was written after `change_tick`, a value previously returned
+ * from `ecs_get_change_tick`.
+ */
+CUTE_API bool CUTE_CALL entity_component_changed_since(entity_t entity, component_id_t component_id, uint64_t change_tick);
+
+/**
+ * Returns the current change tick. It advances before each batch of systems in `ecs_run_systems`,
+ * and once more when all systems are done.
+ */
+CUTE_API uint64_t CUTE_CALL ecs_get_change_tick();
+
+/**
+ * Makes `count` entities of type `entity_type`, writing them to `entities_out`. Faster than calling
+ * `entity_make` in a loop, as all storage is reserved up front and components are constructed
+ * one table at a time.
+ */
+CUTE_API error_t CUTE_CALL entity_make_many(const char* entity_type, int count, entity_t* entities_out);
+
+/**
+ * Destroys `count` entities at once. Invalid entities are skipped. Faster than calling `entity_destroy`
+ * in a loop, as each component table is compacted in a single pass.
+ *
+ * Component cleanup functions are called for all entities before any are removed. As with
+ * `entity_destroy`, they may destroy other entities. An entity in the batch that a cleanup function
+ * destroys early is skipped from then on.
+ */
+CUTE_API void CUTE_CALL entity_destroy_many(const entity_t* entities, int count);
+
+/**
+ * Returns a sort key for `entity`, such as the Morton code of its position, for `ecs_sort_collection`.
+ */
+typedef uint64_t (ecs_sort_key_fn)(entity_t entity, void* udata);
+
+/**
+ * Reorders the entities of type `entity_type` by ascending key, so systems visit their components in
+ * that order. Entities with equal keys keep their relative order. Every component table is permuted
+ * in a single pass, and entity handles remain valid. Must not be called from within a system.
+ */
+CUTE_API error_t CUTE_CALL ecs_sort_collection(const char* entity_type, ecs_sort_key_fn* key_fn, void* udata = NULL);
+
+/**
+ * Budgeted variant of `ecs_sort_collection`, meant to be called once per frame. Sorts one window of
+ * up to `budget` entities, then advances the window by half its size, wrapping around at the end of
+ * the collection. Repeated calls gradually sort the whole collection, and keep it sorted as keys change.
+ *
+ * Returns the number of entities moved, or -1 if `entity_type` is not valid.
+ */
+CUTE_API int CUTE_CALL ecs_sort_collection_incremental(const char* entity_type, ecs_sort_key_fn* key_fn, void* udata = NULL, int budget = 256);
 
 /**
  * `kv` needs to be in `KV_STATE_READ` mode.
@@ -71,19 +160,158 @@ CUTE_API error_t CUTE_CALL ecs_load_entities(kv_t* kv, array<entity_t>* entities
 CUTE_API error_t CUTE_CALL ecs_save_entities(const array<entity_t>& entities, kv_t* kv);
 CUTE_API error_t CUTE_CALL ecs_save_entities(const array<entity_t>& entities);
 
+/**
+ * Saves every entity into a binary snapshot. The snapshot is allocated with `CUTE_ALLOC` using
+ * `user_allocator_context`, and must be freed with `CUTE_FREE`.
+ *
+ * Component tables and handle tables are copied as-is, so a snapshot is much faster to save and
+ * load than `ecs_save_entities`. Components registered with `ecs_component_set_optional_pod` are
+ * stored as raw bytes. All other components are stored as text through their serializer, and saving
+ * fails if a component has neither.
+ */
+CUTE_API error_t CUTE_CALL ecs_save_snapshot(void** snapshot_out, size_t* size_out, void* user_allocator_context = NULL);
+
+/**
+ * Replaces every entity with the entities from a snapshot made by `ecs_save_snapshot`. Entity handles
+ * are restored exactly, so handles stored within components remain valid. `snapshot` is only read
+ * from, and may point to a memory mapped file.
+ *
+ * The same entity types must be registered, in the same order, as when the snapshot was saved. Raw
+ * components are validated against their size and layout version, and loading fails upon mismatch.
+ * Components added to an entity type since the snapshot was saved are constructed from the schema.
+ *
+ * Everything is loaded into scratch tables first, so upon failure the current entities are left
+ * untouched. Serializers run before the loaded entities replace the current ones, so they should not
+ * look up other entities.
+ */
+CUTE_API error_t CUTE_CALL ecs_load_snapshot(const void* snapshot, size_t size);
+
 //--------------------------------------------------------------------------------------------------
 // Component
 
 typedef error_t (component_serialize_fn)(kv_t* kv, bool reading, entity_t entity, void* component, void* udata);
 typedef void (component_cleanup_fn)(entity_t entity, void* component, void* udata);
+typedef void (component_post_construct_fn)(entity_t entity, void* component, void* udata);
 
 CUTE_API void CUTE_CALL ecs_component_begin();
-CUTE_API void CUTE_CALL ecs_component_end();
+CUTE_API component_id_t CUTE_CALL ecs_component_end();
 CUTE_API void CUTE_CALL ecs_component_set_name(const char* name);
 CUTE_API void CUTE_CALL ecs_component_set_size(size_t size);
+
+/**
+ * Aligns every component of this type to `alignment` bytes, a power of two, e.g. 16 or 32 for
+ * components holding SIMD types. The component's size is rounded up to a multiple of `alignment`.
+ * Component tables always have a capacity that is a multiple of 256 components, so SIMD loops may
+ * safely process whole vectors past the last component, up to the table's capacity.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_alignment(size_t alignment);
 CUTE_API void CUTE_CALL ecs_component_set_optional_serializer(component_serialize_fn* serializer_fn, void* udata = NULL);
 CUTE_API void CUTE_CALL ecs_component_set_optional_cleanup(component_cleanup_fn* cleanup_fn, void* udata = NULL);
 
+/**
+ * Optionally writes the component's id to `*id_out` when `ecs_component_end` is called.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_optional_id_out(component_id_t* id_out);
+
+/**
+ * Optionally bakes this component's default value once per entity type, when the entity type is
+ * registered. `entity_make` then copies the baked bytes instead of running the serializer against
+ * the entity schema (and its inheritence chain) for every new entity.
+ *
+ * Only turn this on for components whose serialized defaults do not depend on the entity, and that
+ * can be safely copied with `memcpy` (e.g. no owned pointers). The serializer is called once with
+ * `INVALID_ENTITY` to produce the prototype.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_optional_prototype(bool bake_prototype = true);
+
+/**
+ * Optionally marks this component as plain old data, meaning it can be saved and loaded with `memcpy`
+ * (e.g. no owned pointers). Snapshots store plain old data components as raw bytes instead of going
+ * through the serializer.
+ *
+ * You must bump `layout_version` whenever the layout of the component changes without changing its
+ * size, e.g. fields are reordered or change type. Snapshots only check the component's name, size and
+ * `layout_version`, so otherwise old snapshots are loaded into the new layout byte for byte.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_optional_pod(bool is_pod = true, uint32_t layout_version = 0);
+
+/**
+ * Optionally tracks changes to this component. Each component records the change tick of its most
+ * recent write, so systems can visit only the components that changed (see `ecs_arrays_changed`).
+ *
+ * Writes are recorded by `entity_get_component_for_write`, `ecs_mark_dirty` and `ecs_arrays_mark_dirty`.
+ * Newly made entities count as changed. Writes through plain pointers are not seen. Untracked
+ * components always report as changed.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_optional_change_tracking(bool track_changes = true);
+
+/**
+ * Optionally called on each newly constructed component, after its default value is loaded (or
+ * copied from the prototype). Useful for patching up entity-specific values in baked components.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_optional_post_construct(component_post_construct_fn* post_construct_fn, void* udata = NULL);
+
+/**
+ * Returns the id of a registered component type, or `INVALID_COMPONENT_ID`. The id can be stored
+ * and used for fast component lookups later.
+ */
+CUTE_API component_id_t CUTE_CALL ecs_component_get_id(const char* component_type);
+
+/**
+ * Returns the size set by `ecs_component_set_size` for a registered component type, or zero.
+ */
+CUTE_API size_t CUTE_CALL ecs_component_get_size(component_id_t component_id);
+
+/**
+ * Storage for the id of component type `T`, filled in by `ecs_component_set_type<T>`.
+ */
+template <typename T>
+CUTE_INLINE component_id_t& ecs_component_id()
+{
+	static component_id_t id = INVALID_COMPONENT_ID;
+	return id;
+}
+
+/**
+ * Sets the component's size to `sizeof(T)` and its alignment to `alignof(T)`, and binds `T` to the
+ * component's id. Once bound, the typed functions such as `entity_get_component<T>` may be used.
+ * Call this in between `ecs_component_begin` and `ecs_component_end`.
+ */
+template <typename T>
+CUTE_INLINE void ecs_component_set_type()
+{
+	ecs_component_set_size(sizeof(T));
+	ecs_component_set_alignment(alignof(T));
+	ecs_component_set_optional_id_out(&ecs_component_id<T>());
+}
+
+template <typename T>
+CUTE_INLINE T* entity_get_component(entity_t entity)
+{
+	CUTE_ASSERT(ecs_component_id<T>() != INVALID_COMPONENT_ID);
+	return (T*)entity_get_component(entity, ecs_component_id<T>());
+}
+
+template <typename T>
+CUTE_INLINE bool entity_has_component(entity_t entity)
+{
+	return entity_has_component(entity, ecs_component_id<T>());
+}
+
+template <typename T>
+CUTE_INLINE void entity_delayed_set_component(entity_t entity, const T& component)
+{
+	CUTE_ASSERT(ecs_component_id<T>() != INVALID_COMPONENT_ID);
+	entity_delayed_set_component(entity, ecs_component_id<T>(), &component, sizeof(T));
+}
+
+template <typename T>
+CUTE_INLINE T* entity_get_component_for_write(entity_t entity)
+{
+	CUTE_ASSERT(ecs_component_id<T>() != INVALID_COMPONENT_ID);
+	return (T*)entity_get_component_for_write(entity, ecs_component_id<T>());
+}
+
 //--------------------------------------------------------------------------------------------------
 // System
 
@@ -91,19 +319,193 @@ struct ecs_arrays_t;
 
 typedef void (system_update_fn)(float dt, ecs_arrays_t* arrays, int count, void* udata);
 CUTE_API void* CUTE_CALL ecs_arrays_find_components(ecs_arrays_t* arrays, const char* component_type);
+CUTE_API void* CUTE_CALL ecs_arrays_find_components(ecs_arrays_t* arrays, component_id_t component_id);
 CUTE_API entity_t* CUTE_CALL ecs_arrays_get_entities(ecs_arrays_t* arrays);
 
+/**
+ * Returns true if any component of the type within `arrays` changed since the current system last ran.
+ * Useful for skipping an entire collection. See `ecs_component_set_optional_change_tracking`.
+ */
+CUTE_API bool CUTE_CALL ecs_arrays_changed(ecs_arrays_t* arrays, component_id_t component_id);
+
+/**
+ * Returns true if the component at `index` changed since the current system last ran.
+ */
+CUTE_API bool CUTE_CALL ecs_arrays_changed(ecs_arrays_t* arrays, component_id_t component_id, int index);
+
+/**
+ * Records a write to the component at `index`.
+ */
+CUTE_API void CUTE_CALL ecs_arrays_mark_dirty(ecs_arrays_t* arrays, component_id_t component_id, int index);
+
+/**
+ * A typed pointer and count into one column of an `ecs_arrays_t`. Supports range-based for loops.
+ */
+template <typename T>
+struct ecs_span_t
+{
+	T* data = NULL;
+	int count = 0;
+
+	CUTE_INLINE T& operator[](int index) { CUTE_ASSERT(index >= 0 && index < count); return data[index]; }
+	CUTE_INLINE const T& operator[](int index) const { CUTE_ASSERT(index >= 0 && index < count); return data[index]; }
+	CUTE_INLINE T* begin() const { return data; }
+	CUTE_INLINE T* end() const { return data + count; }
+};
+
+namespace ecs_internal
+{
+template <typename T, typename... Ts> struct index_of;
+template <typename T, typename... Ts> struct index_of<T, T, Ts...> { enum { value = 0 }; };
+template <typename T, typename U, typename... Ts> struct index_of<T, U, Ts...> { enum { value = 1 + index_of<T, Ts...>::value }; };
+
+template <typename T, typename... Ts> struct contains { enum { value = 0 }; };
+template <typename T, typename... Ts> struct contains<T, T, Ts...> { enum { value = 1 }; };
+template <typename T, typename U, typename... Ts> struct contains<T, U, Ts...> { enum { value = contains<T, Ts...>::value }; };
+
+template <typename... Ts> struct is_unique { enum { value = 1 }; };
+template <typename T, typename... Ts> struct is_unique<T, Ts...> { enum { value = !contains<T, Ts...>::value && is_unique<Ts...>::value }; };
+}
+
+/**
+ * Typed access to the components of an `ecs_arrays_t`, for use within a `system_update_fn`. Each
+ * column is looked up once by component id when the view is constructed, instead of by string on
+ * each call to `ecs_arrays_find_components`. Each of `Ts` must be bound with `ecs_component_set_type`.
+ *
+ * void update_octorok(float dt, ecs_arrays_t* arrays, int count, void* udata)
+ * {
+ * 	ecs_view<transform_t, octorok_t> view(arrays, count);
+ * 	for (int i = 0; i < view.count; ++i) {
+ * 		transform_t& transform = view.get<transform_t>()[i];
+ * 		octorok_t& octorok = view.get<octorok_t>()[i];
+ * 		// ...
+ * 	}
+ * }
+ *
+ * Components missing from the collection (e.g. ones not required by the system) come back as empty spans.
+ */
+template <typename... Ts>
+struct ecs_view
+{
+	static_assert(sizeof...(Ts) > 0, "An ecs_view needs at least one component type.");
+	static_assert(ecs_internal::is_unique<Ts...>::value, "Each component type may appear in an ecs_view only once.");
+
+	ecs_arrays_t* arrays = NULL;
+	entity_t* entities = NULL;
+	int count = 0;
+
+	CUTE_INLINE ecs_view(ecs_arrays_t* arrays, int count)
+		: arrays(arrays)
+		, entities(ecs_arrays_get_entities(arrays))
+		, count(count)
+	{
+		component_id_t ids[] = { ecs_component_id<Ts>()... };
+		size_t sizes[] = { sizeof(Ts)... };
+		for (int i = 0; i < (int)sizeof...(Ts); ++i) {
+			CUTE_ASSERT(ids[i] != INVALID_COMPONENT_ID);
+			CUTE_ASSERT(ecs_component_get_size(ids[i]) == sizes[i]);
+			m_columns[i] = ecs_arrays_find_components(arrays, ids[i]);
+		}
+	}
+
+	template <typename T>
+	CUTE_INLINE ecs_span_t<T> get() const
+	{
+		void* column = m_columns[ecs_internal::index_of<T, Ts...>::value];
+		ecs_span_t<T> span;
+		span.data = (T*)column;
+		span.count = column ? count : 0;
+		return span;
+	}
+
+	/**
+	 * Records a write to the component `T` at `index`. See `ecs_arrays_mark_dirty`.
+	 */
+	template <typename T>
+	CUTE_INLINE void mark_dirty(int index) const
+	{
+		ecs_arrays_mark_dirty(arrays, ecs_component_id<T>(), index);
+	}
+
+	/**
+	 * Returns true if the component `T` at `index` changed since the current system last ran.
+	 */
+	template <typename T>
+	CUTE_INLINE bool changed(int index) const
+	{
+		return ecs_arrays_changed(arrays, ecs_component_id<T>(), index);
+	}
+
+private:
+	void* m_columns[sizeof...(Ts)];
+};
+
 CUTE_API void CUTE_CALL ecs_system_begin();
 CUTE_API void CUTE_CALL ecs_system_end();
 CUTE_API void CUTE_CALL ecs_system_set_name(const char* name);
 CUTE_API void CUTE_CALL ecs_system_set_update(system_update_fn* update_fn);
 CUTE_API void CUTE_CALL ecs_system_require_component(const char* component_type);
+CUTE_API void CUTE_CALL ecs_system_require_component_read(const char* component_type);
+CUTE_API void CUTE_CALL ecs_system_require_component_write(const char* component_type);
 CUTE_API void CUTE_CALL ecs_system_set_optional_pre_update(void (*pre_update_fn)(float dt, void* udata));
 CUTE_API void CUTE_CALL ecs_system_set_optional_post_update(void (*post_update_fn)(float dt, void* udata));
 CUTE_API void CUTE_CALL ecs_system_set_optional_update_udata(void* udata);
 
+/**
+ * Opts the system into splitting each matching entity collection into ranges of `grain_size` entities.
+ * The ranges are updated at the same time on the world's threadpool, each with its own `ecs_arrays_t`.
+ * The update function must be safe to call on different ranges at once. Pass 0 to turn this off.
+ */
+CUTE_API void CUTE_CALL ecs_system_set_optional_parallel_for(int grain_size = 1024);
+
+/**
+ * Runs all systems in the order they were registered. Systems that declared their component access
+ * with `ecs_system_require_component_read` or `ecs_system_require_component_write` are allowed to
+ * run at the same time as one another on the world's threadpool, so long as neither writes to a
+ * component the other reads or writes. Systems that did not declare access always run alone.
+ */
 CUTE_API void CUTE_CALL ecs_run_systems(float dt);
 
+//--------------------------------------------------------------------------------------------------
+// World
+
+/**
+ * A world holds its own set of registered components, entity types, systems and entities. Every ECS
+ * function operates on the calling thread's current world, which is the app's default world unless
+ * changed with `ecs_set_world`. Different worlds may be used on different threads at the same time.
+ * This is useful for e.g. hosting many independent game simulations within a single server process.
+ *
+ * Components, entity types and systems must be registered separately in each world. Register
+ * components bound with `ecs_component_set_type` in the same order in every world, as typed
+ * functions such as `entity_get_component<T>` share a single id per type.
+ */
+struct ecs_world_t;
+
+/**
+ * Makes a new, empty world. Parallel systems (see `ecs_run_systems`) run on `threadpool`, or one at a
+ * time on the calling thread when `threadpool` is NULL. Worlds running at the same time may share a
+ * threadpool.
+ */
+CUTE_API ecs_world_t* CUTE_CALL ecs_world_make(threadpool_t* threadpool = NULL, void* user_allocator_context = NULL);
+
+/**
+ * Destroys a world made by `ecs_world_make`, along with all of its entities. Component cleanup
+ * functions are not called.
+ */
+CUTE_API void CUTE_CALL ecs_world_destroy(ecs_world_t* world);
+
+/**
+ * Sets the current world for the calling thread. Pass NULL for the app's default world.
+ */
+CUTE_API void CUTE_CALL ecs_set_world(ecs_world_t* world);
+CUTE_API ecs_world_t* CUTE_CALL ecs_get_world();
+
+/**
+ * Runs all systems of `world`, just like `ecs_run_systems`. The current world of the calling thread
+ * is restored afterwards.
+ */
+CUTE_API void CUTE_CALL ecs_run_systems(ecs_world_t* world, float dt);
+
 //--------------------------------------------------------------------------------------------------
 // Introspection
 
@@ -113,6 +515,58 @@ CUTE_API array<const char*> CUTE_CALL ecs_get_component_list();
 CUTE_API array<const char*> CUTE_CALL ecs_get_system_list();
 CUTE_API array<const char*> CUTE_CALL ecs_get_component_list_for_entity_type(const char* entity_type);
 
+//--------------------------------------------------------------------------------------------------
+// Stats
+
+struct ecs_system_stats_t
+{
+	const char* name; // May be NULL if the system was not given a name.
+	float pre_update_seconds;
+	float update_seconds;
+	float post_update_seconds;
+	int collections_updated;
+	int entities_updated;
+};
+
+struct ecs_component_table_stats_t
+{
+	const char* entity_type;
+	const char* component_type;
+	int count;
+	int capacity;
+	size_t bytes_used;
+	size_t bytes_reserved;
+};
+
+struct ecs_entity_type_stats_t
+{
+	const char* entity_type;
+	int entity_count;
+	int handle_capacity; // Number of slots within the entity handle table.
+	int handles_free;
+};
+
+/**
+ * Fills `stats_out` with one entry per system, in registration order, measured during the most
+ * recent call to `ecs_run_systems`. All times are wall-clock.
+ */
+CUTE_API void CUTE_CALL ecs_get_system_stats(array<ecs_system_stats_t>* stats_out);
+
+/**
+ * Fills `stats_out` with the memory used by every component table, for every entity type.
+ */
+CUTE_API void CUTE_CALL ecs_get_component_table_stats(array<ecs_component_table_stats_t>* stats_out);
+
+/**
+ * Fills `stats_out` with entity counts and handle table occupancy for every entity type.
+ */
+CUTE_API void CUTE_CALL ecs_get_entity_type_stats(array<ecs_entity_type_stats_t>* stats_out);
+
+/**
+ * Draws all of the above stats in a Dear ImGui window. Does nothing unless `app_init_imgui` was called.
+ */
+CUTE_API void CUTE_CALL ecs_imgui_stats_window(bool* p_open = NULL);
+
 }
 
 #endif // CUTE_ECS_H
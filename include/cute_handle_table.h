@@ -23,6 +23,7 @@
 #define CUTE_HANDLE_TABLE_H
 
 #include "cute_defines.h"
+#include "cute_error.h"
 
 namespace cute
 {
@@ -42,6 +43,25 @@ CUTE_API void CUTE_CALL handle_allocator_update_index(handle_allocator_t* table,
 CUTE_API void CUTE_CALL handle_allocator_free(handle_allocator_t* table, handle_t handle);
 CUTE_API int CUTE_CALL handle_allocator_is_handle_valid(handle_allocator_t* table, handle_t handle);
 
+/**
+ * Makes sure at least `count` handles can be allocated without growing the table.
+ */
+CUTE_API void CUTE_CALL handle_allocator_reserve(handle_allocator_t* table, int count);
+
+/**
+ * Returns the total number of slots within the table, and how many of them are free.
+ */
+CUTE_API int CUTE_CALL handle_allocator_capacity(handle_allocator_t* table);
+CUTE_API int CUTE_CALL handle_allocator_free_count(handle_allocator_t* table);
+
+/**
+ * Saves the entire state of the table to `buffer`, which must be at least `handle_allocator_save_size`
+ * bytes. Loading the state back restores every handle exactly, including the generations of free slots.
+ */
+CUTE_API size_t CUTE_CALL handle_allocator_save_size(handle_allocator_t* table);
+CUTE_API void CUTE_CALL handle_allocator_save(handle_allocator_t* table, void* buffer);
+CUTE_API error_t CUTE_CALL handle_allocator_load(handle_allocator_t* table, const void* buffer, size_t size);
+
 // -------------------------------------------------------------------------------------------------
 
 struct handle_table_t
@@ -92,6 +112,11 @@ struct handle_table_t
 		return !!handle_allocator_is_handle_valid(m_alloc, handle);
 	}
 
+	CUTE_INLINE void reserve(int count)
+	{
+		handle_allocator_reserve(m_alloc, count);
+	}
+
 	handle_allocator_t* m_alloc;
 };
 
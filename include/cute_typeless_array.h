@@ -41,6 +41,13 @@ struct typeless_array
 	explicit typeless_array(size_t element_size, int capacity, void* user_allocator_context);
 	~typeless_array();
 
+	/**
+	 * Aligns the start of the array to `alignment` bytes, which must be a power of two. Each element
+	 * is aligned as well so long as `m_element_size` is a multiple of `alignment`. Call before any
+	 * elements are added.
+	 */
+	void set_alignment(size_t alignment);
+
 	void* add();
 	void* add(const void* item);
 	void* insert(int index);
@@ -69,6 +76,7 @@ struct typeless_array
 	const void* data() const;
 
 	size_t m_element_size = 0;
+	size_t m_alignment = 0; // Zero for the default alignment of `CUTE_ALLOC`.
 	int m_capacity = 0;
 	int m_count = 0;
 	void* m_items = NULL;
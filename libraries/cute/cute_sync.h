@@ -23,6 +23,8 @@
 			* semaphore
 			* read/write lock
 			* thread pool
+			* lock-free multi-producer/multi-consumer queue
+			* lock-free single-producer/single-consumer ring
 
 		Here are some slides I wrote for those interested in learning prequisite
 		knowledge for utilizing this header:
@@ -47,10 +49,21 @@
 
 		1.0  (05/31/2018) initial release
 		1.01 (08/25/2019) Windows and pthreads port
+		1.02 (10/17/2026) Work-stealing threadpool, fixed atomic cas/set for Windows/pthreads
+		                  task counters and continuations
+		                  MPMC queue and SPSC ring
+		                  worker names, core pinning and utilization stats
 */
 
 #if !defined(CUTE_SYNC_H)
 
+#if !defined(CUTE_SYNC_CACHELINE_SIZE)
+	// Sized generously to try and avoid guessing "too low". Too small would incur serious overhead
+	// inside of `cute_threadpool_t` as false sharing would run amok between pooled threads. Also used
+	// to pad data shared between threads outside of this header, such as `circular_buffer_t`.
+	#define CUTE_SYNC_CACHELINE_SIZE 128
+#endif
+
 typedef union cute_atomic_int_t cute_atomic_int_t;
 typedef union cute_mutex_t cute_mutex_t;
 typedef union cute_cv_t cute_cv_t;
@@ -145,6 +158,13 @@ void cute_thread_detach(cute_thread_t* thread);
 cute_thread_id_t cute_thread_get_id(cute_thread_t* thread);
 cute_thread_id_t cute_thread_id();
 
+/**
+ * Pins the calling thread to the core `core_index`, from 0 to `cute_core_count() - 1`, so the
+ * scheduler stops migrating it between cores. Returns 1 on success, or 0 on failure or on platforms
+ * without support for pinning (Apple platforms, or Linux without _GNU_SOURCE).
+ */
+int cute_thread_set_affinity(int core_index);
+
 /**
  * Waits until the thread exits (unless it has already exited), and returns the thread's
  * return code. Unless the thread was detached, this function must be used, otherwise it
@@ -250,6 +270,9 @@ void cute_write_unlock(cute_rw_lock_t* rw);
 void cute_rw_lock_destroy(cute_rw_lock_t* rw);
 
 typedef struct cute_threadpool_t cute_threadpool_t;
+typedef struct cute_task_counter_t cute_task_counter_t;
+typedef struct cute_threadpool_options_t cute_threadpool_options_t;
+typedef struct cute_worker_stats_t cute_worker_stats_t;
 
 /**
  * Constructs a threadpool containing `thread_count`, useful for implementing job/task systems.
@@ -264,15 +287,57 @@ typedef struct cute_threadpool_t cute_threadpool_t;
 cute_threadpool_t* cute_threadpool_create(int thread_count, void* mem_ctx);
 
 /**
- * Atomically adds a single task to the internal task stack (FIFO order). The task is represented
- * as a function pointer `func`, which does work. The `param` is passed to the `func` when the
- * task is started.
+ * Same as `cute_threadpool_create`, but with control over naming and pinning the worker threads,
+ * see `cute_threadpool_options_t`. `options` can be NULL, which is the same as zero-initialized
+ * options.
+ */
+cute_threadpool_t* cute_threadpool_create_with_options(int thread_count, const cute_threadpool_options_t* options, void* mem_ctx);
+
+/**
+ * Adds a single task to the pool. The task is represented as a function pointer `func`, which does
+ * work. The `param` is passed to the `func` when the task is started.
+ *
+ * Each worker thread owns a lock-free deque of tasks, and idle workers steal from the other deques.
+ * Tasks added from within a running task go to that worker's own deque without any locking. Tasks
+ * added from any other thread go to a single shared deque, where only adding (not stealing) takes
+ * a lock. No ordering between tasks is guaranteed.
+ *
+ * A pool holds at most `(1 << 20) - 1` unfinished tasks at once, which is asserted.
  */
 void cute_threadpool_add_task(cute_threadpool_t* pool, void (*func)(void*), void* param);
 
+/**
+ * Same as `cute_threadpool_add_task`, but also increments `counter` by one. `counter` is decremented
+ * once the task finishes. Many tasks can share a single counter, e.g. to wait on a group of tasks
+ * with `cute_threadpool_wait_counter`, or to start continuations once they all finish.
+ *
+ * A counter must be zero-initialized before its first use. `counter` can be NULL.
+ */
+void cute_threadpool_add_task_with_counter(cute_threadpool_t* pool, void (*func)(void*), void* param, cute_task_counter_t* counter);
+
+/**
+ * Adds a task to the pool once the `dependency` counter reaches zero, or immediately if it's
+ * already zero. If `counter` is not NULL it's incremented right away (not once the continuation
+ * starts), so waiting on `counter` also waits on `dependency`. This lets you chain groups of tasks,
+ * for example physics -> broadphase -> narrowphase, without stalling the calling thread.
+ */
+void cute_threadpool_add_continuation(cute_threadpool_t* pool, cute_task_counter_t* dependency, void (*func)(void*), void* param, cute_task_counter_t* counter);
+
+/**
+ * Wakes internal threads to perform tasks, and waits until `counter` reaches zero. The calling
+ * thread will help perform available tasks while waiting, including ones unrelated to `counter`.
+ * Once this function returns, the pool no longer touches `counter`, so it's safe to reuse or free.
+ */
+void cute_threadpool_wait_counter(cute_threadpool_t* pool, cute_task_counter_t* counter);
+
 /**
  * Wakes internal threads to perform tasks, and waits for all tasks to complete before returning.
- * The calling thread will help perform available tasks while waiting.
+ * This includes tasks already picked up by worker threads, and tasks those tasks add. The calling
+ * thread will help perform available tasks while waiting.
+ *
+ * When called from within a task, the calling task and any other tasks blocked in this function are
+ * not waited on. At most 2047 tasks can be blocked in here at once, which is asserted. Prefer
+ * `cute_threadpool_wait_counter` to wait on just the tasks you added.
  */
 void cute_threadpool_kick_and_wait(cute_threadpool_t* pool);
 
@@ -281,11 +346,114 @@ void cute_threadpool_kick_and_wait(cute_threadpool_t* pool);
  */
 void cute_threadpool_kick(cute_threadpool_t* pool);
 
+/**
+ * Returns the number of worker threads in the pool, not counting any threads helping out from
+ * `cute_threadpool_kick_and_wait` or `cute_threadpool_wait_counter`.
+ */
+int cute_threadpool_thread_count(cute_threadpool_t* pool);
+
+/**
+ * Fetches utilization statistics for the worker at `worker_index`, from 0 to thread count - 1. An
+ * index equal to the thread count fetches tasks run by threads helping out from within
+ * `cute_threadpool_kick_and_wait` or `cute_threadpool_wait_counter` instead, where only `tasks_run`
+ * is tracked.
+ *
+ * Task counts are updated as each task finishes. Busy and idle times are updated whenever a worker
+ * runs out of tasks, and every 64 tasks while it stays busy, so they lag slightly behind.
+ */
+void cute_threadpool_get_stats(cute_threadpool_t* pool, int worker_index, cute_worker_stats_t* stats);
+
+/**
+ * Zeroes all statistics, e.g. to sample utilization over fixed intervals.
+ */
+void cute_threadpool_reset_stats(cute_threadpool_t* pool);
+
 /**
  * Cleans up all resources created from `cute_threadpool_create`.
  */
 void cute_threadpool_destroy(cute_threadpool_t* pool);
 
+typedef struct cute_mpmc_queue_t cute_mpmc_queue_t;
+
+/**
+ * Constructs a bounded lock-free queue that any number of threads may push to and pop from. Each
+ * element is a copy of `element_size` bytes. `capacity` is rounded up to a power of two. `mem_ctx`
+ * can be NULL, and is used for custom allocation purposes.
+ *
+ * Based on Dmitry Vyukov's bounded MPMC queue, where each cell stores a sequence number telling
+ * producers and consumers whose turn it is.
+ */
+cute_mpmc_queue_t* cute_mpmc_queue_create(int capacity, int element_size, void* mem_ctx);
+
+/**
+ * Cleans up all resources created from `cute_mpmc_queue_create`.
+ */
+void cute_mpmc_queue_destroy(cute_mpmc_queue_t* queue);
+
+/**
+ * Copies `element` into the queue. Returns 1 on success, or 0 if the queue is full.
+ */
+int cute_mpmc_queue_try_push(cute_mpmc_queue_t* queue, const void* element);
+
+/**
+ * Copies the oldest element out of the queue into `element`. Returns 1 on success, or 0 if the
+ * queue is empty.
+ */
+int cute_mpmc_queue_try_pop(cute_mpmc_queue_t* queue, void* element);
+
+/**
+ * Copies up to `count` tightly packed elements into the queue, claiming room for all of them with a
+ * single atomic operation. Returns the number of elements pushed, which is less than `count` when
+ * the queue runs out of room.
+ */
+int cute_mpmc_queue_try_push_many(cute_mpmc_queue_t* queue, const void* elements, int count);
+
+/**
+ * Copies up to `count` of the oldest elements out of the queue into `elements`. Returns the number
+ * of elements popped.
+ */
+int cute_mpmc_queue_try_pop_many(cute_mpmc_queue_t* queue, void* elements, int count);
+
+typedef struct cute_spsc_ring_t cute_spsc_ring_t;
+
+/**
+ * Constructs a bounded lock-free ring for exactly one producer thread and one consumer thread.
+ * Each element is a copy of `element_size` bytes. `capacity` is rounded up to a power of two.
+ * `mem_ctx` can be NULL, and is used for custom allocation purposes.
+ *
+ * The producer and consumer indices live on separate cache lines, and each side caches the other
+ * side's index, so the shared cache lines are only touched when the ring looks full or empty.
+ */
+cute_spsc_ring_t* cute_spsc_ring_create(int capacity, int element_size, void* mem_ctx);
+
+/**
+ * Cleans up all resources created from `cute_spsc_ring_create`.
+ */
+void cute_spsc_ring_destroy(cute_spsc_ring_t* ring);
+
+/**
+ * Copies `element` into the ring. Returns 1 on success, or 0 if the ring is full. Producer only.
+ */
+int cute_spsc_ring_try_push(cute_spsc_ring_t* ring, const void* element);
+
+/**
+ * Copies the oldest element out of the ring into `element`. Returns 1 on success, or 0 if the ring
+ * is empty. Consumer only.
+ */
+int cute_spsc_ring_try_pop(cute_spsc_ring_t* ring, void* element);
+
+/**
+ * Copies up to `count` tightly packed elements into the ring. Returns the number of elements pushed.
+ * Producer only.
+ */
+int cute_spsc_ring_try_push_many(cute_spsc_ring_t* ring, const void* elements, int count);
+
+/**
+ * Copies up to `count` of the oldest elements out of the ring into `elements`. Returns the number
+ * of elements popped. Consumer only.
+ */
+int cute_spsc_ring_try_pop_many(cute_spsc_ring_t* ring, void* elements, int count);
+
 #define CUTE_SYNC_H
 #endif
 
@@ -307,6 +475,33 @@ struct cute_rw_lock_t
 	cute_atomic_int_t readers_departing;
 };
 
+struct cute_task_counter_t
+{
+	cute_atomic_int_t count;
+	void* continuations;
+};
+
+struct cute_threadpool_options_t
+{
+	// Workers are named "<thread_name> <index>", which shows up in debuggers and profilers. Names are
+	// truncated to 15 characters, the limit on Linux. Defaults to "cute_worker" when NULL.
+	const char* thread_name;
+
+	// When nonzero each worker is pinned to its own core, where worker `i` runs on the core
+	// `(first_core + i) % cute_core_count()`. Setting `first_core` to 1 leaves core 0 for the main
+	// thread.
+	int pin_to_cores;
+	int first_core;
+};
+
+struct cute_worker_stats_t
+{
+	int tasks_run;
+	int steals;          // Tasks taken from another worker's deque.
+	double busy_seconds; // Time spent running tasks.
+	double idle_seconds; // Time spent looking for tasks or asleep.
+};
+
 #define CUTE_SYNC_TYPE_DEFINITIONS_H
 #endif
 
@@ -348,6 +543,8 @@ struct cute_rw_lock_t
 	#define CUTE_SYNC_FREE(ptr, ctx) free(ptr)
 #endif
 
+#include <stdio.h> // snprintf
+
 #if !defined(CUTE_SYNC_MEMCPY)
 	#include <string.h>
 	#define CUTE_SYNC_MEMCPY memcpy
@@ -371,16 +568,19 @@ struct cute_rw_lock_t
 	#define CUTE_SYNC_ASSERT assert
 #endif
 
-#if !defined(CUTE_SYNC_CACHELINE_SIZE)
-	// Sized generously to try and avoid guessing "too low". Too small would incur serious overhead
-	// inside of `cute_threadpool_t` as false sharing would run amok between pooled threads.
-	#define CUTE_SYNC_CACHELINE_SIZE 128
-#endif
-
 // Atomics implementation.
 // Use SDL2's implementation if available, otherwise WIN32 and GCC-like compilers are supported out-of-the-box.
 #ifdef CUTE_SYNC_SDL
 
+// SDL sets atomics with `__sync_lock_test_and_set` on GCC-like compilers, which is only an acquire
+// barrier, so sets are followed by a full barrier. Other compilers use interlocked functions, which
+// already are full barriers.
+#if defined(__GNUC__) || defined(__clang__)
+#	define CUTE_SYNC_SDL_FULL_BARRIER() __sync_synchronize()
+#else
+#	define CUTE_SYNC_SDL_FULL_BARRIER()
+#endif
+
 int cute_atomic_add(cute_atomic_int_t* atomic, int addend)
 {
 	return SDL_AtomicAdd((SDL_atomic_t*)atomic, addend);
@@ -388,7 +588,9 @@ int cute_atomic_add(cute_atomic_int_t* atomic, int addend)
 
 int cute_atomic_set(cute_atomic_int_t* atomic, int value)
 {
-	return SDL_AtomicSet((SDL_atomic_t*)atomic, value);
+	int result = SDL_AtomicSet((SDL_atomic_t*)atomic, value);
+	CUTE_SYNC_SDL_FULL_BARRIER();
+	return result;
 }
 
 int cute_atomic_get(cute_atomic_int_t* atomic)
@@ -403,7 +605,9 @@ int cute_atomic_cas(cute_atomic_int_t* atomic, int expected, int value)
 
 void* cute_atomic_ptr_set(void** atomic, void* value)
 {
-	return SDL_AtomicSetPtr(atomic, value);
+	void* result = SDL_AtomicSetPtr(atomic, value);
+	CUTE_SYNC_SDL_FULL_BARRIER();
+	return result;
 }
 
 void* cute_atomic_ptr_get(void** atomic)
@@ -435,7 +639,7 @@ int cute_atomic_get(cute_atomic_int_t* atomic)
 
 int cute_atomic_cas(cute_atomic_int_t* atomic, int expected, int value)
 {
-	return (int)_InterlockedCompareExchange(&atomic->i, expected, value) == value;
+	return (int)_InterlockedCompareExchange(&atomic->i, value, expected) == expected;
 }
 
 void* cute_atomic_ptr_set(void** atomic, void* value)
@@ -450,7 +654,7 @@ void* cute_atomic_ptr_get(void** atomic)
 
 int cute_atomic_ptr_cas(void** atomic, void* expected, void* value)
 {
-	return _InterlockedCompareExchangePointer(atomic, expected, value) == value;
+	return _InterlockedCompareExchangePointer(atomic, value, expected) == expected;
 }
 
 #elif defined(CUTE_SYNC_POSIX)
@@ -467,8 +671,9 @@ int cute_atomic_add(cute_atomic_int_t* atomic, int addend)
 
 int cute_atomic_set(cute_atomic_int_t* atomic, int value)
 {
+	// `__sync_lock_test_and_set` is only an acquire barrier, so follow it with a full barrier.
 	int result = (int)__sync_lock_test_and_set(&atomic->i, value);
-	__sync_lock_release(&atomic->i);
+	__sync_synchronize();
 	return result;
 }
 
@@ -479,13 +684,13 @@ int cute_atomic_get(cute_atomic_int_t* atomic)
 
 int cute_atomic_cas(cute_atomic_int_t* atomic, int expected, int value)
 {
-	return (int)__sync_val_compare_and_swap(&atomic->i, expected, value) == value;
+	return (int)__sync_bool_compare_and_swap(&atomic->i, expected, value);
 }
 
 void* cute_atomic_ptr_set(void** atomic, void* value)
 {
 	void* result = __sync_lock_test_and_set(atomic, value);
-	__sync_lock_release(atomic);
+	__sync_synchronize();
 	return result;
 }
 
@@ -496,7 +701,7 @@ void* cute_atomic_ptr_get(void** atomic)
 
 int cute_atomic_ptr_cas(void** atomic, void* expected, void* value)
 {
-	return __sync_val_compare_and_swap(atomic, expected, value) == value;
+	return (int)__sync_bool_compare_and_swap(atomic, expected, value);
 }
 
 #endif // End atomics implementation.
@@ -880,7 +1085,7 @@ void cute_cv_destroy(cute_cv_t* cv)
 cute_semaphore_t cute_semaphore_create(int initial_count)
 {
 	cute_semaphore_t semaphore;
-	semaphore.id = CUTE_ALLOC(sizeof(sem_t), NULL);
+	semaphore.id = CUTE_SYNC_ALLOC(sizeof(sem_t), NULL);
 	sem_init((sem_t*)semaphore.id, 0, (unsigned)initial_count);
 	semaphore.count.i = initial_count;
 	return semaphore;
@@ -911,7 +1116,7 @@ int cute_semaphore_value(cute_semaphore_t* semaphore)
 void cute_semaphore_destroy(cute_semaphore_t* semaphore)
 {
 	sem_destroy((sem_t*)semaphore->id);
-	CUTE_FREE(semaphore->id);
+	CUTE_SYNC_FREE(semaphore->id, NULL);
 }
 
 #elif defined(__APPLE__)
@@ -1067,6 +1272,65 @@ int cute_ram_size()
 
 #endif
 
+// Pinning isn't covered by SDL, so go straight to the OS regardless of the base implementation.
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+int cute_thread_set_affinity(int core_index)
+{
+	if (core_index < 0) return 0;
+#if defined(_WIN32)
+	if (core_index >= (int)(sizeof(DWORD_PTR) * 8)) return 0;
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core_index) != 0;
+#elif defined(__linux__) && defined(_GNU_SOURCE)
+	if (core_index >= CPU_SETSIZE) return 0;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core_index, &set);
+	return !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	return 0;
+#endif
+}
+
+#if defined(CUTE_SYNC_POSIX)
+	#include <time.h> // clock_gettime
+#endif
+
+// High resolution monotonic clock for the threadpool statistics.
+static unsigned long long cute_ticks_internal()
+{
+#if defined(CUTE_SYNC_SDL)
+	return (unsigned long long)SDL_GetPerformanceCounter();
+#elif defined(CUTE_SYNC_WINDOWS)
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return (unsigned long long)count.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+static double cute_ticks_per_second_internal()
+{
+#if defined(CUTE_SYNC_SDL)
+	return (double)SDL_GetPerformanceFrequency();
+#elif defined(CUTE_SYNC_WINDOWS)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return (double)frequency.QuadPart;
+#else
+	return 1.0e9;
+#endif
+}
+
 cute_rw_lock_t cute_rw_lock_create()
 {
 	cute_rw_lock_t rw;
@@ -1160,70 +1424,476 @@ typedef struct cute_task_t
 {
 	void (*do_work)(void*);
 	void* param;
+	cute_task_counter_t* counter;
 } cute_task_t;
 
+// Continuations waiting on a counter, kept in a push-only list that's taken as a whole once the
+// counter reaches zero.
+typedef struct cute_continuation_t
+{
+	cute_task_t task;
+	struct cute_continuation_t* next;
+} cute_continuation_t;
+
+// Ring buffer of tasks for a single deque. Buffers are only ever grown, never shrunk. Old buffers
+// are kept alive in a retired list until the pool is destroyed, since thieves may still be reading
+// from them.
+typedef struct cute_task_buffer_t
+{
+	int mask;
+	struct cute_task_buffer_t* next_retired;
+	void** tasks; // Triples of { do_work, param, counter }, accessed atomically.
+} cute_task_buffer_t;
+
+// Chase-Lev work-stealing deque. The owning thread pushes and pops at `bottom` (LIFO), while any
+// other thread may steal from `top` (FIFO). `top` and `bottom` live on separate cache lines.
+typedef struct cute_task_deque_t
+{
+	cute_atomic_int_t top;
+	char pad0[CUTE_SYNC_CACHELINE_SIZE - sizeof(cute_atomic_int_t)];
+	cute_atomic_int_t bottom;
+	void* buffer;
+	cute_task_buffer_t* retired;
+	struct cute_threadpool_t* pool;
+	int index;
+	char pad1[CUTE_SYNC_CACHELINE_SIZE - sizeof(cute_atomic_int_t) - sizeof(void*) * 3 - sizeof(int)];
+} cute_task_deque_t;
+
+// Per-worker statistics. Counts are atomic, and only the owning worker ever adds to them. The tick
+// counts are accumulated locally by each worker and flushed under `lock` every so often.
+typedef struct cute_worker_stats_internal_t
+{
+	cute_atomic_int_t tasks_run;
+	cute_atomic_int_t steals;
+	cute_mutex_t lock;
+	unsigned long long busy_ticks;
+	unsigned long long idle_ticks;
+} cute_worker_stats_internal_t;
+
+typedef struct cute_worker_t
+{
+	cute_worker_stats_internal_t stats;
+	char pad[CUTE_SYNC_CACHELINE_SIZE - sizeof(cute_worker_stats_internal_t) % CUTE_SYNC_CACHELINE_SIZE];
+} cute_worker_t;
+
+#define CUTE_SYNC_STATS_FLUSH_INTERVAL 64
+
 typedef struct cute_threadpool_t
 {
-	int task_capacity;
-	int task_count;
-	cute_task_t* tasks;
-	cute_mutex_t task_mutex;
+	// One deque per worker thread, plus one extra deque (the last one) for tasks added from any
+	// thread outside of the pool. Pushes and pops on the extra deque are serialized by
+	// `submit_mutex`, but stealing from it is lock-free.
+	cute_task_deque_t* deques;
+	cute_mutex_t submit_mutex;
 
 	int thread_count;
 	cute_thread_t** threads;
+	cute_worker_t* workers;
+	cute_threadpool_options_t options;
+	cute_atomic_int_t caller_tasks_run;
+	double ticks_per_second;
 
 	cute_atomic_int_t running;
-	cute_mutex_t sem_mutex;
+	cute_atomic_int_t pending; // See `CUTE_SYNC_BLOCKED_TASK`.
 	cute_semaphore_t semaphore;
 	void* mem_ctx;
 } cute_threadpool_t;
 
-int cute_try_pop_task_internal(cute_threadpool_t* pool, cute_task_t* task)
+#if !defined(CUTE_SYNC_THREAD_LOCAL)
+	#ifdef _MSC_VER
+		#define CUTE_SYNC_THREAD_LOCAL __declspec(thread)
+	#else
+		#define CUTE_SYNC_THREAD_LOCAL __thread
+	#endif
+#endif
+
+// Set on each worker thread, so tasks added from within a task go straight to the worker's own deque.
+static CUTE_SYNC_THREAD_LOCAL cute_task_deque_t* cute_worker_deque_internal;
+
+// The tasks currently running on this thread, innermost first. Tasks nest when a task helps out
+// from within `cute_threadpool_kick_and_wait` or `cute_threadpool_wait_counter`.
+typedef struct cute_task_frame_t
 {
-	cute_lock(&pool->task_mutex);
+	cute_threadpool_t* pool;
+	int blocked;
+	struct cute_task_frame_t* next;
+} cute_task_frame_t;
 
-	if (pool->task_count) {
-		*task = pool->tasks[--pool->task_count];
-		cute_unlock(&pool->task_mutex);
-		return 1;
+static CUTE_SYNC_THREAD_LOCAL cute_task_frame_t* cute_task_frames_internal;
+
+// `pending` counts added tasks that have not finished yet in its low bits. Tasks blocked within a
+// nested `cute_threadpool_kick_and_wait` are moved to the high bits, so nested waits can skip over
+// them while a single atomic read still sees every unfinished task. Both parts are limited so the
+// low bits never carry into the high bits, and the high bits never overflow.
+#define CUTE_SYNC_BLOCKED_TASK (1 << 20)
+#define CUTE_SYNC_RUNNABLE_TASKS(pending) ((pending) & (CUTE_SYNC_BLOCKED_TASK - 1))
+#define CUTE_SYNC_BLOCKED_TASKS(pending) ((pending) / CUTE_SYNC_BLOCKED_TASK)
+#define CUTE_SYNC_MAX_TASKS (CUTE_SYNC_BLOCKED_TASK - 1)
+#define CUTE_SYNC_MAX_BLOCKED_TASKS (0x7FFFFFFF / CUTE_SYNC_BLOCKED_TASK)
+
+#define CUTE_SYNC_TASK_DEQUE_INITIAL_CAPACITY 256
+#define CUTE_SYNC_DEQUE_SIZE(B, T) ((int)((unsigned)(B) - (unsigned)(T)))
+#define CUTE_SYNC_DEQUE_NEXT(I) ((int)((unsigned)(I) + 1))
+
+static cute_task_buffer_t* cute_task_buffer_create_internal(int capacity, void* mem_ctx)
+{
+	(void)mem_ctx;
+	cute_task_buffer_t* buffer = (cute_task_buffer_t*)CUTE_SYNC_ALLOC(sizeof(cute_task_buffer_t) + sizeof(void*) * 3 * capacity, mem_ctx);
+	buffer->mask = capacity - 1;
+	buffer->next_retired = 0;
+	buffer->tasks = (void**)(buffer + 1);
+	return buffer;
+}
+
+static void cute_task_buffer_put_internal(cute_task_buffer_t* buffer, int i, cute_task_t task)
+{
+	void** slot = buffer->tasks + ((unsigned)i & (unsigned)buffer->mask) * 3;
+	cute_atomic_ptr_set(slot, (void*)task.do_work);
+	cute_atomic_ptr_set(slot + 1, task.param);
+	cute_atomic_ptr_set(slot + 2, task.counter);
+}
+
+static cute_task_t cute_task_buffer_get_internal(cute_task_buffer_t* buffer, int i)
+{
+	void** slot = buffer->tasks + ((unsigned)i & (unsigned)buffer->mask) * 3;
+	cute_task_t task;
+	task.do_work = (void (*)(void*))cute_atomic_ptr_get(slot);
+	task.param = cute_atomic_ptr_get(slot + 1);
+	task.counter = (cute_task_counter_t*)cute_atomic_ptr_get(slot + 2);
+	return task;
+}
+
+static void cute_task_deque_init_internal(cute_task_deque_t* deque, cute_threadpool_t* pool, int index)
+{
+	cute_atomic_set(&deque->top, 0);
+	cute_atomic_set(&deque->bottom, 0);
+	deque->buffer = cute_task_buffer_create_internal(CUTE_SYNC_TASK_DEQUE_INITIAL_CAPACITY, pool->mem_ctx);
+	deque->retired = 0;
+	deque->pool = pool;
+	deque->index = index;
+}
+
+static void cute_task_deque_cleanup_internal(cute_task_deque_t* deque)
+{
+	void* mem_ctx = deque->pool->mem_ctx;
+	(void)mem_ctx;
+	CUTE_SYNC_FREE(deque->buffer, mem_ctx);
+	cute_task_buffer_t* buffer = deque->retired;
+	while (buffer) {
+		cute_task_buffer_t* next = buffer->next_retired;
+		CUTE_SYNC_FREE(buffer, mem_ctx);
+		buffer = next;
+	}
+}
+
+// Owner only.
+static void cute_task_deque_push_internal(cute_task_deque_t* deque, cute_task_t task)
+{
+	int b = cute_atomic_get(&deque->bottom);
+	int t = cute_atomic_get(&deque->top);
+	cute_task_buffer_t* buffer = (cute_task_buffer_t*)cute_atomic_ptr_get(&deque->buffer);
+
+	if (CUTE_SYNC_DEQUE_SIZE(b, t) > buffer->mask) {
+		cute_task_buffer_t* grown = cute_task_buffer_create_internal((buffer->mask + 1) * 2, deque->pool->mem_ctx);
+		for (int i = t; i != b; i = CUTE_SYNC_DEQUE_NEXT(i)) {
+			cute_task_buffer_put_internal(grown, i, cute_task_buffer_get_internal(buffer, i));
+		}
+		cute_atomic_ptr_set(&deque->buffer, grown);
+		buffer->next_retired = deque->retired;
+		deque->retired = buffer;
+		buffer = grown;
+	}
+
+	// Publish with an add rather than a set, since an add is a full barrier on every backend. This
+	// keeps the task's stores from moving past the new `bottom`.
+	cute_task_buffer_put_internal(buffer, b, task);
+	cute_atomic_add(&deque->bottom, 1);
+}
+
+// Owner only.
+static int cute_task_deque_pop_internal(cute_task_deque_t* deque, cute_task_t* task)
+{
+	// Storing `bottom` must happen before loading `top`, or the owner and a thief can both take the
+	// last task. Only a full barrier orders a store before a later load, so decrement with an add.
+	int b = (int)((unsigned)cute_atomic_add(&deque->bottom, -1) - 1);
+	cute_task_buffer_t* buffer = (cute_task_buffer_t*)cute_atomic_ptr_get(&deque->buffer);
+	int t = cute_atomic_get(&deque->top);
+	int size = CUTE_SYNC_DEQUE_SIZE(b, t);
+
+	if (size < 0) {
+		cute_atomic_set(&deque->bottom, t);
+		return 0;
+	}
+
+	*task = cute_task_buffer_get_internal(buffer, b);
+	if (size > 0) return 1;
+
+	// Taking the last task races against thieves, so claim it the same way they do.
+	int success = cute_atomic_cas(&deque->top, t, CUTE_SYNC_DEQUE_NEXT(t));
+	cute_atomic_set(&deque->bottom, CUTE_SYNC_DEQUE_NEXT(t));
+	return success;
+}
+
+// Any thread.
+static int cute_task_deque_steal_internal(cute_task_deque_t* deque, cute_task_t* task)
+{
+	int t = cute_atomic_get(&deque->top);
+	int b = cute_atomic_get(&deque->bottom);
+	if (CUTE_SYNC_DEQUE_SIZE(b, t) <= 0) return 0;
+
+	cute_task_buffer_t* buffer = (cute_task_buffer_t*)cute_atomic_ptr_get(&deque->buffer);
+	*task = cute_task_buffer_get_internal(buffer, t);
+	return cute_atomic_cas(&deque->top, t, CUTE_SYNC_DEQUE_NEXT(t));
+}
+
+// Sets `stolen` when the task came from another worker's deque.
+static int cute_try_get_task_internal(cute_threadpool_t* pool, cute_task_t* task, int* stolen)
+{
+	cute_task_deque_t* own = cute_worker_deque_internal;
+	int deque_count = pool->thread_count + 1;
+	int start;
+	*stolen = 0;
+
+	if (own && own->pool == pool) {
+		if (cute_task_deque_pop_internal(own, task)) return 1;
+		start = own->index + 1;
+	} else {
+		cute_task_deque_t* submit = pool->deques + pool->thread_count;
+		cute_lock(&pool->submit_mutex);
+		int success = cute_task_deque_pop_internal(submit, task);
+		cute_unlock(&pool->submit_mutex);
+		if (success) return 1;
+		start = 0;
+	}
+
+	for (int i = 0; i < deque_count; ++i) {
+		int index = (start + i) % deque_count;
+		cute_task_deque_t* victim = pool->deques + index;
+		if (victim == own) continue;
+		if (cute_task_deque_steal_internal(victim, task)) {
+			*stolen = index < pool->thread_count;
+			return 1;
+		}
 	}
 
-	cute_unlock(&pool->task_mutex);
 	return 0;
 }
 
+static void cute_push_task_internal(cute_threadpool_t* pool, cute_task_t task)
+{
+	int pending = cute_atomic_add(&pool->pending, 1);
+	CUTE_SYNC_ASSERT(CUTE_SYNC_RUNNABLE_TASKS(pending) < CUTE_SYNC_MAX_TASKS);
+	(void)pending;
+
+	cute_task_deque_t* own = cute_worker_deque_internal;
+	if (own && own->pool == pool) {
+		cute_task_deque_push_internal(own, task);
+	} else {
+		cute_lock(&pool->submit_mutex);
+		cute_task_deque_push_internal(pool->deques + pool->thread_count, task);
+		cute_unlock(&pool->submit_mutex);
+	}
+}
+
+static void cute_push_continuations_internal(cute_task_counter_t* counter, cute_continuation_t* list)
+{
+	cute_continuation_t* tail = list;
+	while (tail->next) tail = tail->next;
+	while (1) {
+		void* head = cute_atomic_ptr_get(&counter->continuations);
+		tail->next = (cute_continuation_t*)head;
+		if (cute_atomic_ptr_cas(&counter->continuations, head, list)) break;
+	}
+}
+
+// Value of a counter's `count` while its last decrement takes the continuations list. Nothing may
+// raise the count while it's closed, so the list can't be pushed to after it was taken.
+#define CUTE_SYNC_COUNTER_CLOSED (-1)
+
+// Increments `counter`, waiting out a decrement that's taking the continuations list.
+static void cute_counter_increment_internal(cute_task_counter_t* counter)
+{
+	while (1) {
+		int count = cute_atomic_get(&counter->count);
+		if (count == CUTE_SYNC_COUNTER_CLOSED) {
+			CUTE_SYNC_YIELD();
+			continue;
+		}
+		if (cute_atomic_cas(&counter->count, count, count + 1)) return;
+	}
+}
+
+// Decrements `counter`, and launches its continuations if it reaches zero. Closing the counter,
+// taking the list, and then storing zero is what keeps a continuation pushed by a concurrent
+// `cute_threadpool_add_continuation` from being left behind. The final store of zero is the last
+// access to `counter`, so waiters may free it as soon as they see zero. It's a compare and swap
+// rather than a set for the full barrier, so the list is taken before anyone sees zero.
+static void cute_counter_decrement_internal(cute_threadpool_t* pool, cute_task_counter_t* counter)
+{
+	while (1) {
+		int count = cute_atomic_get(&counter->count);
+		CUTE_SYNC_ASSERT(count > 0);
+		if (count != 1) {
+			if (cute_atomic_cas(&counter->count, count, count - 1)) return;
+			continue;
+		}
+
+		if (!cute_atomic_cas(&counter->count, 1, CUTE_SYNC_COUNTER_CLOSED)) continue;
+		cute_continuation_t* list = (cute_continuation_t*)cute_atomic_ptr_set(&counter->continuations, 0);
+		int reopened = cute_atomic_cas(&counter->count, CUTE_SYNC_COUNTER_CLOSED, 0);
+		CUTE_SYNC_ASSERT(reopened);
+		(void)reopened;
+
+		if (list) {
+			while (list) {
+				cute_continuation_t* next = list->next;
+				cute_push_task_internal(pool, list->task);
+				CUTE_SYNC_FREE(list, pool->mem_ctx);
+				list = next;
+			}
+			cute_threadpool_kick(pool);
+		}
+		return;
+	}
+}
+
+static void cute_do_task_internal(cute_threadpool_t* pool, cute_task_t task)
+{
+	cute_task_frame_t frame;
+	frame.pool = pool;
+	frame.blocked = 0;
+	frame.next = cute_task_frames_internal;
+	cute_task_frames_internal = &frame;
+	task.do_work(task.param);
+	cute_task_frames_internal = frame.next;
+	if (task.counter) cute_counter_decrement_internal(pool, task.counter);
+	cute_atomic_add(&pool->pending, -1);
+}
+
+// Tasks run by threads helping from within `cute_threadpool_kick_and_wait` or
+// `cute_threadpool_wait_counter`.
+static void cute_help_internal(cute_threadpool_t* pool)
+{
+	cute_task_t task;
+	int stolen;
+	if (cute_try_get_task_internal(pool, &task, &stolen)) {
+		cute_do_task_internal(pool, task);
+		cute_atomic_add(&pool->caller_tasks_run, 1);
+	} else {
+		CUTE_SYNC_YIELD();
+	}
+}
+
+static void cute_flush_stats_internal(cute_worker_stats_internal_t* stats, unsigned long long* busy_ticks, unsigned long long* idle_ticks)
+{
+	cute_lock(&stats->lock);
+	stats->busy_ticks += *busy_ticks;
+	stats->idle_ticks += *idle_ticks;
+	cute_unlock(&stats->lock);
+	*busy_ticks = 0;
+	*idle_ticks = 0;
+}
+
 int cute_worker_thread_internal(void* udata)
 {
-	cute_threadpool_t* pool = (cute_threadpool_t*)udata;
+	cute_task_deque_t* deque = (cute_task_deque_t*)udata;
+	cute_threadpool_t* pool = deque->pool;
+	cute_worker_stats_internal_t* stats = &pool->workers[deque->index].stats;
+	cute_worker_deque_internal = deque;
+
+	if (pool->options.pin_to_cores) {
+		int core_count = cute_core_count();
+		cute_thread_set_affinity((pool->options.first_core + deque->index) % (core_count > 0 ? core_count : 1));
+	}
+
+	// Time from the end of one task until the next is acquired, including failed steals, is idle.
+	unsigned long long busy_ticks = 0;
+	unsigned long long idle_ticks = 0;
+	unsigned long long last = cute_ticks_internal();
+	int unflushed = 0;
+
 	while (cute_atomic_get(&pool->running)) {
+		// Keep working as long as there is anything to pop or steal, and only sleep once all
+		// deques are observed empty.
 		cute_task_t task;
-		if (cute_try_pop_task_internal(pool, &task)) {
-			task.do_work(task.param);
+		int stolen;
+		if (cute_try_get_task_internal(pool, &task, &stolen)) {
+			unsigned long long start = cute_ticks_internal();
+			idle_ticks += start - last;
+			if (stolen) cute_atomic_add(&stats->steals, 1);
+			cute_atomic_add(&stats->tasks_run, 1);
+			cute_do_task_internal(pool, task);
+			last = cute_ticks_internal();
+			busy_ticks += last - start;
+			if (++unflushed == CUTE_SYNC_STATS_FLUSH_INTERVAL) {
+				cute_flush_stats_internal(stats, &busy_ticks, &idle_ticks);
+				unflushed = 0;
+			}
+			continue;
 		}
 
+		unsigned long long now = cute_ticks_internal();
+		idle_ticks += now - last;
+		cute_flush_stats_internal(stats, &busy_ticks, &idle_ticks);
+		unflushed = 0;
 		cute_semaphore_wait(&pool->semaphore);
+		last = cute_ticks_internal();
+		idle_ticks += last - now;
 	}
+
+	cute_worker_deque_internal = 0;
 	return 0;
 }
 
 cute_threadpool_t* cute_threadpool_create(int thread_count, void* mem_ctx)
+{
+	return cute_threadpool_create_with_options(thread_count, 0, mem_ctx);
+}
+
+cute_threadpool_t* cute_threadpool_create_with_options(int thread_count, const cute_threadpool_options_t* options, void* mem_ctx)
 {
 	if (CUTE_SYNC_CACHELINE_SIZE < cute_cacheline_size()) return 0;
 
 	cute_threadpool_t* pool = (cute_threadpool_t*)CUTE_SYNC_ALLOC(sizeof(cute_threadpool_t), mem_ctx);
-	pool->task_capacity = 64;
-	pool->task_count = 0;
-	pool->tasks = (cute_task_t*)cute_malloc_aligned(sizeof(cute_task_t) * pool->task_capacity, CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
-	pool->task_mutex = cute_mutex_create();
+	pool->mem_ctx = mem_ctx;
 	pool->thread_count = thread_count;
+	if (options) {
+		pool->options = *options;
+	} else {
+		pool->options.thread_name = 0;
+		pool->options.pin_to_cores = 0;
+		pool->options.first_core = 0;
+	}
+	pool->workers = (cute_worker_t*)cute_malloc_aligned(sizeof(cute_worker_t) * thread_count, CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
+	for (int i = 0; i < thread_count; ++i) {
+		cute_worker_stats_internal_t* stats = &pool->workers[i].stats;
+		cute_atomic_set(&stats->tasks_run, 0);
+		cute_atomic_set(&stats->steals, 0);
+		stats->lock = cute_mutex_create();
+		stats->busy_ticks = 0;
+		stats->idle_ticks = 0;
+	}
+	cute_atomic_set(&pool->caller_tasks_run, 0);
+	pool->ticks_per_second = cute_ticks_per_second_internal();
+	pool->deques = (cute_task_deque_t*)cute_malloc_aligned(sizeof(cute_task_deque_t) * (thread_count + 1), CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
+	for (int i = 0; i < thread_count + 1; ++i) {
+		cute_task_deque_init_internal(pool->deques + i, pool, i);
+	}
+	pool->submit_mutex = cute_mutex_create();
 	pool->threads = (cute_thread_t**)cute_malloc_aligned(sizeof(cute_thread_t*) * thread_count, CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
 	cute_atomic_set(&pool->running, 1);
-	pool->sem_mutex = cute_mutex_create();
+	cute_atomic_set(&pool->pending, 0);
 	pool->semaphore = cute_semaphore_create(0);
-	pool->mem_ctx = mem_ctx;
 
+	// Thread names are copied by the OS, so a temporary buffer is fine. 16 bytes is the limit on Linux,
+	// so shorten the name rather than the index if it doesn't fit.
+	const char* thread_name = pool->options.thread_name ? pool->options.thread_name : "cute_worker";
 	for (int i = 0; i < thread_count; ++i) {
-		pool->threads[i] = cute_thread_create(cute_worker_thread_internal, 0, pool);
+		char name[16];
+		int digits = 1;
+		for (int n = i; n >= 10; n /= 10) ++digits;
+		snprintf(name, sizeof(name), "%.*s %d", (int)sizeof(name) - 2 - digits, thread_name, i);
+		pool->threads[i] = cute_thread_create(cute_worker_thread_internal, name, pool->deques + i);
 	}
 
 	return pool;
@@ -1231,49 +1901,139 @@ cute_threadpool_t* cute_threadpool_create(int thread_count, void* mem_ctx)
 
 void cute_threadpool_add_task(cute_threadpool_t* pool, void (*func)(void*), void* param)
 {
-	cute_lock(&pool->task_mutex);
-
-	if (pool->task_count == pool->task_capacity) {
-		int new_cap = pool->task_capacity * 2;
-		cute_task_t* new_tasks = (cute_task_t*)cute_malloc_aligned(sizeof(cute_task_t) * new_cap, CUTE_SYNC_CACHELINE_SIZE, pool->mem_ctx);
-		CUTE_SYNC_MEMCPY(new_tasks, pool->tasks, sizeof(cute_task_t) * pool->task_count);
-		cute_free_aligned(pool->tasks, pool->mem_ctx);
-		pool->task_capacity = new_cap;
-		pool->tasks = new_tasks;
-	}
+	cute_threadpool_add_task_with_counter(pool, func, param, 0);
+}
 
+void cute_threadpool_add_task_with_counter(cute_threadpool_t* pool, void (*func)(void*), void* param, cute_task_counter_t* counter)
+{
 	cute_task_t task;
 	task.do_work = func;
 	task.param = param;
-	pool->tasks[pool->task_count++] = task;
+	task.counter = counter;
+	if (counter) cute_counter_increment_internal(counter);
+	cute_push_task_internal(pool, task);
+}
 
-	cute_unlock(&pool->task_mutex);
+void cute_threadpool_add_continuation(cute_threadpool_t* pool, cute_task_counter_t* dependency, void (*func)(void*), void* param, cute_task_counter_t* counter)
+{
+	CUTE_SYNC_ASSERT(dependency);
+	cute_continuation_t* continuation = (cute_continuation_t*)CUTE_SYNC_ALLOC(sizeof(cute_continuation_t), pool->mem_ctx);
+	continuation->task.do_work = func;
+	continuation->task.param = param;
+	continuation->task.counter = counter;
+	continuation->next = 0;
+	if (counter) cute_counter_increment_internal(counter);
+
+	// Hold the dependency above zero while pushing, then release it. If the dependency was already
+	// finished the release launches the continuation right away.
+	cute_counter_increment_internal(dependency);
+	cute_push_continuations_internal(dependency, continuation);
+	cute_counter_decrement_internal(pool, dependency);
+}
+
+void cute_threadpool_wait_counter(cute_threadpool_t* pool, cute_task_counter_t* counter)
+{
+	cute_threadpool_kick(pool);
+
+	while (cute_atomic_get(&counter->count)) {
+		cute_help_internal(pool);
+	}
 }
 
 void cute_threadpool_kick_and_wait(cute_threadpool_t* pool)
 {
 	cute_threadpool_kick(pool);
 
-	while (pool->task_count) {
-		cute_task_t task;
-		if (cute_try_pop_task_internal(pool, &task)) {
-			cute_semaphore_try(&pool->semaphore);
-			task.do_work(task.param);
+	// Called from within tasks of this pool, those tasks can't finish until this returns. Mark them
+	// as blocked so they aren't waited on, along with any other tasks blocked the same way. Frames
+	// further out may already be blocked by an outer call.
+	int nested = 0;
+	int blocked_count = 0;
+	for (cute_task_frame_t* frame = cute_task_frames_internal; frame; frame = frame->next) {
+		if (frame->pool != pool) continue;
+		nested = 1;
+		if (!frame->blocked) {
+			frame->blocked = 1;
+			++blocked_count;
 		}
-		CUTE_SYNC_YIELD();
+	}
+	int blocked = blocked_count * (CUTE_SYNC_BLOCKED_TASK - 1);
+	if (blocked) {
+		int pending = cute_atomic_add(&pool->pending, blocked);
+		CUTE_SYNC_ASSERT(CUTE_SYNC_BLOCKED_TASKS(pending) + blocked_count <= CUTE_SYNC_MAX_BLOCKED_TASKS);
+		(void)pending;
+	}
+
+	// Tasks popped by a worker are still pending until they finish, so wait on the pending count
+	// rather than on the deques being empty.
+	while (1) {
+		int pending = cute_atomic_get(&pool->pending);
+		if (!(nested ? CUTE_SYNC_RUNNABLE_TASKS(pending) : pending)) break;
+		cute_help_internal(pool);
+	}
+
+	if (blocked) {
+		// The frames blocked here are the innermost ones of this pool.
+		int count = blocked_count;
+		for (cute_task_frame_t* frame = cute_task_frames_internal; count; frame = frame->next) {
+			if (frame->pool == pool) {
+				frame->blocked = 0;
+				--count;
+			}
+		}
+		cute_atomic_add(&pool->pending, -blocked);
 	}
 }
 
 void cute_threadpool_kick(cute_threadpool_t* pool)
 {
-	if (pool->task_count) {
-		int count = pool->task_count < pool->thread_count ? pool->task_count : pool->thread_count;
-		for (int i = 0; i < count; ++i) {
-			cute_semaphore_post(&pool->semaphore);
-		}
+	int pending = CUTE_SYNC_RUNNABLE_TASKS(cute_atomic_get(&pool->pending));
+	int count = pending < pool->thread_count ? pending : pool->thread_count;
+	count -= cute_semaphore_value(&pool->semaphore);
+	for (int i = 0; i < count; ++i) {
+		cute_semaphore_post(&pool->semaphore);
 	}
 }
 
+int cute_threadpool_thread_count(cute_threadpool_t* pool)
+{
+	return pool->thread_count;
+}
+
+void cute_threadpool_get_stats(cute_threadpool_t* pool, int worker_index, cute_worker_stats_t* stats)
+{
+	CUTE_SYNC_ASSERT(worker_index >= 0 && worker_index <= pool->thread_count);
+	if (worker_index == pool->thread_count) {
+		stats->tasks_run = cute_atomic_get(&pool->caller_tasks_run);
+		stats->steals = 0;
+		stats->busy_seconds = 0;
+		stats->idle_seconds = 0;
+		return;
+	}
+
+	cute_worker_stats_internal_t* worker = &pool->workers[worker_index].stats;
+	stats->tasks_run = cute_atomic_get(&worker->tasks_run);
+	stats->steals = cute_atomic_get(&worker->steals);
+	cute_lock(&worker->lock);
+	stats->busy_seconds = (double)worker->busy_ticks / pool->ticks_per_second;
+	stats->idle_seconds = (double)worker->idle_ticks / pool->ticks_per_second;
+	cute_unlock(&worker->lock);
+}
+
+void cute_threadpool_reset_stats(cute_threadpool_t* pool)
+{
+	for (int i = 0; i < pool->thread_count; ++i) {
+		cute_worker_stats_internal_t* worker = &pool->workers[i].stats;
+		cute_atomic_set(&worker->tasks_run, 0);
+		cute_atomic_set(&worker->steals, 0);
+		cute_lock(&worker->lock);
+		worker->busy_ticks = 0;
+		worker->idle_ticks = 0;
+		cute_unlock(&worker->lock);
+	}
+	cute_atomic_set(&pool->caller_tasks_run, 0);
+}
+
 void cute_threadpool_destroy(cute_threadpool_t* pool)
 {
 	cute_atomic_set(&pool->running, 0);
@@ -1286,13 +2046,245 @@ void cute_threadpool_destroy(cute_threadpool_t* pool)
 		cute_thread_wait(pool->threads[i]);
 	}
 
-	cute_free_aligned(pool->tasks, pool->mem_ctx);
+	for (int i = 0; i < pool->thread_count + 1; ++i) {
+		cute_task_deque_cleanup_internal(pool->deques + i);
+	}
+	for (int i = 0; i < pool->thread_count; ++i) {
+		cute_mutex_destroy(&pool->workers[i].stats.lock);
+	}
+	cute_free_aligned(pool->deques, pool->mem_ctx);
 	cute_free_aligned(pool->threads, pool->mem_ctx);
+	cute_free_aligned(pool->workers, pool->mem_ctx);
+	cute_mutex_destroy(&pool->submit_mutex);
+	cute_semaphore_destroy(&pool->semaphore);
 	void* mem_ctx = pool->mem_ctx;
 	(void)mem_ctx;
 	CUTE_SYNC_FREE(pool, mem_ctx);
 }
 
+// Queue and ring indices only ever increase, and are compared with wrapping unsigned arithmetic.
+#define CUTE_SYNC_INDEX_DIFF(A, B) ((int)((unsigned)(A) - (unsigned)(B)))
+#define CUTE_SYNC_INDEX_ADD(A, N) ((int)((unsigned)(A) + (unsigned)(N)))
+
+static int cute_pow2_capacity_internal(int capacity)
+{
+	int pow2 = 2;
+	while (pow2 < capacity) pow2 <<= 1;
+	return pow2;
+}
+
+typedef struct cute_mpmc_queue_t
+{
+	cute_atomic_int_t enqueue_pos;
+	char pad0[CUTE_SYNC_CACHELINE_SIZE - sizeof(cute_atomic_int_t)];
+	cute_atomic_int_t dequeue_pos;
+	char pad1[CUTE_SYNC_CACHELINE_SIZE - sizeof(cute_atomic_int_t)];
+	int mask;
+	int element_size;
+	int stride;
+	unsigned char* cells; // Each cell is a sequence number followed by the element.
+	void* mem_ctx;
+} cute_mpmc_queue_t;
+
+static cute_atomic_int_t* cute_mpmc_cell_internal(cute_mpmc_queue_t* queue, int pos)
+{
+	return (cute_atomic_int_t*)(queue->cells + ((unsigned)pos & (unsigned)queue->mask) * queue->stride);
+}
+
+cute_mpmc_queue_t* cute_mpmc_queue_create(int capacity, int element_size, void* mem_ctx)
+{
+	capacity = cute_pow2_capacity_internal(capacity);
+	cute_mpmc_queue_t* queue = (cute_mpmc_queue_t*)cute_malloc_aligned(sizeof(cute_mpmc_queue_t), CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
+	if (!queue) return 0;
+	queue->mask = capacity - 1;
+	queue->element_size = element_size;
+	queue->stride = (int)CUTE_SYNC_ALIGN_PTR(sizeof(cute_atomic_int_t) + element_size, sizeof(void*));
+	queue->cells = (unsigned char*)cute_malloc_aligned(queue->stride * capacity, CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
+	queue->mem_ctx = mem_ctx;
+	for (int i = 0; i < capacity; ++i) {
+		cute_atomic_set(cute_mpmc_cell_internal(queue, i), i);
+	}
+	cute_atomic_set(&queue->enqueue_pos, 0);
+	cute_atomic_set(&queue->dequeue_pos, 0);
+	return queue;
+}
+
+void cute_mpmc_queue_destroy(cute_mpmc_queue_t* queue)
+{
+	void* mem_ctx = queue->mem_ctx;
+	(void)mem_ctx;
+	cute_free_aligned(queue->cells, mem_ctx);
+	cute_free_aligned(queue, mem_ctx);
+}
+
+int cute_mpmc_queue_try_push_many(cute_mpmc_queue_t* queue, const void* elements, int count)
+{
+	if (count <= 0) return 0;
+
+	while (1) {
+		// Count how many cells in a row are free for this lap, then claim all of them at once.
+		int pos = cute_atomic_get(&queue->enqueue_pos);
+		int n = 0;
+		int diff = 0;
+		while (n < count) {
+			int seq = cute_atomic_get(cute_mpmc_cell_internal(queue, CUTE_SYNC_INDEX_ADD(pos, n)));
+			diff = CUTE_SYNC_INDEX_DIFF(seq, CUTE_SYNC_INDEX_ADD(pos, n));
+			if (diff) break;
+			++n;
+		}
+
+		if (!n) {
+			if (diff < 0) return 0; // Full.
+			continue; // Another producer moved `enqueue_pos` first.
+		}
+
+		if (cute_atomic_cas(&queue->enqueue_pos, pos, CUTE_SYNC_INDEX_ADD(pos, n))) {
+			for (int i = 0; i < n; ++i) {
+				cute_atomic_int_t* cell = cute_mpmc_cell_internal(queue, CUTE_SYNC_INDEX_ADD(pos, i));
+				CUTE_SYNC_MEMCPY(cell + 1, (const unsigned char*)elements + i * queue->element_size, queue->element_size);
+				cute_atomic_set(cell, CUTE_SYNC_INDEX_ADD(pos, i + 1));
+			}
+			return n;
+		}
+	}
+}
+
+int cute_mpmc_queue_try_pop_many(cute_mpmc_queue_t* queue, void* elements, int count)
+{
+	if (count <= 0) return 0;
+
+	while (1) {
+		int pos = cute_atomic_get(&queue->dequeue_pos);
+		int n = 0;
+		int diff = 0;
+		while (n < count) {
+			int seq = cute_atomic_get(cute_mpmc_cell_internal(queue, CUTE_SYNC_INDEX_ADD(pos, n)));
+			diff = CUTE_SYNC_INDEX_DIFF(seq, CUTE_SYNC_INDEX_ADD(pos, n + 1));
+			if (diff) break;
+			++n;
+		}
+
+		if (!n) {
+			if (diff < 0) return 0; // Empty.
+			continue; // Another consumer moved `dequeue_pos` first.
+		}
+
+		if (cute_atomic_cas(&queue->dequeue_pos, pos, CUTE_SYNC_INDEX_ADD(pos, n))) {
+			for (int i = 0; i < n; ++i) {
+				cute_atomic_int_t* cell = cute_mpmc_cell_internal(queue, CUTE_SYNC_INDEX_ADD(pos, i));
+				CUTE_SYNC_MEMCPY((unsigned char*)elements + i * queue->element_size, cell + 1, queue->element_size);
+				cute_atomic_set(cell, CUTE_SYNC_INDEX_ADD(pos, i + queue->mask + 1));
+			}
+			return n;
+		}
+	}
+}
+
+int cute_mpmc_queue_try_push(cute_mpmc_queue_t* queue, const void* element)
+{
+	return cute_mpmc_queue_try_push_many(queue, element, 1);
+}
+
+int cute_mpmc_queue_try_pop(cute_mpmc_queue_t* queue, void* element)
+{
+	return cute_mpmc_queue_try_pop_many(queue, element, 1);
+}
+
+typedef struct cute_spsc_ring_t
+{
+	// Consumer side.
+	cute_atomic_int_t head;
+	int cached_tail;
+	char pad0[CUTE_SYNC_CACHELINE_SIZE - sizeof(cute_atomic_int_t) - sizeof(int)];
+
+	// Producer side.
+	cute_atomic_int_t tail;
+	int cached_head;
+	char pad1[CUTE_SYNC_CACHELINE_SIZE - sizeof(cute_atomic_int_t) - sizeof(int)];
+
+	int mask;
+	int element_size;
+	unsigned char* data;
+	void* mem_ctx;
+} cute_spsc_ring_t;
+
+cute_spsc_ring_t* cute_spsc_ring_create(int capacity, int element_size, void* mem_ctx)
+{
+	capacity = cute_pow2_capacity_internal(capacity);
+	cute_spsc_ring_t* ring = (cute_spsc_ring_t*)cute_malloc_aligned(sizeof(cute_spsc_ring_t), CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
+	if (!ring) return 0;
+	cute_atomic_set(&ring->head, 0);
+	cute_atomic_set(&ring->tail, 0);
+	ring->cached_tail = 0;
+	ring->cached_head = 0;
+	ring->mask = capacity - 1;
+	ring->element_size = element_size;
+	ring->data = (unsigned char*)cute_malloc_aligned(element_size * capacity, CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
+	ring->mem_ctx = mem_ctx;
+	return ring;
+}
+
+void cute_spsc_ring_destroy(cute_spsc_ring_t* ring)
+{
+	void* mem_ctx = ring->mem_ctx;
+	(void)mem_ctx;
+	cute_free_aligned(ring->data, mem_ctx);
+	cute_free_aligned(ring, mem_ctx);
+}
+
+int cute_spsc_ring_try_push_many(cute_spsc_ring_t* ring, const void* elements, int count)
+{
+	int capacity = ring->mask + 1;
+	int tail = cute_atomic_get(&ring->tail);
+	int room = capacity - CUTE_SYNC_INDEX_DIFF(tail, ring->cached_head);
+	if (room < count) {
+		ring->cached_head = cute_atomic_get(&ring->head);
+		room = capacity - CUTE_SYNC_INDEX_DIFF(tail, ring->cached_head);
+	}
+
+	int n = count < room ? count : room;
+	if (n <= 0) return 0;
+
+	// Copy in at most two pieces, split where the ring wraps around.
+	int index = (int)((unsigned)tail & (unsigned)ring->mask);
+	int first = capacity - index < n ? capacity - index : n;
+	CUTE_SYNC_MEMCPY(ring->data + index * ring->element_size, elements, first * ring->element_size);
+	CUTE_SYNC_MEMCPY(ring->data, (const unsigned char*)elements + first * ring->element_size, (n - first) * ring->element_size);
+	cute_atomic_set(&ring->tail, CUTE_SYNC_INDEX_ADD(tail, n));
+	return n;
+}
+
+int cute_spsc_ring_try_pop_many(cute_spsc_ring_t* ring, void* elements, int count)
+{
+	int capacity = ring->mask + 1;
+	int head = cute_atomic_get(&ring->head);
+	int available = CUTE_SYNC_INDEX_DIFF(ring->cached_tail, head);
+	if (available < count) {
+		ring->cached_tail = cute_atomic_get(&ring->tail);
+		available = CUTE_SYNC_INDEX_DIFF(ring->cached_tail, head);
+	}
+
+	int n = count < available ? count : available;
+	if (n <= 0) return 0;
+
+	int index = (int)((unsigned)head & (unsigned)ring->mask);
+	int first = capacity - index < n ? capacity - index : n;
+	CUTE_SYNC_MEMCPY(elements, ring->data + index * ring->element_size, first * ring->element_size);
+	CUTE_SYNC_MEMCPY((unsigned char*)elements + first * ring->element_size, ring->data, (n - first) * ring->element_size);
+	cute_atomic_set(&ring->head, CUTE_SYNC_INDEX_ADD(head, n));
+	return n;
+}
+
+int cute_spsc_ring_try_push(cute_spsc_ring_t* ring, const void* element)
+{
+	return cute_spsc_ring_try_push_many(ring, element, 1);
+}
+
+int cute_spsc_ring_try_pop(cute_spsc_ring_t* ring, void* element)
+{
+	return cute_spsc_ring_try_pop_many(ring, element, 1);
+}
+
 #endif // CUTE_SYNC_IMPLEMENTATION_ONCE
 #endif // CUTE_SYNC_IMPLEMENTATION
 
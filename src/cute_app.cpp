@@ -21,6 +21,7 @@
 
 #include <cute_app.h>
 #include <cute_alloc.h>
+#include <cute_arena.h>
 #include <cute_audio.h>
 #include <cute_concurrency.h>
 #include <cute_file_system.h>
@@ -184,6 +185,9 @@ error_t app_make(const char* window_title, int x, int y, int w, int h, uint32_t
 	if (num_threads_to_spawn) {
 		app->threadpool = threadpool_create(num_threads_to_spawn, user_allocator_context);
 	}
+	app->main_thread_queue = completion_queue_create(user_allocator_context);
+	app->frame_arena = arena_make(0, user_allocator_context);
+	app->ecs_world = ecs_world_make(app->threadpool, user_allocator_context);
 
 	error_t err = file_system_init(argv0);
 	if (err.is_error()) {
@@ -215,10 +219,10 @@ void app_destroy()
 	SDL_DestroyWindow(app->window);
 	SDL_Quit();
 	cute_threadpool_destroy(app->threadpool);
+	completion_queue_destroy(app->main_thread_queue);
+	arena_destroy(app->frame_arena);
 	audio_system_destroy(app->audio_system);
-	int schema_count = app->entity_parsed_schemas.count();
-	kv_t** schemas = app->entity_parsed_schemas.items();
-	for (int i = 0; i < schema_count; ++i) kv_destroy(schemas[i]);
+	ecs_world_destroy(app->ecs_world);
 	if (app->ase_cache) {
 		aseprite_cache_destroy(app->ase_cache);
 		batch_destroy(app->ase_batch);
@@ -248,7 +252,9 @@ void app_stop_running()
 void app_update(float dt)
 {
 	app->dt = dt;
+	arena_reset(app->frame_arena);
 	pump_input_msgs();
+	completion_queue_drain(app->main_thread_queue);
 	if (app->audio_system) {
 		audio_system_update(app->audio_system, dt);
 #ifdef CUTE_EMSCRIPTEN
@@ -402,6 +408,16 @@ strpool_t* app_get_strpool()
 	return app->strpool;
 }
 
+completion_queue_t* app_main_thread_queue()
+{
+	return app->main_thread_queue;
+}
+
+arena_t* app_frame_arena()
+{
+	return app->frame_arena;
+}
+
 static void s_quad(float x, float y, float sx, float sy, float* out)
 {
 	struct vertex_t
@@ -0,0 +1,162 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute_arena.h>
+#include <cute_alloc.h>
+#include <cute_c_runtime.h>
+
+namespace cute
+{
+
+#define CUTE_ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+struct arena_block_t
+{
+	arena_block_t* next;
+	size_t size;
+};
+
+struct arena_t
+{
+	allocator_t allocator; // Must come first, so the arena itself works as a `user_allocator_context`.
+	size_t block_size = 0;
+	arena_block_t* first = NULL;
+	arena_block_t* current = NULL; // NULL only while no blocks were allocated yet.
+	size_t offset = 0; // Offset into `current`.
+	void* mem_ctx = NULL;
+};
+
+static void* s_alloc(size_t size, void* udata)
+{
+	return arena_alloc((arena_t*)udata, size);
+}
+
+static void s_free(void* ptr, void* udata)
+{
+	// Arena memory is reclaimed all at once by `arena_reset` or `arena_restore`.
+}
+
+static uint8_t* s_block_data(arena_block_t* block)
+{
+	return (uint8_t*)(block + 1);
+}
+
+static uint8_t* s_try_alloc(arena_block_t* block, size_t offset, size_t size, size_t alignment)
+{
+	uintptr_t base = (uintptr_t)s_block_data(block);
+	uintptr_t p = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (p + size > base + block->size) return NULL;
+	return (uint8_t*)p;
+}
+
+arena_t* arena_make(size_t block_size, void* user_allocator_context)
+{
+	arena_t* arena = CUTE_NEW(arena_t, user_allocator_context);
+	arena->allocator.alloc_fn = s_alloc;
+	arena->allocator.free_fn = s_free;
+	arena->allocator.udata = arena;
+	arena->block_size = block_size ? block_size : CUTE_ARENA_DEFAULT_BLOCK_SIZE;
+	arena->mem_ctx = user_allocator_context;
+	return arena;
+}
+
+void arena_destroy(arena_t* arena)
+{
+	arena_block_t* block = arena->first;
+	while (block) {
+		arena_block_t* next = block->next;
+		CUTE_FREE(block, arena->mem_ctx);
+		block = next;
+	}
+	void* mem_ctx = arena->mem_ctx;
+	arena->~arena_t();
+	CUTE_FREE(arena, mem_ctx);
+}
+
+void* arena_alloc(arena_t* arena, size_t size, size_t alignment)
+{
+	CUTE_ASSERT(alignment && !(alignment & (alignment - 1)));
+	arena_block_t* block = arena->current;
+	size_t offset = arena->offset;
+	uint8_t* p = block ? s_try_alloc(block, offset, size, alignment) : NULL;
+
+	// Blocks left over from before a reset come next, as long as they're big enough.
+	if (!p && block && block->next) {
+		p = s_try_alloc(block->next, 0, size, alignment);
+		if (p) block = block->next;
+	}
+
+	if (!p) {
+		size_t block_size = size + alignment > arena->block_size ? size + alignment : arena->block_size;
+		arena_block_t* new_block = (arena_block_t*)CUTE_ALLOC(sizeof(arena_block_t) + block_size, arena->mem_ctx);
+		if (!new_block) return NULL;
+		new_block->size = block_size;
+		if (block) {
+			new_block->next = block->next;
+			block->next = new_block;
+		} else {
+			new_block->next = NULL;
+			arena->first = new_block;
+		}
+		block = new_block;
+		p = s_try_alloc(block, 0, size, alignment);
+	}
+
+	arena->current = block;
+	arena->offset = (size_t)(p + size - s_block_data(block));
+	return p;
+}
+
+void arena_reset(arena_t* arena)
+{
+	arena->current = arena->first;
+	arena->offset = 0;
+}
+
+arena_mark_t arena_save(arena_t* arena)
+{
+	arena_mark_t mark;
+	mark.block = arena->current;
+	mark.offset = arena->offset;
+	return mark;
+}
+
+void arena_restore(arena_t* arena, arena_mark_t mark)
+{
+	arena->current = mark.block ? (arena_block_t*)mark.block : arena->first;
+	arena->offset = mark.offset;
+}
+
+struct arena_scratch_t
+{
+	arena_t* arena = NULL;
+	~arena_scratch_t() { if (arena) arena_destroy(arena); }
+};
+
+static thread_local arena_scratch_t s_scratch;
+
+arena_t* arena_scratch()
+{
+	if (!s_scratch.arena) s_scratch.arena = arena_make();
+	return s_scratch.arena;
+}
+
+}
@@ -21,6 +21,7 @@
 
 #include <cute_batch.h>
 #include <cute_alloc.h>
+#include <cute_arena.h>
 #include <cute_array.h>
 #include <cute_file_system.h>
 #include <cute_lru_cache.h>
@@ -722,7 +723,9 @@ void batch_circle(batch_t* b, v2 p, float r, int iters, color_t c)
 void batch_circle_line(batch_t* batch, v2 p, float r, int iters, float thickness, color_t color, bool antialias)
 {
 	if (antialias) {
-		array<v2> verts(iters, NULL);
+		arena_t* scratch = arena_scratch();
+		arena_mark_t mark = arena_save(scratch);
+		array<v2> verts(iters, scratch);
 		v2 p0 = v2(p.x + r, p.y);
 		verts.add(p0);
 
@@ -735,6 +738,7 @@ void batch_circle_line(batch_t* batch, v2 p, float r, int iters, float thickness
 		}
 
 		batch_polyline(batch, verts.data(), verts.size(), thickness, color, true, true);
+		arena_restore(scratch, mark);
 	} else {
 		float half_thickness = thickness * 0.5f;
 		v2 p0 = v2(p.x + r - half_thickness, p.y);
@@ -796,9 +800,12 @@ static void s_circle_arc_line_aa(array<v2>* verts, v2 p, v2 center_of_arc, float
 void batch_circle_arc_line(batch_t* batch, v2 p, v2 center_of_arc, float range, int iters, float thickness, color_t color, bool antialias)
 {
 	if (antialias) {
-		array<v2> verts(iters, NULL);
+		arena_t* scratch = arena_scratch();
+		arena_mark_t mark = arena_save(scratch);
+		array<v2> verts(iters + 1, scratch);
 		s_circle_arc_line_aa(&verts, p, center_of_arc, range, iters, thickness, color);
 		batch_polyline(batch, verts.data(), verts.size(), thickness, color, false, true, 3);
+		arena_restore(scratch, mark);
 	} else {
 		float r = len(center_of_arc - p);
 		v2 d = norm(center_of_arc - p);
@@ -838,10 +845,13 @@ void batch_capsule(batch_t* batch, v2 a, v2 b, float r, int iters, color_t c)
 void batch_capsule_line(batch_t* batch, v2 a, v2 b, float r, int iters, float thickness, color_t c, bool antialias)
 {
 	if (antialias) {
-		array<v2> verts(iters * 2 + 2, NULL);
+		arena_t* scratch = arena_scratch();
+		arena_mark_t mark = arena_save(scratch);
+		array<v2> verts(iters * 2 + 2, scratch);
 		s_circle_arc_line_aa(&verts, a, a + norm(a - b) * r, CUTE_PI, iters, thickness, c);
 		s_circle_arc_line_aa(&verts, b, b + norm(b - a) * r, CUTE_PI, iters, thickness, c);
 		batch_polyline(batch, verts.data(), verts.count(), thickness, c, true, true, 0);
+		arena_restore(scratch, mark);
 	} else {
 		batch_circle_arc_line(batch, a, a + norm(a - b) * r, CUTE_PI, iters, thickness, c);
 		batch_circle_arc_line(batch, b, b + norm(b - a) * r, CUTE_PI, iters, thickness, c);
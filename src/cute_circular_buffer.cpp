@@ -22,15 +22,89 @@
 #include <cute_circular_buffer.h>
 #include <cute_alloc.h>
 #include <cute_c_runtime.h>
+#include <cute_math.h>
 #include <cute_concurrency.h>
 
 namespace cute
 {
 	
+// Indices run from 0 to twice the capacity before wrapping, so a full buffer and an empty buffer
+// can be told apart without a shared size counter. Each index is only ever written by one side.
+
+static CUTE_INLINE int s_used(const circular_buffer_t* buffer, int index0, int index1)
+{
+	int used = index1 - index0;
+	return used < 0 ? used + buffer->capacity * 2 : used;
+}
+
+static CUTE_INLINE int s_advance(const circular_buffer_t* buffer, int index, int size)
+{
+	index += size;
+	return index >= buffer->capacity * 2 ? index - buffer->capacity * 2 : index;
+}
+
+static CUTE_INLINE int s_offset(const circular_buffer_t* buffer, int index)
+{
+	return index >= buffer->capacity ? index - buffer->capacity : index;
+}
+
+// Free bytes as seen by the producer. Only touches the consumer's cache line when the cached
+// consumer index says there isn't enough room.
+static int s_room(circular_buffer_t* buffer, int index1, int size)
+{
+	int room = buffer->capacity - s_used(buffer, buffer->cached_index0, index1);
+	if (room < size) {
+		buffer->cached_index0 = atomic_get(&buffer->index0);
+		room = buffer->capacity - s_used(buffer, buffer->cached_index0, index1);
+	}
+	return room;
+}
+
+// Pushed bytes as seen by the consumer.
+static int s_available(circular_buffer_t* buffer, int index0, int size)
+{
+	int available = s_used(buffer, index0, buffer->cached_index1);
+	if (available < size) {
+		buffer->cached_index1 = atomic_get(&buffer->index1);
+		available = s_used(buffer, index0, buffer->cached_index1);
+	}
+	return available;
+}
+
+// Stores the new index for the other side to see. An add is a full barrier on every backend, where
+// a set may only be an acquire barrier, so the bytes copied in or out before can't move past it.
+static CUTE_INLINE void s_publish(atomic_int_t* index, int old_index, int new_index)
+{
+	atomic_add(index, new_index - old_index);
+}
+
+static void s_copy_in(circular_buffer_t* buffer, int index, const void* data, int size)
+{
+	int offset = s_offset(buffer, index);
+	int bytes_to_end = buffer->capacity - offset;
+	if (size > bytes_to_end) {
+		CUTE_MEMCPY(buffer->data + offset, data, bytes_to_end);
+		CUTE_MEMCPY(buffer->data, (const uint8_t*)data + bytes_to_end, size - bytes_to_end);
+	} else {
+		CUTE_MEMCPY(buffer->data + offset, data, size);
+	}
+}
+
+static void s_copy_out(const circular_buffer_t* buffer, int index, void* data, int size)
+{
+	int offset = s_offset(buffer, index);
+	int bytes_to_end = buffer->capacity - offset;
+	if (size > bytes_to_end) {
+		CUTE_MEMCPY(data, buffer->data + offset, bytes_to_end);
+		CUTE_MEMCPY((uint8_t*)data + bytes_to_end, buffer->data, size - bytes_to_end);
+	} else {
+		CUTE_MEMCPY(data, buffer->data + offset, size);
+	}
+}
+
 circular_buffer_t circular_buffer_make(int initial_size_in_bytes, void* user_allocator_context)
 {
 	circular_buffer_t buffer;
-	buffer.size_left.i = initial_size_in_bytes;
 	buffer.capacity = initial_size_in_bytes;
 	buffer.data = (uint8_t*)CUTE_ALLOC(initial_size_in_bytes, user_allocator_context);
 	buffer.user_allocator_context = user_allocator_context;
@@ -45,74 +119,117 @@ void circular_buffer_free(circular_buffer_t* buffer)
 
 void circular_buffer_reset(circular_buffer_t* buffer)
 {
-	buffer->index0 = 0;
-	buffer->index1 = 0;
-	buffer->size_left.i = buffer->capacity;
+	atomic_set(&buffer->index0, 0);
+	atomic_set(&buffer->index1, 0);
+	buffer->cached_index0 = 0;
+	buffer->cached_index1 = 0;
 }
 
 int circular_buffer_push(circular_buffer_t* buffer, const void* data, int size)
 {
-	if (atomic_get(&buffer->size_left) < size) {
+	int index1 = buffer->index1.i;
+	if (s_room(buffer, index1, size) < size) {
 		return -1;
 	}
 
-	int bytes_to_end = buffer->capacity - buffer->index1;
-	if (size > bytes_to_end) {
-		CUTE_MEMCPY(buffer->data + buffer->index1, data, bytes_to_end);
-		CUTE_MEMCPY(buffer->data, (uint8_t*)data + bytes_to_end, size - bytes_to_end);
-		buffer->index1 = (size - bytes_to_end) % buffer->capacity;
-	} else {
-		CUTE_MEMCPY(buffer->data + buffer->index1, data, size);
-		buffer->index1 = (buffer->index1 + size) % buffer->capacity;
-	}
-
-	atomic_add(&buffer->size_left, -size);
+	s_copy_in(buffer, index1, data, size);
+	s_publish(&buffer->index1, index1, s_advance(buffer, index1, size));
 
 	return 0;
 }
 
 int circular_buffer_pull(circular_buffer_t* buffer, void* data, int size)
 {
-	if (buffer->capacity - atomic_get(&buffer->size_left) < size) {
+	int index0 = buffer->index0.i;
+	if (s_available(buffer, index0, size) < size) {
 		return -1;
 	}
 
-	int bytes_to_end = buffer->capacity - buffer->index0;
-	if (size > bytes_to_end) {
-		CUTE_MEMCPY(data, buffer->data + buffer->index0, bytes_to_end);
-		CUTE_MEMCPY((uint8_t*)data + bytes_to_end, buffer->data, size - bytes_to_end);
-		buffer->index0 = (size - bytes_to_end) % buffer->capacity;
-	} else {
-		CUTE_MEMCPY(data, buffer->data + buffer->index0, size);
-		buffer->index0 = (buffer->index0 + size) % buffer->capacity;
-	}
-
-	atomic_add(&buffer->size_left, size);
+	s_copy_out(buffer, index0, data, size);
+	s_publish(&buffer->index0, index0, s_advance(buffer, index0, size));
 
 	return 0;
 }
 
+int circular_buffer_push_batch(circular_buffer_t* buffer, const void* elements, int element_size, int count)
+{
+	int index1 = buffer->index1.i;
+	int room = s_room(buffer, index1, element_size * count);
+	int n = min(room / element_size, count);
+	if (n <= 0) return 0;
+
+	s_copy_in(buffer, index1, elements, element_size * n);
+	s_publish(&buffer->index1, index1, s_advance(buffer, index1, element_size * n));
+
+	return n;
+}
+
+int circular_buffer_pull_batch(circular_buffer_t* buffer, void* elements, int element_size, int count)
+{
+	int index0 = buffer->index0.i;
+	int available = s_available(buffer, index0, element_size * count);
+	int n = min(available / element_size, count);
+	if (n <= 0) return 0;
+
+	s_copy_out(buffer, index0, elements, element_size * n);
+	s_publish(&buffer->index0, index0, s_advance(buffer, index0, element_size * n));
+
+	return n;
+}
+
+int circular_buffer_reserve_push(circular_buffer_t* buffer, void** span)
+{
+	int index1 = buffer->index1.i;
+	int offset = s_offset(buffer, index1);
+	int bytes_to_end = buffer->capacity - offset;
+	int size = min(s_room(buffer, index1, bytes_to_end), bytes_to_end);
+	*span = buffer->data + offset;
+	return size;
+}
+
+void circular_buffer_commit_push(circular_buffer_t* buffer, int size)
+{
+	int index1 = buffer->index1.i;
+	CUTE_ASSERT(size >= 0 && size <= buffer->capacity - s_used(buffer, buffer->cached_index0, index1));
+	s_publish(&buffer->index1, index1, s_advance(buffer, index1, size));
+}
+
+int circular_buffer_reserve_pull(circular_buffer_t* buffer, void** span)
+{
+	int index0 = buffer->index0.i;
+	int offset = s_offset(buffer, index0);
+	int bytes_to_end = buffer->capacity - offset;
+	int size = min(s_available(buffer, index0, bytes_to_end), bytes_to_end);
+	*span = buffer->data + offset;
+	return size;
+}
+
+void circular_buffer_commit_pull(circular_buffer_t* buffer, int size)
+{
+	int index0 = buffer->index0.i;
+	CUTE_ASSERT(size >= 0 && size <= s_used(buffer, index0, buffer->cached_index1));
+	s_publish(&buffer->index0, index0, s_advance(buffer, index0, size));
+}
+
 int circular_buffer_grow(circular_buffer_t* buffer, int new_size_in_bytes)
 {
-	uint8_t* old_data = buffer->data;
+	int index0 = atomic_get(&buffer->index0);
+	int used = s_used(buffer, index0, atomic_get(&buffer->index1));
+	if (new_size_in_bytes < used) return -1;
+
 	uint8_t* new_data = (uint8_t*)CUTE_ALLOC(new_size_in_bytes, buffer->user_allocator_context);
 	if (!new_data) return -1;
 
-	int index0 = buffer->index0;
-	int index1 = buffer->index1;
+	// Unwrap the pushed bytes to the front of the new buffer.
+	s_copy_out(buffer, index0, new_data, used);
 
-	if (index0 < index1) {
-		CUTE_MEMCPY(new_data + index0, old_data + index0, index1 - index0);
-	} else {
-		CUTE_MEMCPY(new_data, old_data, index1);
-		int offset_from_end = buffer->capacity - index0;
-		CUTE_MEMCPY(new_data + new_size_in_bytes - offset_from_end, old_data + index0, offset_from_end);
-	}
-
-	CUTE_FREE(old_data, buffer->user_allocator_context);
+	CUTE_FREE(buffer->data, buffer->user_allocator_context);
 	buffer->data = new_data;
-	atomic_add(&buffer->size_left, new_size_in_bytes - buffer->capacity);
 	buffer->capacity = new_size_in_bytes;
+	atomic_set(&buffer->index0, 0);
+	atomic_set(&buffer->index1, used);
+	buffer->cached_index0 = 0;
+	buffer->cached_index1 = used;
 
 	return 0;
 }
@@ -21,6 +21,7 @@
 
 #include <cute_concurrency.h>
 #include <cute_alloc.h>
+#include <cute_c_runtime.h>
 
 #include <SDL.h>
 
@@ -30,8 +31,8 @@
 #else
 #   define CUTE_SYNC_SDL
 #endif
-#define CUTE_THREAD_ALLOC CUTE_ALLOC
-#define CUTE_THREAD_FREE CUTE_FREE
+#define CUTE_SYNC_ALLOC CUTE_ALLOC
+#define CUTE_SYNC_FREE CUTE_FREE
 #include <cute/cute_sync.h>
 
 namespace cute
@@ -142,6 +143,11 @@ error_t thread_wait(thread_t* thread)
 	return error_make(cute_thread_wait(thread), NULL);
 }
 
+error_t thread_set_affinity(int core_index)
+{
+	return cute_thread_set_affinity(core_index) ? error_success() : error_failure("Unable to pin the thread to the core.");
+}
+
 int core_count()
 {
 	return cute_core_count();
@@ -176,7 +182,7 @@ int atomic_get(atomic_int_t* atomic)
 
 error_t atomic_cas(atomic_int_t* atomic, int expected, int value)
 {
-	return error_make(cute_atomic_cas(atomic, expected, value), NULL);
+	return cute_atomic_cas(atomic, expected, value) ? error_success() : error_failure(NULL);
 }
 
 void* atomic_ptr_set(void** atomic, void* value)
@@ -191,7 +197,7 @@ void* atomic_ptr_get(void** atomic)
 
 error_t atomic_ptr_cas(void** atomic, void* expected, void* value)
 {
-	return error_make(cute_atomic_ptr_cas(atomic, expected, value), NULL);
+	return cute_atomic_ptr_cas(atomic, expected, value) ? error_success() : error_failure(NULL);
 }
 
 rw_lock_t rw_lock_create()
@@ -229,9 +235,286 @@ threadpool_t* threadpool_create(int thread_count, void* user_allocator_context)
 	return cute_threadpool_create(thread_count, user_allocator_context);
 }
 
-void threadpool_add_task(threadpool_t* pool, task_fn* task, void* param)
+void threadpool_add_task(threadpool_t* pool, task_fn* task, void* param, task_counter_t* counter)
+{
+	cute_threadpool_add_task_with_counter(pool, task, param, counter);
+}
+
+void threadpool_add_continuation(threadpool_t* pool, task_counter_t* dependency, task_fn* task, void* param, task_counter_t* counter)
+{
+	cute_threadpool_add_continuation(pool, dependency, task, param, counter);
+}
+
+void threadpool_wait_counter(threadpool_t* pool, task_counter_t* counter)
+{
+	cute_threadpool_wait_counter(pool, counter);
+}
+
+int threadpool_thread_count(threadpool_t* pool)
+{
+	return cute_threadpool_thread_count(pool);
+}
+
+threadpool_t* threadpool_create(int thread_count, const threadpool_options_t& options, void* user_allocator_context)
+{
+	return cute_threadpool_create_with_options(thread_count, &options, user_allocator_context);
+}
+
+worker_stats_t threadpool_get_stats(threadpool_t* pool, int worker_index)
+{
+	worker_stats_t stats;
+	cute_threadpool_get_stats(pool, worker_index, &stats);
+	return stats;
+}
+
+void threadpool_reset_stats(threadpool_t* pool)
+{
+	cute_threadpool_reset_stats(pool);
+}
+
+struct parallel_job_t
+{
+	atomic_int_t next_chunk;
+	int chunk_count;
+	int begin;
+	int end;
+	int grain;
+	parallel_for_fn* for_fn;
+	parallel_reduce_fn* reduce_fn;
+	uint8_t* partials;
+	size_t result_size;
+	void* udata;
+};
+
+// Chunks are handed out through an atomic index, so whichever threads are free pick up the remaining
+// work, and no per-chunk task needs to be queued.
+static void s_parallel_run_chunks(parallel_job_t* job)
+{
+	while (1) {
+		int chunk = atomic_add(&job->next_chunk, 1);
+		if (chunk >= job->chunk_count) break;
+		int begin = job->begin + chunk * job->grain;
+		int end = job->end - begin > job->grain ? begin + job->grain : job->end;
+		if (job->reduce_fn) job->reduce_fn(begin, end, job->partials + job->result_size * chunk, job->udata);
+		else job->for_fn(begin, end, job->udata);
+	}
+}
+
+static void s_parallel_task(void* param)
+{
+	s_parallel_run_chunks((parallel_job_t*)param);
+}
+
+static int s_parallel_grain(threadpool_t* pool, int count, int grain)
+{
+	if (grain > 0) return grain;
+	if (!pool) return count;
+	// A few chunks per thread (counting the caller) keeps threads busy when chunks take uneven time.
+	int chunks = (threadpool_thread_count(pool) + 1) * 4;
+	grain = (count + chunks - 1) / chunks;
+	return grain > 0 ? grain : 1;
+}
+
+static void s_parallel_run(threadpool_t* pool, parallel_job_t* job)
+{
+	task_counter_t counter = { };
+	int helpers = job->chunk_count - 1;
+	if (helpers > threadpool_thread_count(pool)) helpers = threadpool_thread_count(pool);
+	for (int i = 0; i < helpers; ++i) {
+		threadpool_add_task(pool, s_parallel_task, job, &counter);
+	}
+	threadpool_kick(pool);
+	s_parallel_run_chunks(job);
+	threadpool_wait_counter(pool, &counter);
+}
+
+void parallel_for(threadpool_t* pool, int begin, int end, int grain, parallel_for_fn* fn, void* udata)
+{
+	int count = end - begin;
+	if (count <= 0) return;
+	grain = s_parallel_grain(pool, count, grain);
+	if (!pool || count <= grain) {
+		fn(begin, end, udata);
+		return;
+	}
+
+	parallel_job_t job;
+	job.next_chunk = atomic_zero();
+	job.chunk_count = (count + grain - 1) / grain;
+	job.begin = begin;
+	job.end = end;
+	job.grain = grain;
+	job.for_fn = fn;
+	job.reduce_fn = NULL;
+	job.partials = NULL;
+	job.result_size = 0;
+	job.udata = udata;
+	s_parallel_run(pool, &job);
+}
+
+void parallel_reduce(threadpool_t* pool, int begin, int end, int grain, void* result, size_t result_size, parallel_reduce_fn* fn, parallel_combine_fn* combine, void* udata)
+{
+	int count = end - begin;
+	if (count <= 0) return;
+	grain = s_parallel_grain(pool, count, grain);
+	if (!pool || count <= grain) {
+		fn(begin, end, result, udata);
+		return;
+	}
+
+	parallel_job_t job;
+	job.next_chunk = atomic_zero();
+	job.chunk_count = (count + grain - 1) / grain;
+	job.begin = begin;
+	job.end = end;
+	job.grain = grain;
+	job.for_fn = NULL;
+	job.reduce_fn = fn;
+	job.partials = (uint8_t*)CUTE_ALLOC(result_size * job.chunk_count, pool->mem_ctx);
+	job.result_size = result_size;
+	job.udata = udata;
+	for (int i = 0; i < job.chunk_count; ++i) {
+		CUTE_MEMCPY(job.partials + result_size * i, result, result_size);
+	}
+
+	s_parallel_run(pool, &job);
+
+	for (int i = 0; i < job.chunk_count; ++i) {
+		combine(result, job.partials + result_size * i, udata);
+	}
+	CUTE_FREE(job.partials, pool->mem_ctx);
+}
+
+mpmc_queue_t* mpmc_queue_create(int capacity, int element_size, void* user_allocator_context)
+{
+	return cute_mpmc_queue_create(capacity, element_size, user_allocator_context);
+}
+
+void mpmc_queue_destroy(mpmc_queue_t* queue)
+{
+	cute_mpmc_queue_destroy(queue);
+}
+
+bool mpmc_queue_try_push(mpmc_queue_t* queue, const void* element)
+{
+	return !!cute_mpmc_queue_try_push(queue, element);
+}
+
+bool mpmc_queue_try_pop(mpmc_queue_t* queue, void* element)
+{
+	return !!cute_mpmc_queue_try_pop(queue, element);
+}
+
+int mpmc_queue_try_push_many(mpmc_queue_t* queue, const void* elements, int count)
+{
+	return cute_mpmc_queue_try_push_many(queue, elements, count);
+}
+
+int mpmc_queue_try_pop_many(mpmc_queue_t* queue, void* elements, int count)
+{
+	return cute_mpmc_queue_try_pop_many(queue, elements, count);
+}
+
+spsc_ring_t* spsc_ring_create(int capacity, int element_size, void* user_allocator_context)
+{
+	return cute_spsc_ring_create(capacity, element_size, user_allocator_context);
+}
+
+void spsc_ring_destroy(spsc_ring_t* ring)
+{
+	cute_spsc_ring_destroy(ring);
+}
+
+bool spsc_ring_try_push(spsc_ring_t* ring, const void* element)
+{
+	return !!cute_spsc_ring_try_push(ring, element);
+}
+
+bool spsc_ring_try_pop(spsc_ring_t* ring, void* element)
 {
-	cute_threadpool_add_task(pool, task, param);
+	return !!cute_spsc_ring_try_pop(ring, element);
+}
+
+int spsc_ring_try_push_many(spsc_ring_t* ring, const void* elements, int count)
+{
+	return cute_spsc_ring_try_push_many(ring, elements, count);
+}
+
+int spsc_ring_try_pop_many(spsc_ring_t* ring, void* elements, int count)
+{
+	return cute_spsc_ring_try_pop_many(ring, elements, count);
+}
+
+struct completion_t
+{
+	completion_t* next;
+	promise_fn* callback;
+	void* promise_udata;
+	error_t status;
+	void* param;
+};
+
+struct completion_queue_t
+{
+	// Intrusive stack of posted completions, newest first. Posting pushes with a CAS, and draining
+	// swaps out the whole stack at once, so there is no ABA problem with a single draining thread.
+	void* head = NULL;
+	void* mem_ctx = NULL;
+};
+
+completion_queue_t* completion_queue_create(void* user_allocator_context)
+{
+	completion_queue_t* queue = (completion_queue_t*)CUTE_ALLOC(sizeof(completion_queue_t), user_allocator_context);
+	CUTE_PLACEMENT_NEW(queue) completion_queue_t;
+	queue->mem_ctx = user_allocator_context;
+	return queue;
+}
+
+void completion_queue_destroy(completion_queue_t* queue)
+{
+	if (!queue) return;
+	completion_queue_drain(queue);
+	void* mem_ctx = queue->mem_ctx;
+	queue->~completion_queue_t();
+	CUTE_FREE(queue, mem_ctx);
+}
+
+void completion_queue_post(completion_queue_t* queue, promise_fn* callback, void* promise_udata, error_t status, void* param)
+{
+	completion_t* completion = (completion_t*)CUTE_ALLOC(sizeof(completion_t), queue->mem_ctx);
+	completion->callback = callback;
+	completion->promise_udata = promise_udata;
+	completion->status = status;
+	completion->param = param;
+	while (1) {
+		completion->next = (completion_t*)atomic_ptr_get(&queue->head);
+		if (!atomic_ptr_cas(&queue->head, completion->next, completion).is_error()) break;
+	}
+}
+
+int completion_queue_drain(completion_queue_t* queue)
+{
+	completion_t* stack = (completion_t*)atomic_ptr_set(&queue->head, NULL);
+
+	// Reverse to run callbacks in the order they were posted.
+	completion_t* list = NULL;
+	while (stack) {
+		completion_t* next = stack->next;
+		stack->next = list;
+		list = stack;
+		stack = next;
+	}
+
+	int count = 0;
+	while (list) {
+		completion_t* next = list->next;
+		list->callback(list->status, list->param, list->promise_udata);
+		CUTE_FREE(list, queue->mem_ctx);
+		list = next;
+		++count;
+	}
+
+	return count;
 }
 
 void threadpool_kick_and_wait(threadpool_t* pool)
@@ -21,6 +21,8 @@
 
 #include <cute_coroutine.h>
 #include <cute_c_runtime.h>
+#include <cute_doubly_list.h>
+#include <cute_file_system.h>
 
 #include <internal/cute_app_internal.h>
 
@@ -35,9 +37,17 @@ struct coroutine_t
 	float dt = 0;
 	bool waiting = false;
 	float seconds_left = 0;
+	threadpool_t* await_pool = NULL;
+	task_counter_t* awaiting = NULL;
 	mco_coro* mco;
 	coroutine_fn* fn = NULL;
 	void* udata = NULL;
+
+	// Only used by coroutines spawned from a scheduler.
+	coroutine_scheduler_t* scheduler = NULL;
+	list_node_t node; // Links into the run list, or into a timer wheel slot while parked.
+	bool parked = false;
+	uint64_t deadline = 0; // In scheduler ticks.
 };
 
 static void s_co_fn(mco_coro* mco)
@@ -60,8 +70,15 @@ coroutine_t* coroutine_make(coroutine_fn* fn, int stack_size, void* udata)
 	return co;
 }
 
+static void s_recycle(coroutine_t* co);
+
 void coroutine_destroy(coroutine_t* co)
 {
+	if (co->scheduler) {
+		s_recycle(co);
+		return;
+	}
+
 	mco_state state = mco_status(co->mco);
 	CUTE_ASSERT(state == MCO_DEAD || state == MCO_SUSPENDED);
 	mco_result res = mco_destroy(co->mco);
@@ -83,6 +100,12 @@ error_t coroutine_resume(coroutine_t* co, float dt)
 		}
 	}
 
+	if (co->awaiting) {
+		if (atomic_get(&co->awaiting->count)) return error_success();
+		co->awaiting = NULL;
+		co->await_pool = NULL;
+	}
+
 	mco_result res = mco_resume(co->mco);
 	if (res != MCO_SUCCESS) {
 		return error_failure(mco_result_description(res));
@@ -113,6 +136,47 @@ error_t coroutine_wait(coroutine_t* co, float seconds)
 	return err;
 }
 
+error_t coroutine_await(coroutine_t* co, threadpool_t* pool, task_counter_t* counter)
+{
+	if (!atomic_get(&counter->count)) return error_success();
+	co->awaiting = counter;
+	co->await_pool = pool;
+	threadpool_kick(pool);
+	error_t err;
+	coroutine_yield(co, &err);
+	return err;
+}
+
+struct coroutine_read_file_job_t
+{
+	const char* virtual_path;
+	void** data_ptr;
+	size_t* size;
+	void* mem_ctx;
+	error_t err;
+};
+
+static void s_read_file_task(void* param)
+{
+	coroutine_read_file_job_t* job = (coroutine_read_file_job_t*)param;
+	job->err = file_system_read_entire_file_to_memory(job->virtual_path, job->data_ptr, job->size, job->mem_ctx);
+}
+
+error_t coroutine_await_read_entire_file(coroutine_t* co, threadpool_t* pool, const char* virtual_path, void** data_ptr, size_t* size, void* user_allocator_context)
+{
+	// The job and counter live on the coroutine's stack, which stays put while it's suspended.
+	coroutine_read_file_job_t job;
+	job.virtual_path = virtual_path;
+	job.data_ptr = data_ptr;
+	job.size = size;
+	job.mem_ctx = user_allocator_context;
+	task_counter_t counter = { };
+	threadpool_add_task(pool, s_read_file_task, &job, &counter);
+	error_t err = coroutine_await(co, pool, &counter);
+	if (err.is_error()) return err;
+	return job.err;
+}
+
 coroutine_state_t coroutine_state(coroutine_t* co)
 {
 	mco_state s = mco_status(co->mco);
@@ -167,4 +231,292 @@ coroutine_t* coroutine_currently_running()
 	return co;
 }
 
+// -------------------------------------------------------------------------------------------------
+// Scheduler.
+
+// Parked coroutines sit in a hierarchical timer wheel, with each level covering 64 times the span of
+// the level below. Level 0 holds coroutines due within the next 64 ticks, one slot per tick. Once
+// the lower levels wrap around, the next slot of the level above is cascaded down. With 4 levels of
+// 64 slots at 1 millisecond per tick, waits of up to about 4.6 hours are parked directly, and longer
+// ones are re-parked whenever their slot comes around.
+#define CUTE_COROUTINE_WHEEL_LEVELS 4
+#define CUTE_COROUTINE_WHEEL_BITS 6
+#define CUTE_COROUTINE_WHEEL_SLOTS (1 << CUTE_COROUTINE_WHEEL_BITS)
+#define CUTE_COROUTINE_TICKS_PER_SECOND 1000.0
+
+struct coroutine_scheduler_t
+{
+	double time = 0;
+	uint64_t tick = 0;
+	int count = 0;
+	int waiting_count = 0;
+	int awaiting_count = 0;
+	list_t runnable;
+	list_t awaiting; // Coroutines waiting on a task counter.
+	completion_queue_t* wake_queue = NULL; // Wakes up awaiting coroutines, posted to from the threadpool.
+	task_counter_t wakes_pending = { }; // Wake ups not yet posted to `wake_queue`.
+	list_t wheel[CUTE_COROUTINE_WHEEL_LEVELS][CUTE_COROUTINE_WHEEL_SLOTS];
+
+	// Each block holds a `coroutine_t` followed by the minicoro coroutine and its stack. Blocks of
+	// finished coroutines go onto an intrusive free list for reuse.
+	mco_desc desc;
+	size_t header_size = 0;
+	size_t block_size = 0;
+	void* free_blocks = NULL;
+	void* mem_ctx = NULL;
+};
+
+static void s_list_take_all(list_t* from, list_t* to)
+{
+	if (list_empty(from)) return;
+	list_node_t* first = from->nodes.next;
+	list_node_t* last = from->nodes.prev;
+	first->prev = to->nodes.prev;
+	last->next = &to->nodes;
+	to->nodes.prev->next = first;
+	to->nodes.prev = last;
+	list_init(from);
+}
+
+static void s_wheel_insert(coroutine_scheduler_t* scheduler, coroutine_t* co)
+{
+	uint64_t delta = co->deadline - scheduler->tick;
+	uint64_t when = co->deadline;
+	int level = 0;
+	while (level < CUTE_COROUTINE_WHEEL_LEVELS - 1 && delta >= (1ull << (CUTE_COROUTINE_WHEEL_BITS * (level + 1)))) {
+		++level;
+	}
+	uint64_t span = 1ull << (CUTE_COROUTINE_WHEEL_BITS * CUTE_COROUTINE_WHEEL_LEVELS);
+	if (delta >= span) {
+		// Too far out, so park in the furthest slot and re-park from there.
+		when = scheduler->tick + span - 1;
+	}
+	int slot = (int)((when >> (CUTE_COROUTINE_WHEEL_BITS * level)) & (CUTE_COROUTINE_WHEEL_SLOTS - 1));
+	list_push_back(&scheduler->wheel[level][slot], &co->node);
+}
+
+static void s_park(coroutine_scheduler_t* scheduler, coroutine_t* co)
+{
+	uint64_t deadline = (uint64_t)((scheduler->time + co->seconds_left) * CUTE_COROUTINE_TICKS_PER_SECOND + 0.5);
+	co->waiting = false;
+	co->seconds_left = 0;
+	list_remove(&co->node);
+	if (deadline <= scheduler->tick) {
+		list_push_back(&scheduler->runnable, &co->node);
+		return;
+	}
+	co->deadline = deadline;
+	co->parked = true;
+	scheduler->waiting_count++;
+	s_wheel_insert(scheduler, co);
+}
+
+static void s_wake(error_t status, void* param, void* promise_udata)
+{
+	coroutine_t* co = (coroutine_t*)promise_udata;
+	coroutine_scheduler_t* scheduler = co->scheduler;
+	co->awaiting = NULL;
+	co->await_pool = NULL;
+	scheduler->awaiting_count--;
+	list_remove(&co->node);
+	list_push_back(&scheduler->runnable, &co->node);
+}
+
+static void s_await_done(void* param)
+{
+	coroutine_t* co = (coroutine_t*)param;
+	completion_queue_post(co->scheduler->wake_queue, s_wake, co, error_success(), NULL);
+}
+
+static void s_await(coroutine_scheduler_t* scheduler, coroutine_t* co)
+{
+	list_remove(&co->node);
+	list_push_back(&scheduler->awaiting, &co->node);
+	scheduler->awaiting_count++;
+
+	// Runs right away if the counter already reached zero in the meantime.
+	threadpool_add_continuation(co->await_pool, co->awaiting, s_await_done, co, &scheduler->wakes_pending);
+}
+
+static uint64_t s_next_occupied_tick(coroutine_scheduler_t* scheduler)
+{
+	// Each level visits its next slot every 64^level ticks, so look ahead one full turn of each
+	// level for an occupied slot. Levels further up only matter if they come around sooner.
+	uint64_t next = UINT64_MAX;
+	for (int level = 0; level < CUTE_COROUTINE_WHEEL_LEVELS; ++level) {
+		int shift = CUTE_COROUTINE_WHEEL_BITS * level;
+		for (uint64_t i = 1; i <= CUTE_COROUTINE_WHEEL_SLOTS; ++i) {
+			uint64_t tick = ((scheduler->tick >> shift) + i) << shift;
+			if (tick >= next) break;
+			if (!list_empty(&scheduler->wheel[level][(tick >> shift) & (CUTE_COROUTINE_WHEEL_SLOTS - 1)])) {
+				next = tick;
+				break;
+			}
+		}
+	}
+	return next;
+}
+
+static void s_advance(coroutine_scheduler_t* scheduler, uint64_t target)
+{
+	while (scheduler->tick < target) {
+		// Skip straight over ticks where no occupied slot comes around.
+		uint64_t tick = scheduler->waiting_count ? s_next_occupied_tick(scheduler) : UINT64_MAX;
+		if (tick > target) {
+			scheduler->tick = target;
+			break;
+		}
+		scheduler->tick = tick;
+
+		// Cascade the next slot of each level whose lower levels just wrapped around.
+		for (int level = 1; level < CUTE_COROUTINE_WHEEL_LEVELS; ++level) {
+			if (tick & ((1ull << (CUTE_COROUTINE_WHEEL_BITS * level)) - 1)) break;
+			int slot = (int)((tick >> (CUTE_COROUTINE_WHEEL_BITS * level)) & (CUTE_COROUTINE_WHEEL_SLOTS - 1));
+			list_t cascade;
+			list_init(&cascade);
+			s_list_take_all(&scheduler->wheel[level][slot], &cascade);
+			while (!list_empty(&cascade)) {
+				coroutine_t* co = CUTE_LIST_HOST(coroutine_t, node, list_pop_front(&cascade));
+				s_wheel_insert(scheduler, co);
+			}
+		}
+
+		list_t* expired = &scheduler->wheel[0][tick & (CUTE_COROUTINE_WHEEL_SLOTS - 1)];
+		while (!list_empty(expired)) {
+			coroutine_t* co = CUTE_LIST_HOST(coroutine_t, node, list_pop_front(expired));
+			co->parked = false;
+			scheduler->waiting_count--;
+			list_push_back(&scheduler->runnable, &co->node);
+		}
+	}
+}
+
+static void s_recycle(coroutine_t* co)
+{
+	coroutine_scheduler_t* scheduler = co->scheduler;
+	mco_state state = mco_status(co->mco);
+	CUTE_ASSERT(state == MCO_DEAD || state == MCO_SUSPENDED);
+	CUTE_ASSERT(!co->awaiting); // The threadpool still holds onto awaiting coroutines.
+	if (co->parked) scheduler->waiting_count--;
+	list_remove(&co->node);
+	mco_result res = mco_uninit(co->mco);
+	CUTE_ASSERT(res == MCO_SUCCESS);
+	co->~coroutine_t();
+	*(void**)co = scheduler->free_blocks;
+	scheduler->free_blocks = co;
+	scheduler->count--;
+}
+
+coroutine_scheduler_t* coroutine_scheduler_make(int stack_size, void* user_allocator_context)
+{
+	coroutine_scheduler_t* scheduler = (coroutine_scheduler_t*)CUTE_ALLOC(sizeof(coroutine_scheduler_t), user_allocator_context);
+	CUTE_PLACEMENT_NEW(scheduler) coroutine_scheduler_t;
+	scheduler->desc = mco_desc_init(s_co_fn, (size_t)stack_size);
+	scheduler->header_size = (sizeof(coroutine_t) + 15) & ~(size_t)15;
+	scheduler->block_size = scheduler->header_size + scheduler->desc.coro_size;
+	scheduler->mem_ctx = user_allocator_context;
+	scheduler->wake_queue = completion_queue_create(user_allocator_context);
+	return scheduler;
+}
+
+void coroutine_scheduler_destroy(coroutine_scheduler_t* scheduler)
+{
+	// Coroutines awaiting a task counter can't be pulled back out of the threadpool, so let their
+	// tasks finish first. Waiting on a counter helps out on the pool instead of spinning.
+	if (scheduler->awaiting_count) {
+		coroutine_t* co = CUTE_LIST_HOST(coroutine_t, node, list_front(&scheduler->awaiting));
+		threadpool_wait_counter(co->await_pool, &scheduler->wakes_pending);
+	}
+	completion_queue_drain(scheduler->wake_queue);
+	CUTE_ASSERT(!scheduler->awaiting_count);
+	completion_queue_destroy(scheduler->wake_queue);
+
+	while (!list_empty(&scheduler->runnable)) {
+		s_recycle(CUTE_LIST_HOST(coroutine_t, node, list_front(&scheduler->runnable)));
+	}
+	for (int level = 0; level < CUTE_COROUTINE_WHEEL_LEVELS; ++level) {
+		for (int slot = 0; slot < CUTE_COROUTINE_WHEEL_SLOTS; ++slot) {
+			list_t* list = &scheduler->wheel[level][slot];
+			while (!list_empty(list)) {
+				s_recycle(CUTE_LIST_HOST(coroutine_t, node, list_front(list)));
+			}
+		}
+	}
+	while (scheduler->free_blocks) {
+		void* block = scheduler->free_blocks;
+		scheduler->free_blocks = *(void**)block;
+		CUTE_FREE(block, scheduler->mem_ctx);
+	}
+	void* mem_ctx = scheduler->mem_ctx;
+	scheduler->~coroutine_scheduler_t();
+	CUTE_FREE(scheduler, mem_ctx);
+}
+
+coroutine_t* coroutine_scheduler_spawn(coroutine_scheduler_t* scheduler, coroutine_fn* fn, void* udata)
+{
+	void* block = scheduler->free_blocks;
+	if (block) {
+		scheduler->free_blocks = *(void**)block;
+	} else {
+		block = CUTE_ALLOC(scheduler->block_size, scheduler->mem_ctx);
+	}
+
+	coroutine_t* co = (coroutine_t*)block;
+	CUTE_PLACEMENT_NEW(co) coroutine_t;
+	mco_coro* mco = (mco_coro*)((uint8_t*)block + scheduler->header_size);
+	mco_desc desc = scheduler->desc;
+	desc.user_data = (void*)co;
+	mco_result res = mco_init(mco, &desc);
+	CUTE_ASSERT(res == MCO_SUCCESS);
+	co->mco = mco;
+	co->fn = fn;
+	co->udata = udata;
+	co->scheduler = scheduler;
+	list_push_back(&scheduler->runnable, &co->node);
+	scheduler->count++;
+	return co;
+}
+
+void coroutine_scheduler_update(coroutine_scheduler_t* scheduler, float dt)
+{
+	scheduler->time += dt;
+	completion_queue_drain(scheduler->wake_queue);
+	s_advance(scheduler, (uint64_t)(scheduler->time * CUTE_COROUTINE_TICKS_PER_SECOND + 0.5));
+
+	// Resume everything runnable once. Coroutines spawned or made runnable along the way wait for
+	// the next update.
+	list_t ready;
+	list_init(&ready);
+	s_list_take_all(&scheduler->runnable, &ready);
+	while (!list_empty(&ready)) {
+		coroutine_t* co = CUTE_LIST_HOST(coroutine_t, node, list_pop_front(&ready));
+		list_push_back(&scheduler->runnable, &co->node);
+		co->dt = dt;
+		mco_result res = mco_resume(co->mco);
+		CUTE_ASSERT(res == MCO_SUCCESS);
+		if (mco_status(co->mco) == MCO_DEAD) {
+			s_recycle(co);
+		} else if (co->waiting) {
+			s_park(scheduler, co);
+		} else if (co->awaiting) {
+			s_await(scheduler, co);
+		}
+	}
+}
+
+int coroutine_scheduler_count(coroutine_scheduler_t* scheduler)
+{
+	return scheduler->count;
+}
+
+int coroutine_scheduler_waiting_count(coroutine_scheduler_t* scheduler)
+{
+	return scheduler->waiting_count;
+}
+
+int coroutine_scheduler_awaiting_count(coroutine_scheduler_t* scheduler)
+{
+	return scheduler->awaiting_count;
+}
+
 }
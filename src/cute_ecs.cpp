@@ -24,49 +24,147 @@
 #include <cute_kv.h>
 #include <cute_defer.h>
 #include <cute_string.h>
+#include <cute_timer.h>
 
 #include <internal/cute_app_internal.h>
+#include <internal/cute_ecs_internal.h>
 #include <internal/cute_object_table_internal.h>
 
-#define INJECT(s) strpool_inject(app->strpool, s, (int)CUTE_STRLEN(s))
+#include <imgui/imgui.h>
+
+#define INJECT(s) strpool_inject(world->strpool, s, (int)CUTE_STRLEN(s))
 
 namespace cute
 {
 
+// The world each thread is currently operating on, or NULL for the app's default world. Tasks
+// running systems on the threadpool set this to the world being run.
+static thread_local ecs_world_t* s_current_world = NULL;
+
+static CUTE_INLINE ecs_world_t* s_world()
+{
+	return s_current_world ? s_current_world : app->ecs_world;
+}
+
+static CUTE_INLINE int s_column(const entity_collection_t* collection, component_id_t component_id)
+{
+	if (component_id < 0 || component_id >= collection->component_columns.count()) return -1;
+	return collection->component_columns[component_id];
+}
+
+static void s_track_new_rows(entity_collection_t* collection)
+{
+	// Stamp rows added since the last call with the current change tick.
+	ecs_world_t* world = s_world();
+	int count = collection->entity_handles.count();
+	uint64_t tick = world->ecs_change_tick;
+	for (int i = 0; i < collection->component_changes.count(); ++i) {
+		component_changes_t& changes = collection->component_changes[i];
+		if (!changes.tracked) continue;
+		int first = changes.row_ticks.count();
+		if (first >= count) continue;
+		changes.row_ticks.ensure_count(count);
+		for (int j = first; j < count; ++j) changes.row_ticks[j] = tick;
+		changes.changed_tick = tick;
+	}
+}
+
+static CUTE_INLINE void s_mark_dirty(entity_collection_t* collection, int column, int row)
+{
+	if (column < 0) return;
+	component_changes_t& changes = collection->component_changes[column];
+	if (!changes.tracked) return;
+	uint64_t tick = s_world()->ecs_change_tick;
+	changes.row_ticks[row] = tick;
+	if (changes.changed_tick != tick) changes.changed_tick = tick;
+}
+
+static CUTE_INLINE bool s_changed_since(const entity_collection_t* collection, int column, int row, uint64_t tick)
+{
+	// Untracked components are conservatively treated as always changed.
+	if (column < 0) return false;
+	const component_changes_t& changes = collection->component_changes[column];
+	if (!changes.tracked) return true;
+	if (row < 0) return changes.changed_tick > tick;
+	return changes.row_ticks[row] > tick;
+}
+
 struct ecs_arrays_t
 {
-	int count;
+	int offset; // Index of the first entity in view, for systems updating a sub-range of a collection.
 	handle_t* entities;
-	strpool_id* types;
-	array<typeless_array>* ptrs;
+	entity_collection_t* collection;
+	ecs_world_t* world;
+	uint64_t since_tick; // Change tick of the system's previous run.
+
+	void* column_components(int column)
+	{
+		if (column < 0) return NULL;
+		typeless_array& table = collection->component_tables[column];
+		return (void*)(((uintptr_t)table.data()) + offset * table.m_element_size);
+	}
+
+	void* find_components(component_id_t component_id)
+	{
+		return column_components(s_column(collection, component_id));
+	}
 
 	void* find_components(const char* type)
 	{
 		strpool_id id = INJECT(type);
-		for (int i = 0; i < count; ++i) {
-			if (types[i].val == id.val) {
-				return (*ptrs)[i].data();
+		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
+		for (int i = 0; i < component_type_tuple.count(); ++i) {
+			if (component_type_tuple[i].val == id.val) {
+				return column_components(i);
 			}
 		}
 		return NULL;
 	}
 };
 
-static ecs_arrays_t s_arrays;
+// Fast path for `s_collection` -- the collection a system is currently iterating over. This is kept
+// per-thread since systems may be running in parallel on the threadpool (see `ecs_run_systems`).
+// Every world hands out the same entity types, so the world is part of the key.
+static thread_local ecs_world_t* s_current_collection_world = NULL;
+static thread_local entity_type_t s_current_collection_type = INVALID_ENTITY_TYPE;
+static thread_local entity_collection_t* s_current_collection = NULL;
+
+static inline int s_match(const array<strpool_id>& a, const array<strpool_id>& b)
+{
+	int matches = 0;
+	for (int i = 0; i < a.count(); ++i) {
+		for (int j = 0; j < b.count(); ++j) {
+			if (a[i].val == b[j].val) {
+				++matches;
+				break;
+			}
+		}
+	}
+	return matches;
+}
+
+static void s_match_system_to_collection(system_internal_t* system, entity_type_t entity_type, const entity_collection_t* collection)
+{
+	int matches = s_match(system->component_type_tuple, collection->component_type_tuple);
+	if (matches == system->component_type_tuple.count()) {
+		system->matched_entity_types.add(entity_type);
+	}
+}
 
 static error_t s_load_from_schema(entity_type_t schema_type, entity_t entity, component_config_t* config, void* component, void* udata)
 {
 	// Look for parent.
 	// If parent exists, load values from it first.
+	ecs_world_t* world = s_world();
 	entity_type_t inherits_from = INVALID_ENTITY_TYPE;
-	error_t err = app->entity_schema_inheritence.find(schema_type, &inherits_from);
+	error_t err = world->entity_schema_inheritence.find(schema_type, &inherits_from);
 	if (!err.is_error()) {
 		err = s_load_from_schema(inherits_from, entity, config, component, udata);
 		if (err.is_error()) return err;
 	}
 
 	kv_t* schema = NULL;
-	err = app->entity_parsed_schemas.find(schema_type, &schema);
+	err = world->entity_parsed_schemas.find(schema_type, &schema);
 	if (err.is_error()) {
 		err = error_success();
 		if (config->serializer_fn) err = config->serializer_fn(schema, true, entity, component, udata);
@@ -82,6 +180,20 @@ static error_t s_load_from_schema(entity_type_t schema_type, entity_t entity, co
 	return err;
 }
 
+static error_t s_construct_component(entity_type_t entity_type, entity_collection_t* collection, int column, component_config_t* config, entity_t entity, void* component)
+{
+	const typeless_array& prototype = collection->component_prototypes[column];
+	if (prototype.count()) {
+		CUTE_MEMCPY(component, prototype.data(), config->size_of_component);
+	} else {
+		error_t err = s_load_from_schema(entity_type, entity, config, component, config->serializer_udata);
+		if (err.is_error()) return err;
+	}
+
+	if (config->post_construct_fn) config->post_construct_fn(entity, component, config->post_construct_udata);
+	return error_success();
+}
+
 //--------------------------------------------------------------------------------------------------
 
 void* ecs_arrays_find_components(ecs_arrays_t* arrays, const char* component_type)
@@ -89,49 +201,107 @@ void* ecs_arrays_find_components(ecs_arrays_t* arrays, const char* component_typ
 	return arrays->find_components(component_type);
 }
 
+void* ecs_arrays_find_components(ecs_arrays_t* arrays, component_id_t component_id)
+{
+	return arrays->find_components(component_id);
+}
+
 entity_t* ecs_arrays_get_entities(ecs_arrays_t* arrays)
 {
 	return (entity_t*)arrays->entities;
 }
 
+bool ecs_arrays_changed(ecs_arrays_t* arrays, component_id_t component_id)
+{
+	return s_changed_since(arrays->collection, s_column(arrays->collection, component_id), -1, arrays->since_tick);
+}
+
+bool ecs_arrays_changed(ecs_arrays_t* arrays, component_id_t component_id, int index)
+{
+	return s_changed_since(arrays->collection, s_column(arrays->collection, component_id), arrays->offset + index, arrays->since_tick);
+}
+
+void ecs_arrays_mark_dirty(ecs_arrays_t* arrays, component_id_t component_id, int index)
+{
+	s_mark_dirty(arrays->collection, s_column(arrays->collection, component_id), arrays->offset + index);
+}
+
 void ecs_system_begin()
 {
-	app->system_internal_builder.clear();
+	ecs_world_t* world = s_world();
+	world->system_internal_builder.clear();
 }
 
 void ecs_system_end()
 {
-	app->systems.add(app->system_internal_builder);
+	// Find all currently registered entity types this system runs upon. Entity types registered later
+	// are matched up to the system in `s_register_entity_type`.
+	ecs_world_t* world = s_world();
+	system_internal_t* system = &world->systems.add(world->system_internal_builder);
+	system->matched_entity_types.clear();
+	for (int i = 0; i < world->entity_collections.count(); ++i) {
+		s_match_system_to_collection(system, world->entity_collections.keys()[i], world->entity_collections.items() + i);
+	}
+	world->system_schedule_dirty = true;
 }
 
 void ecs_system_set_name(const char* name)
 {
-	app->system_internal_builder.name = INJECT(name);
+	ecs_world_t* world = s_world();
+	world->system_internal_builder.name = INJECT(name);
 }
 
 void ecs_system_set_update(system_update_fn* update_fn)
 {
-	app->system_internal_builder.update_fn = update_fn;
+	ecs_world_t* world = s_world();
+	world->system_internal_builder.update_fn = update_fn;
 }
 
 void ecs_system_require_component(const char* component_type)
 {
-	app->system_internal_builder.component_type_tuple.add(INJECT(component_type));
+	ecs_world_t* world = s_world();
+	strpool_id id = INJECT(component_type);
+	world->system_internal_builder.component_type_tuple.add(id);
+	world->system_internal_builder.write_component_type_tuple.add(id);
+}
+
+void ecs_system_require_component_read(const char* component_type)
+{
+	ecs_world_t* world = s_world();
+	world->system_internal_builder.component_type_tuple.add(INJECT(component_type));
+	world->system_internal_builder.declared_access = true;
+}
+
+void ecs_system_require_component_write(const char* component_type)
+{
+	ecs_world_t* world = s_world();
+	ecs_system_require_component(component_type);
+	world->system_internal_builder.declared_access = true;
 }
 
 void ecs_system_set_optional_pre_update(void (*pre_update_fn)(float dt, void* udata))
 {
-	app->system_internal_builder.pre_update_fn = pre_update_fn;
+	ecs_world_t* world = s_world();
+	world->system_internal_builder.pre_update_fn = pre_update_fn;
 }
 
 void ecs_system_set_optional_post_update(void (*post_update_fn)(float dt, void* udata))
 {
-	app->system_internal_builder.post_update_fn = post_update_fn;
+	ecs_world_t* world = s_world();
+	world->system_internal_builder.post_update_fn = post_update_fn;
 }
 
 void ecs_system_set_optional_update_udata(void* udata)
 {
-	app->system_internal_builder.udata = udata;
+	ecs_world_t* world = s_world();
+	world->system_internal_builder.udata = udata;
+}
+
+void ecs_system_set_optional_parallel_for(int grain_size)
+{
+	ecs_world_t* world = s_world();
+	CUTE_ASSERT(grain_size >= 0);
+	world->system_internal_builder.parallel_for_grain_size = grain_size;
 }
 
 static CUTE_INLINE uint16_t s_entity_type(entity_t entity)
@@ -139,16 +309,25 @@ static CUTE_INLINE uint16_t s_entity_type(entity_t entity)
 	return (uint16_t)((entity.handle & 0x00000000FFFF0000ULL) >> 16);
 }
 
+static entity_t s_entity_make(entity_type_t type, error_t* err_out);
+
 entity_t entity_make(const char* entity_type, error_t* err_out)
 {
+	ecs_world_t* world = s_world();
 	entity_type_t type = INVALID_ENTITY_TYPE;
-	app->entity_type_string_to_id.find(INJECT(entity_type), &type);
+	world->entity_type_string_to_id.find(INJECT(entity_type), &type);
 	if (type == INVALID_ENTITY_TYPE) {
 		if (err_out) *err_out = error_failure("`entity_type` is not valid.");
 		return INVALID_ENTITY;
 	}
 
-	entity_collection_t* collection = app->entity_collections.find(type);
+	return s_entity_make(type, err_out);
+}
+
+static entity_t s_entity_make(entity_type_t type, error_t* err_out)
+{
+	ecs_world_t* world = s_world();
+	entity_collection_t* collection = world->entity_collections.find(type);
 	CUTE_ASSERT(collection);
 
 	int index = collection->entity_handles.count();
@@ -160,7 +339,7 @@ entity_t entity_make(const char* entity_type, error_t* err_out)
 	for (int i = 0; i < component_type_tuple.count(); ++i)
 	{
 		strpool_id component_type = component_type_tuple[i];
-		component_config_t* config = app->component_configs.find(component_type);
+		component_config_t* config = world->component_configs.find(component_type);
 
 		if (!config) {
 			if (err_out) *err_out = error_failure("Unable to find component config.");
@@ -168,202 +347,1036 @@ entity_t entity_make(const char* entity_type, error_t* err_out)
 		}
 
 		void* component = collection->component_tables[i].add();
-		error_t err = s_load_from_schema(type, entity, config, component, config->serializer_udata);
+		error_t err = s_construct_component(type, collection, i, config, entity, component);
 		if (err.is_error()) {
 			// TODO - Unload the components that were added with `.add()` a couple lines above here.
 			return INVALID_ENTITY;
 		}
 	}
+	s_track_new_rows(collection);
 
 	if (err_out) *err_out = error_success();
 	return entity;
 }
 
+error_t entity_make_many(const char* entity_type, int count, entity_t* entities_out)
+{
+	ecs_world_t* world = s_world();
+	entity_type_t type = INVALID_ENTITY_TYPE;
+	world->entity_type_string_to_id.find(INJECT(entity_type), &type);
+	if (type == INVALID_ENTITY_TYPE) {
+		return error_failure("`entity_type` is not valid.");
+	}
+	if (count <= 0) return error_success();
+
+	entity_collection_t* collection = world->entity_collections.find(type);
+	CUTE_ASSERT(collection);
+
+	// Reserve all storage up front.
+	int first = collection->entity_handles.count();
+	int column_count = collection->component_tables.count();
+	collection->entity_handle_table.reserve(count);
+	collection->entity_handles.ensure_capacity(first + count);
+	for (int i = 0; i < column_count; ++i) {
+		collection->component_tables[i].ensure_capacity(first + count);
+	}
+
+	for (int i = 0; i < count; ++i) {
+		handle_t h = collection->entity_handle_table.alloc_handle(first + i, type);
+		collection->entity_handles.add(h);
+		entities_out[i] = { h };
+	}
+
+	// Construct one table at a time.
+	error_t err = error_success();
+	for (int i = 0; i < column_count && !err.is_error(); ++i) {
+		component_config_t* config = world->component_configs.find(collection->component_type_tuple[i]);
+		if (!config) {
+			err = error_failure("Unable to find component config.");
+			break;
+		}
+
+		typeless_array& table = collection->component_tables[i];
+		table.m_count = first + count;
+		for (int j = 0; j < count; ++j) {
+			err = s_construct_component(type, collection, i, config, entities_out[j], table[first + j]);
+			if (err.is_error()) break;
+		}
+	}
+
+	if (err.is_error()) {
+		// Roll back every entity made above.
+		for (int i = 0; i < count; ++i) {
+			collection->entity_handle_table.free_handle(entities_out[i].handle);
+			entities_out[i] = INVALID_ENTITY;
+		}
+		collection->entity_handles.set_count(first);
+		for (int i = 0; i < column_count; ++i) {
+			collection->component_tables[i].m_count = first;
+		}
+	} else {
+		s_track_new_rows(collection);
+	}
+
+	return err;
+}
+
 static entity_collection_t* s_collection(entity_t entity)
 {
 	entity_collection_t* collection = NULL;
 	uint16_t entity_type = s_entity_type(entity);
-	if (entity_type == app->current_collection_type_being_iterated) {
+	if (entity_type == INVALID_ENTITY_TYPE) {
+		// Invalid entities, or stand-ins from `entity_delayed_make`.
+		return NULL;
+	} else if (entity_type == s_current_collection_type && s_current_collection_world == s_world()) {
 		// Fast path -- check the current entity collection for this entity type first.
-		collection = app->current_collection_being_updated;
+		collection = s_current_collection;
 		CUTE_ASSERT(collection);
 	} else {
-		// Slightly slower path -- lookup collection first.
-		collection = app->entity_collections.find(entity_type);
-		if (!collection) return NULL;
+		// Slightly slower path -- entity types are handed out in order and collections are never
+		// removed, so the entity type is also the index of its collection.
+		ecs_world_t* world = s_world();
+		if (entity_type >= world->entity_collections.count()) return NULL;
+		collection = world->entity_collections.items() + entity_type;
+		CUTE_ASSERT(world->entity_collections.keys()[entity_type] == entity_type);
 	}
 	return collection;
 }
 
+//--------------------------------------------------------------------------------------------------
+// Delayed commands.
+
+// Each thread records commands into its own buffer, so no locks are needed. Commands are tagged with
+// the system (and range of entities) being updated when they were recorded, and are played back
+// sorted by these tags. This keeps playback order deterministic no matter which threads ran which
+// systems.
+
+enum ecs_command_op_t : uint32_t
+{
+	ECS_COMMAND_OP_MAKE,
+	ECS_COMMAND_OP_DESTROY,
+	ECS_COMMAND_OP_SET_COMPONENT,
+};
+
+struct ecs_command_key_t
+{
+	uint32_t system = 0; // Index of the system plus one, or zero outside of systems.
+	uint32_t collection = 0; // Zero for pre-update, entity type plus one for update, ~0 for post-update.
+	uint32_t offset = 0; // First entity of the range being updated.
+};
+
+struct ecs_command_t
+{
+	ecs_command_key_t key;
+	uint32_t seq;
+	uint32_t op;
+	component_id_t component_id;
+	uint32_t size;
+	entity_type_t entity_type;
+	entity_t entity;
+};
+
+static thread_local ecs_command_key_t s_command_key;
+static thread_local ecs_command_buffer_t* s_command_buffer = NULL;
+static thread_local int s_command_buffer_world_id = 0; // Id of the world `s_command_buffer` belongs to.
+
+#define CUTE_PENDING_ENTITY_TYPE 0xFFFFULL
+
+static CUTE_INLINE bool s_is_pending(entity_t entity)
+{
+	return entity.handle != CUTE_INVALID_HANDLE && ((entity.handle >> 16) & 0xFFFF) == CUTE_PENDING_ENTITY_TYPE;
+}
+
+static ecs_command_buffer_t* s_get_command_buffer()
+{
+	// Fast path -- this thread already registered a buffer with the current world.
+	ecs_world_t* world = s_world();
+	if (s_command_buffer_world_id == world->id) return s_command_buffer;
+
+	// Slower path -- this thread may have registered a buffer before switching worlds.
+	thread_id_t owner = thread_id();
+	ecs_command_buffer_t* buffer = NULL;
+	mutex_lock(&world->command_buffers_mutex);
+	for (int i = 0; i < world->command_buffers.count(); ++i) {
+		if (world->command_buffers[i]->owner == owner) {
+			buffer = world->command_buffers[i];
+			break;
+		}
+	}
+	if (!buffer) {
+		buffer = (ecs_command_buffer_t*)CUTE_ALLOC(sizeof(ecs_command_buffer_t), world->mem_ctx);
+		CUTE_PLACEMENT_NEW(buffer) ecs_command_buffer_t;
+		buffer->owner = owner;
+		buffer->index = world->command_buffers.count();
+		world->command_buffers.add(buffer);
+	}
+	mutex_unlock(&world->command_buffers_mutex);
+	s_command_buffer = buffer;
+	s_command_buffer_world_id = world->id;
+	return buffer;
+}
+
+static void s_destroy_command_buffers(ecs_world_t* world)
+{
+	for (int i = 0; i < world->command_buffers.count(); ++i) {
+		ecs_command_buffer_t* buffer = world->command_buffers[i];
+		buffer->~ecs_command_buffer_t();
+		CUTE_FREE(buffer, world->mem_ctx);
+	}
+	world->command_buffers.clear();
+}
+
+static entity_t s_record_command(ecs_command_op_t op, entity_t entity, entity_type_t entity_type, component_id_t component_id, const void* data, size_t size)
+{
+	ecs_command_buffer_t* buffer = s_get_command_buffer();
+
+	if (op == ECS_COMMAND_OP_MAKE) {
+		// Stand-in handle for the entity, resolved upon playback.
+		CUTE_ASSERT(buffer->index <= 0xFFFF);
+		entity.handle = ((uint64_t)buffer->pending_count++ << 32) | (CUTE_PENDING_ENTITY_TYPE << 16) | (uint64_t)buffer->index;
+	}
+
+	int aligned_size = (int)((size + 7) & ~(size_t)7);
+	int offset = buffer->commands.count();
+	buffer->commands.ensure_count(offset + (int)sizeof(ecs_command_t) + aligned_size);
+	ecs_command_t* command = (ecs_command_t*)(buffer->commands.data() + offset);
+	command->key = s_command_key;
+	command->seq = buffer->seq++;
+	command->op = op;
+	command->component_id = component_id;
+	command->size = (uint32_t)size;
+	command->entity_type = entity_type;
+	command->entity = entity;
+	if (size) CUTE_MEMCPY(command + 1, data, size);
+
+	return entity;
+}
+
+entity_t entity_delayed_make(const char* entity_type)
+{
+	ecs_world_t* world = s_world();
+	entity_type_t type = INVALID_ENTITY_TYPE;
+	world->entity_type_string_to_id.find(INJECT(entity_type), &type);
+	if (type == INVALID_ENTITY_TYPE) return INVALID_ENTITY;
+	return s_record_command(ECS_COMMAND_OP_MAKE, INVALID_ENTITY, type, INVALID_COMPONENT_ID, NULL, 0);
+}
+
 void entity_delayed_destroy(entity_t entity)
 {
-	app->delayed_destroy_entities.add(entity);
+	s_record_command(ECS_COMMAND_OP_DESTROY, entity, INVALID_ENTITY_TYPE, INVALID_COMPONENT_ID, NULL, 0);
+}
+
+void entity_delayed_set_component(entity_t entity, component_id_t component_id, const void* component, size_t size)
+{
+	s_record_command(ECS_COMMAND_OP_SET_COMPONENT, entity, INVALID_ENTITY_TYPE, component_id, component, size);
+}
+
+struct ecs_command_ref_t
+{
+	const ecs_command_t* command;
+	int buffer;
+};
+
+static int s_compare_commands(const void* a, const void* b)
+{
+	const ecs_command_t* ca = ((const ecs_command_ref_t*)a)->command;
+	const ecs_command_t* cb = ((const ecs_command_ref_t*)b)->command;
+	if (ca->key.system != cb->key.system) return ca->key.system < cb->key.system ? -1 : 1;
+	if (ca->key.collection != cb->key.collection) return ca->key.collection < cb->key.collection ? -1 : 1;
+	if (ca->key.offset != cb->key.offset) return ca->key.offset < cb->key.offset ? -1 : 1;
+	if (ca->seq != cb->seq) return ca->seq < cb->seq ? -1 : 1;
+	int ba = ((const ecs_command_ref_t*)a)->buffer;
+	int bb = ((const ecs_command_ref_t*)b)->buffer;
+	return ba - bb;
+}
+
+static entity_t s_resolve(entity_t entity)
+{
+	ecs_world_t* world = s_world();
+	if (!s_is_pending(entity)) return entity;
+	int buffer = (int)(entity.handle & 0xFFFF);
+	int pending_index = (int)(entity.handle >> 32);
+	if (buffer >= world->command_buffers.count()) return INVALID_ENTITY;
+	const array<entity_t>& resolved = world->command_buffers[buffer]->resolved;
+	if (pending_index >= resolved.count()) return INVALID_ENTITY;
+	return resolved[pending_index];
+}
+
+void ecs_flush_delayed_commands()
+{
+	// Take the recorded commands, so commands recorded during playback (e.g. from cleanup functions)
+	// are played back upon the next flush.
+	ecs_world_t* world = s_world();
+	int buffer_count = world->command_buffers.count();
+	array<array<uint8_t>>& playback = world->command_playback;
+	while (playback.count() < buffer_count) playback.add();
+	array<ecs_command_ref_t> refs;
+	for (int i = 0; i < buffer_count; ++i) {
+		ecs_command_buffer_t* buffer = world->command_buffers[i];
+		playback[i].clear();
+		playback[i].steal_from(&buffer->commands);
+		buffer->resolved.clear();
+		buffer->resolved.ensure_count((int)buffer->pending_count);
+		for (int j = 0; j < buffer->resolved.count(); ++j) buffer->resolved[j] = INVALID_ENTITY;
+		buffer->pending_count = 0;
+		buffer->seq = 0;
+
+		int offset = 0;
+		while (offset < playback[i].count()) {
+			const ecs_command_t* command = (const ecs_command_t*)(playback[i].data() + offset);
+			refs.add({ command, i });
+			offset += (int)sizeof(ecs_command_t) + (int)((command->size + 7) & ~7u);
+		}
+	}
+	if (!refs.count()) return;
+
+	CUTE_QSORT(refs.data(), refs.count(), sizeof(ecs_command_ref_t), s_compare_commands);
+
+	for (int i = 0; i < refs.count(); ++i) {
+		const ecs_command_t* command = refs[i].command;
+		switch (command->op) {
+		case ECS_COMMAND_OP_MAKE:
+		{
+			int pending_index = (int)(command->entity.handle >> 32);
+			world->command_buffers[refs[i].buffer]->resolved[pending_index] = s_entity_make(command->entity_type, NULL);
+		}	break;
+
+		case ECS_COMMAND_OP_DESTROY:
+		{
+			entity_t entity = s_resolve(command->entity);
+			if (entity_is_valid(entity)) entity_destroy(entity);
+		}	break;
+
+		case ECS_COMMAND_OP_SET_COMPONENT:
+		{
+			entity_t entity = s_resolve(command->entity);
+			if (!entity_is_valid(entity)) break;
+			void* component = entity_get_component_for_write(entity, command->component_id);
+			if (!component) break;
+			CUTE_ASSERT(command->size == world->component_configs.items()[command->component_id].size_of_component);
+			CUTE_MEMCPY(component, command + 1, command->size);
+		}	break;
+		}
+	}
 }
 
 void entity_destroy(entity_t entity)
 {
+	ecs_world_t* world = s_world();
 	uint16_t entity_type = s_entity_type(entity);
-	entity_collection_t* collection = app->entity_collections.find(entity_type);
+	entity_collection_t* collection = world->entity_collections.find(entity_type);
 	CUTE_ASSERT(collection);
 
 	if (collection->entity_handle_table.is_valid(entity.handle)) {
 		int index = collection->entity_handle_table.get_index(entity.handle);
 
-		// Call cleanup function on each component.
-		for (int i = 0; i < collection->component_tables.count(); ++i) {
-			component_config_t config;
-			app->component_configs.find(collection->component_type_tuple[i], &config);
-			if (config.cleanup_fn) {
-				config.cleanup_fn(entity, collection->component_tables[i][index], config.cleanup_udata);
-			}
-		}
+		// Call cleanup function on each component.
+		for (int i = 0; i < collection->component_tables.count(); ++i) {
+			component_config_t config;
+			world->component_configs.find(collection->component_type_tuple[i], &config);
+			if (config.cleanup_fn) {
+				config.cleanup_fn(entity, collection->component_tables[i][index], config.cleanup_udata);
+			}
+		}
+
+		// Update index in case user changed it (by destroying enties).
+		index = collection->entity_handle_table.get_index(entity.handle);
+
+		// Free the handle.
+		collection->entity_handles.unordered_remove(index);
+		collection->entity_handle_table.free_handle(entity.handle);
+
+		// Free each component.
+		for (int i = 0; i < collection->component_tables.count(); ++i) {
+			collection->component_tables[i].unordered_remove(index);
+			component_changes_t& changes = collection->component_changes[i];
+			if (changes.tracked) changes.row_ticks.unordered_remove(index);
+		}
+
+		// Update handle of the swapped entity.
+		if (index < collection->entity_handles.size()) {
+			uint64_t h = collection->entity_handles[index];
+			collection->entity_handle_table.update_index(h, index);
+		}
+	}
+}
+
+static int s_compare_ints(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+static void s_sort_unique(array<int>& rows)
+{
+	CUTE_QSORT(rows.data(), rows.count(), sizeof(int), s_compare_ints);
+	int unique_count = 0;
+	for (int i = 0; i < rows.count(); ++i) {
+		if (!unique_count || rows[unique_count - 1] != rows[i]) rows[unique_count++] = rows[i];
+	}
+	rows.set_count(unique_count);
+}
+
+static void s_destroy_rows(entity_collection_t* collection, array<int>& rows)
+{
+	// Fill any holes below the new count with surviving rows from the tail. This touches only the
+	// removed rows and the tail, and each table is compacted in one pass. `rows` must be sorted and
+	// unique.
+	ecs_world_t* world = s_world();
+	int old_count = collection->entity_handles.count();
+	int new_count = old_count - rows.count();
+
+	array<int>& moves = world->destroy_many_moves;
+	moves.clear();
+	int src = new_count;
+	int tail_row = 0;
+	while (tail_row < rows.count() && rows[tail_row] < new_count) ++tail_row;
+	for (int i = 0; i < rows.count() && rows[i] < new_count; ++i) {
+		// Skip sources that are themselves being removed.
+		while (tail_row < rows.count() && rows[tail_row] == src) {
+			++src;
+			++tail_row;
+		}
+		moves.add(rows[i]);
+		moves.add(src++);
+	}
+
+	for (int i = 0; i < rows.count(); ++i) {
+		collection->entity_handle_table.free_handle(collection->entity_handles[rows[i]]);
+	}
+
+	handle_t* handles = collection->entity_handles.data();
+	for (int i = 0; i < moves.count(); i += 2) {
+		handles[moves[i]] = handles[moves[i + 1]];
+		collection->entity_handle_table.update_index(handles[moves[i]], moves[i]);
+	}
+	collection->entity_handles.set_count(new_count);
+
+	for (int i = 0; i < collection->component_tables.count(); ++i) {
+		typeless_array& table = collection->component_tables[i];
+		size_t size = table.m_element_size;
+		for (int j = 0; j < moves.count(); j += 2) {
+			CUTE_MEMCPY(table[moves[j]], table[moves[j + 1]], size);
+		}
+		table.m_count = new_count;
+
+		component_changes_t& changes = collection->component_changes[i];
+		if (changes.tracked) {
+			for (int j = 0; j < moves.count(); j += 2) {
+				changes.row_ticks[moves[j]] = changes.row_ticks[moves[j + 1]];
+			}
+			changes.row_ticks.set_count(new_count);
+		}
+	}
+}
+
+static int s_compare_handles(const void* a, const void* b)
+{
+	handle_t ha = *(const handle_t*)a;
+	handle_t hb = *(const handle_t*)b;
+	return ha < hb ? -1 : (ha > hb ? 1 : 0);
+}
+
+void entity_destroy_many(const entity_t* entities, int count)
+{
+	ecs_world_t* world = s_world();
+	if (world->destroying_many) {
+		// Called from a cleanup function in the middle of another batch, and the scratch arrays below
+		// are still in use.
+		for (int i = 0; i < count; ++i) entity_destroy(entities[i]);
+		return;
+	}
+	world->destroying_many = true;
+
+	// Group handles by collection. Rows are only looked up once they're needed, since cleanup
+	// functions may destroy entities and move rows around, just like in `entity_destroy`.
+	array<array<handle_t>>& handles = world->destroy_many_handles;
+	while (handles.count() < world->entity_collections.count()) handles.add();
+	for (int i = 0; i < handles.count(); ++i) handles[i].clear();
+
+	for (int i = 0; i < count; ++i) {
+		entity_t entity = entities[i];
+		entity_collection_t* collection = s_collection(entity);
+		if (!collection || !collection->entity_handle_table.is_valid(entity.handle)) continue;
+		handles[s_entity_type(entity)].add(entity.handle);
+	}
+
+	// Call cleanup functions, one table at a time.
+	for (int i = 0; i < handles.count(); ++i) {
+		array<handle_t>& collection_handles = handles[i];
+		if (!collection_handles.count()) continue;
+		CUTE_QSORT(collection_handles.data(), collection_handles.count(), sizeof(handle_t), s_compare_handles);
+		int unique_count = 0;
+		for (int j = 0; j < collection_handles.count(); ++j) {
+			if (!unique_count || collection_handles[unique_count - 1] != collection_handles[j]) collection_handles[unique_count++] = collection_handles[j];
+		}
+		collection_handles.set_count(unique_count);
+
+		entity_collection_t* collection = world->entity_collections.items() + i;
+		for (int j = 0; j < collection->component_tables.count(); ++j) {
+			component_config_t* config = world->component_configs.find(collection->component_type_tuple[j]);
+			if (!config->cleanup_fn) continue;
+			for (int k = 0; k < collection_handles.count(); ++k) {
+				handle_t h = collection_handles[k];
+				if (!collection->entity_handle_table.is_valid(h)) continue;
+				int row = collection->entity_handle_table.get_index(h);
+				entity_t entity = { h };
+				config->cleanup_fn(entity, collection->component_tables[j][row], config->cleanup_udata);
+			}
+		}
+	}
+
+	// Remove whatever is still alive, with rows fetched after all cleanups are done.
+	array<int>& rows = world->destroy_many_rows;
+	for (int i = 0; i < handles.count(); ++i) {
+		if (!handles[i].count()) continue;
+		entity_collection_t* collection = world->entity_collections.items() + i;
+		rows.clear();
+		for (int k = 0; k < handles[i].count(); ++k) {
+			handle_t h = handles[i][k];
+			if (collection->entity_handle_table.is_valid(h)) rows.add(collection->entity_handle_table.get_index(h));
+		}
+		if (!rows.count()) continue;
+		s_sort_unique(rows);
+		s_destroy_rows(collection, rows);
+	}
+
+	world->destroying_many = false;
+}
+
+static int s_compare_sort_keys(const void* a, const void* b)
+{
+	const ecs_sort_key_t* ka = (const ecs_sort_key_t*)a;
+	const ecs_sort_key_t* kb = (const ecs_sort_key_t*)b;
+	if (ka->key != kb->key) return ka->key < kb->key ? -1 : 1;
+	return ka->row - kb->row;
+}
+
+static int s_sort_rows(ecs_world_t* world, entity_collection_t* collection, int first, int count, ecs_sort_key_fn* key_fn, void* udata)
+{
+	// Sort the keys of rows [first, first + count), then gather each table into its new order through
+	// a scratch buffer. Ties are broken by row, so the sort is stable.
+	array<ecs_sort_key_t>& keys = world->sort_keys;
+	keys.ensure_count(count);
+	for (int i = 0; i < count; ++i) {
+		keys[i].key = key_fn({ collection->entity_handles[first + i] }, udata);
+		keys[i].row = first + i;
+	}
+	CUTE_QSORT(keys.data(), count, sizeof(ecs_sort_key_t), s_compare_sort_keys);
+
+	int moved = 0;
+	for (int i = 0; i < count; ++i) {
+		if (keys[i].row != first + i) ++moved;
+	}
+	if (!moved) return 0;
+
+	array<uint8_t>& scratch = world->sort_scratch;
+	auto gather = [&](void* rows, size_t size) {
+		uint8_t* base = (uint8_t*)rows;
+		scratch.ensure_count((int)(size * count));
+		CUTE_MEMCPY(scratch.data(), base + size * first, size * count);
+		for (int i = 0; i < count; ++i) {
+			int src = keys[i].row - first;
+			if (src != i) CUTE_MEMCPY(base + size * (first + i), scratch.data() + size * src, size);
+		}
+	};
+
+	gather(collection->entity_handles.data(), sizeof(handle_t));
+	for (int i = 0; i < collection->component_tables.count(); ++i) {
+		typeless_array& table = collection->component_tables[i];
+		gather(table.data(), table.m_element_size);
+		component_changes_t& changes = collection->component_changes[i];
+		if (changes.tracked) gather(changes.row_ticks.data(), sizeof(uint64_t));
+	}
+
+	for (int i = 0; i < count; ++i) {
+		if (keys[i].row != first + i) {
+			collection->entity_handle_table.update_index(collection->entity_handles[first + i], first + i);
+		}
+	}
+
+	return moved;
+}
+
+error_t ecs_sort_collection(const char* entity_type, ecs_sort_key_fn* key_fn, void* udata)
+{
+	ecs_world_t* world = s_world();
+	entity_type_t type = INVALID_ENTITY_TYPE;
+	world->entity_type_string_to_id.find(INJECT(entity_type), &type);
+	if (type == INVALID_ENTITY_TYPE) {
+		return error_failure("`entity_type` is not valid.");
+	}
+
+	entity_collection_t* collection = world->entity_collections.find(type);
+	CUTE_ASSERT(collection);
+	s_sort_rows(world, collection, 0, collection->entity_handles.count(), key_fn, udata);
+	collection->sort_cursor = 0;
+	return error_success();
+}
+
+int ecs_sort_collection_incremental(const char* entity_type, ecs_sort_key_fn* key_fn, void* udata, int budget)
+{
+	ecs_world_t* world = s_world();
+	entity_type_t type = INVALID_ENTITY_TYPE;
+	world->entity_type_string_to_id.find(INJECT(entity_type), &type);
+	if (type == INVALID_ENTITY_TYPE) return -1;
+
+	// Windows overlap by half, so entities far out of place travel half a window per visit, much
+	// like odd-even transposition sort over blocks.
+	entity_collection_t* collection = world->entity_collections.find(type);
+	CUTE_ASSERT(collection);
+	int entity_count = collection->entity_handles.count();
+	budget = max(budget, 2);
+	if (collection->sort_cursor >= entity_count - 1) collection->sort_cursor = 0;
+	int first = collection->sort_cursor;
+	int count = min(budget, entity_count - first);
+	int moved = s_sort_rows(world, collection, first, count, key_fn, udata);
+	collection->sort_cursor = first + count >= entity_count ? 0 : first + budget / 2;
+	return moved;
+}
+
+bool entity_is_valid(entity_t entity)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (collection) return collection->entity_handle_table.is_valid(entity.handle);
+	else return false;
+}
+
+void* entity_get_component(entity_t entity, component_id_t component_id)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (!collection) return NULL;
+
+	int column = s_column(collection, component_id);
+	if (column < 0) return NULL;
+
+	int index = collection->entity_handle_table.get_index(entity.handle);
+	return collection->component_tables[column][index];
+}
+
+void* entity_get_component(entity_t entity, const char* component_type)
+{
+	return entity_get_component(entity, ecs_component_get_id(component_type));
+}
+
+bool entity_has_component(entity_t entity, component_id_t component_id)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (!collection) return false;
+	return s_column(collection, component_id) >= 0;
+}
+
+bool entity_has_component(entity_t entity, const char* component_type)
+{
+	return entity_has_component(entity, ecs_component_get_id(component_type));
+}
+
+void* entity_get_component_for_write(entity_t entity, component_id_t component_id)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (!collection) return NULL;
+
+	int column = s_column(collection, component_id);
+	if (column < 0) return NULL;
+
+	int index = collection->entity_handle_table.get_index(entity.handle);
+	s_mark_dirty(collection, column, index);
+	return collection->component_tables[column][index];
+}
+
+void ecs_mark_dirty(entity_t entity, component_id_t component_id)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (!collection) return;
+	int index = collection->entity_handle_table.get_index(entity.handle);
+	s_mark_dirty(collection, s_column(collection, component_id), index);
+}
+
+void ecs_mark_dirty(entity_t entity, const char* component_type)
+{
+	ecs_mark_dirty(entity, ecs_component_get_id(component_type));
+}
+
+bool entity_component_changed_since(entity_t entity, component_id_t component_id, uint64_t change_tick)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (!collection) return false;
+	int index = collection->entity_handle_table.get_index(entity.handle);
+	return s_changed_since(collection, s_column(collection, component_id), index, change_tick);
+}
+
+uint64_t ecs_get_change_tick()
+{
+	ecs_world_t* world = s_world();
+	return world->ecs_change_tick;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static bool s_systems_conflict(const system_internal_t* a, const system_internal_t* b)
+{
+	// Systems that did not declare their component access could be touching anything.
+	if (!a->declared_access || !b->declared_access) return true;
+
+	// Any write by one system to a component the other system touches is a conflict. Reads may
+	// safely overlap.
+	if (s_match(a->write_component_type_tuple, b->component_type_tuple)) return true;
+	if (s_match(b->write_component_type_tuple, a->component_type_tuple)) return true;
+	return false;
+}
+
+static void s_build_system_schedule()
+{
+	// Systems are grouped into batches. A system is placed into the batch right after the latest
+	// batch containing a conflicting system registered before it. This preserves registration order
+	// between any two conflicting systems, while systems within a single batch can safely run at
+	// the same time.
+	ecs_world_t* world = s_world();
+	int system_count = world->systems.count();
+	array<int> batch_of_system;
+	batch_of_system.ensure_count(system_count);
+	world->system_schedule.clear();
+
+	for (int i = 0; i < system_count; ++i) {
+		int batch = 0;
+		for (int j = 0; j < i; ++j) {
+			if (batch_of_system[j] >= batch && s_systems_conflict(world->systems + i, world->systems + j)) {
+				batch = batch_of_system[j] + 1;
+			}
+		}
+		batch_of_system[i] = batch;
+		while (world->system_schedule.count() <= batch) world->system_schedule.add();
+		world->system_schedule[batch].add(i);
+	}
+
+	world->system_schedule_dirty = false;
+}
+
+static void s_update_range(system_internal_t* system, float dt, entity_type_t collection_type, entity_collection_t* collection, int offset, int count)
+{
+	ecs_world_t* world = s_world();
+	ecs_world_t* current_collection_world = s_current_collection_world;
+	entity_type_t current_collection_type = s_current_collection_type;
+	entity_collection_t* current_collection = s_current_collection;
+	s_current_collection_world = world;
+	s_current_collection_type = collection_type;
+	s_current_collection = collection;
+	CUTE_DEFER(s_current_collection_world = current_collection_world);
+	CUTE_DEFER(s_current_collection_type = current_collection_type);
+	CUTE_DEFER(s_current_collection = current_collection);
+
+	ecs_command_key_t command_key = s_command_key;
+	s_command_key.system = (uint32_t)(system - world->systems.data()) + 1;
+	s_command_key.collection = (uint32_t)collection_type + 1;
+	s_command_key.offset = (uint32_t)offset;
+	CUTE_DEFER(s_command_key = command_key);
+
+	ecs_arrays_t arrays;
+	arrays.offset = offset;
+	arrays.entities = collection->entity_handles.data() + offset;
+	arrays.collection = collection;
+	arrays.world = world;
+	arrays.since_tick = system->last_run_tick;
+	system->update_fn(dt, &arrays, count, system->udata);
+}
+
+struct system_range_job_t
+{
+	ecs_world_t* world;
+	system_internal_t* system;
+	float dt;
+	entity_type_t collection_type;
+	entity_collection_t* collection;
+};
+
+static void s_system_range_job(int begin, int end, void* udata)
+{
+	system_range_job_t* job = (system_range_job_t*)udata;
+	ecs_world_t* world = s_current_world;
+	s_current_world = job->world;
+	s_update_range(job->system, job->dt, job->collection_type, job->collection, begin, end - begin);
+	s_current_world = world;
+}
+
+static void s_update_collection(system_internal_t* system, float dt, entity_type_t collection_type, entity_collection_t* collection)
+{
+	ecs_world_t* world = s_world();
+	int count = collection->entity_handles.count();
+	int grain_size = system->parallel_for_grain_size;
+	if (!grain_size || !world->threadpool || count <= grain_size) {
+		s_update_range(system, dt, collection_type, collection, 0, count);
+		return;
+	}
+
+	// Slice the collection into grain-sized ranges and update them all on the threadpool. This may
+	// itself run on a worker thread, when the system is part of a parallel batch.
+	system_range_job_t job;
+	job.world = world;
+	job.system = system;
+	job.dt = dt;
+	job.collection_type = collection_type;
+	job.collection = collection;
+	parallel_for(world->threadpool, 0, count, grain_size, s_system_range_job, &job);
+}
+
+static void s_run_system(system_internal_t* system, float dt)
+{
+	ecs_world_t* world = s_world();
+	system_update_fn* update_fn = system->update_fn;
+	auto pre_update_fn = system->pre_update_fn;
+	auto post_update_fn = system->post_update_fn;
+	void* udata = system->udata;
+
+	ecs_command_key_t command_key = s_command_key;
+	s_command_key.system = (uint32_t)(system - world->systems.data()) + 1;
+	s_command_key.collection = 0;
+	s_command_key.offset = 0;
+	CUTE_DEFER(s_command_key = command_key);
+
+	ecs_system_stats_t& stats = system->stats;
+	stats.collections_updated = 0;
+	stats.entities_updated = 0;
+	timer_t timer = timer_init();
+
+	if (pre_update_fn) pre_update_fn(dt, udata);
+	stats.pre_update_seconds = timer_dt(&timer);
+
+	if (update_fn) {
+		for (int j = 0; j < system->matched_entity_types.count(); ++j) {
+			entity_type_t entity_type = system->matched_entity_types[j];
+			entity_collection_t* collection = world->entity_collections.find(entity_type);
+			CUTE_ASSERT(collection);
+			CUTE_ASSERT(collection->component_tables.count() == collection->component_type_tuple.count());
+			int entity_count = collection->entity_handles.count();
+			if (entity_count) {
+				stats.collections_updated++;
+				stats.entities_updated += entity_count;
+			}
+			s_update_collection(system, dt, entity_type, collection);
+		}
+	}
+	stats.update_seconds = timer_dt(&timer);
+
+	s_command_key.collection = ~0u;
+	if (post_update_fn) post_update_fn(dt, udata);
+	stats.post_update_seconds = timer_dt(&timer);
+	system->last_run_tick = world->ecs_change_tick;
+}
+
+struct system_task_t
+{
+	ecs_world_t* world;
+	system_internal_t* system;
+	float dt;
+};
+
+static void s_system_task(void* param)
+{
+	system_task_t* task = (system_task_t*)param;
+	ecs_world_t* world = s_current_world;
+	s_current_world = task->world;
+	s_run_system(task->system, task->dt);
+	s_current_world = world;
+}
+
+void ecs_run_systems(float dt)
+{
+	ecs_run_systems(s_world(), dt);
+}
+
+void ecs_run_systems(ecs_world_t* world, float dt)
+{
+	ecs_world_t* current_world = s_current_world;
+	s_current_world = world;
+	CUTE_DEFER(s_current_world = current_world);
+
+	if (world->system_schedule_dirty) {
+		s_build_system_schedule();
+	}
 
-		// Update index in case user changed it (by destroying enties).
-		index = collection->entity_handle_table.get_index(entity.handle);
+	array<system_task_t> tasks;
+	for (int i = 0; i < world->system_schedule.count(); ++i) {
+		const array<int>& batch = world->system_schedule[i];
 
-		// Free the handle.
-		collection->entity_handles.unordered_remove(index);
-		collection->entity_handle_table.free_handle(entity.handle);
+		// Each batch gets its own change tick, so later systems see changes made by earlier batches.
+		world->ecs_change_tick++;
 
-		// Free each component.
-		for (int i = 0; i < collection->component_tables.count(); ++i) {
-			collection->component_tables[i].unordered_remove(index);
+		if (batch.count() == 1 || !world->threadpool) {
+			for (int j = 0; j < batch.count(); ++j) {
+				s_run_system(world->systems + batch[j], dt);
+			}
+			continue;
 		}
 
-		// Update handle of the swapped entity.
-		if (index < collection->entity_handles.size()) {
-			uint64_t h = collection->entity_handles[index];
-			collection->entity_handle_table.update_index(h, index);
+		// Run all systems in the batch on the threadpool, and wait for every one of them to finish
+		// before moving onto the next batch.
+		task_counter_t counter = { };
+		tasks.clear();
+		tasks.ensure_capacity(batch.count());
+		for (int j = 0; j < batch.count(); ++j) {
+			system_task_t& task = tasks.add();
+			task.world = world;
+			task.system = world->systems + batch[j];
+			task.dt = dt;
+			threadpool_add_task(world->threadpool, s_system_task, &task, &counter);
 		}
+		threadpool_wait_counter(world->threadpool, &counter);
 	}
+
+	// Sync point for structural changes recorded by the systems.
+	ecs_flush_delayed_commands();
+
+	// Changes made outside of systems are newer than every system's last run.
+	world->ecs_change_tick++;
 }
 
-bool entity_is_valid(entity_t entity)
+//--------------------------------------------------------------------------------------------------
+// Worlds.
+
+static atomic_int_t s_world_id_gen = atomic_zero();
+
+ecs_world_t* ecs_world_make(threadpool_t* threadpool, void* user_allocator_context)
 {
-	entity_collection_t* collection = s_collection(entity);
-	if (collection) return collection->entity_handle_table.is_valid(entity.handle);
-	else return false;
+	ecs_world_t* world = (ecs_world_t*)CUTE_ALLOC(sizeof(ecs_world_t), user_allocator_context);
+	CUTE_PLACEMENT_NEW(world) ecs_world_t;
+	world->id = atomic_add(&s_world_id_gen, 1) + 1;
+	world->strpool = make_strpool();
+	world->threadpool = threadpool;
+	world->mem_ctx = user_allocator_context;
+	return world;
 }
 
-void* entity_get_component(entity_t entity, const char* component_type)
+void ecs_world_destroy(ecs_world_t* world)
 {
-	entity_collection_t* collection = s_collection(entity);
-	if (!collection) return NULL;
-
-	strpool_id type = INJECT(component_type);
-	const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
-	for (int i = 0; i < component_type_tuple.count(); ++i)
-	{
-		if (component_type_tuple[i].val == type.val) {
-			int index = collection->entity_handle_table.get_index(entity.handle);
-			return collection->component_tables[i][index];
-		}
-	}
+	if (!world) return;
+	if (s_current_world == world) s_current_world = NULL;
+	s_destroy_command_buffers(world);
+	mutex_destroy(&world->command_buffers_mutex);
+	int schema_count = world->entity_parsed_schemas.count();
+	kv_t** schemas = world->entity_parsed_schemas.items();
+	for (int i = 0; i < schema_count; ++i) kv_destroy(schemas[i]);
+	destroy_strpool(world->strpool);
+	void* mem_ctx = world->mem_ctx;
+	world->~ecs_world_t();
+	CUTE_FREE(world, mem_ctx);
+}
 
-	return NULL;
+void ecs_set_world(ecs_world_t* world)
+{
+	s_current_world = world;
 }
 
-bool entity_has_component(entity_t entity, const char* component_type)
+ecs_world_t* ecs_get_world()
 {
-	return entity_get_component(entity, component_type) ? true : false;
+	return s_world();
 }
 
 //--------------------------------------------------------------------------------------------------
 
-static inline int s_match(const array<strpool_id>& a, const array<strpool_id>& b)
+void ecs_component_begin()
 {
-	int matches = 0;
-	for (int i = 0; i < a.count(); ++i) {
-		for (int j = 0; j < b.count(); ++j) {
-			if (a[i].val == b[j].val) {
-				++matches;
-				break;
-			}
-		}
-	}
-	return matches;
+	ecs_world_t* world = s_world();
+	world->component_config_builder.clear();
 }
 
-void ecs_run_systems(float dt)
+component_id_t ecs_component_end()
 {
-	int system_count = app->systems.count();
-	for (int i = 0; i < system_count; ++i) {
-		system_internal_t* system = app->systems + i;
-		system_update_fn* update_fn = system->update_fn;
-		auto pre_update_fn = system->pre_update_fn;
-		auto post_update_fn = system->post_update_fn;
-		void* udata = system->udata;
-
-		if (pre_update_fn) pre_update_fn(dt, udata);
-
-		if (update_fn) {
-			for (int j = 0; j < app->entity_collections.count(); ++j) {
-				entity_collection_t* collection = app->entity_collections.items() + j;
-				CUTE_ASSERT(collection->component_tables.count() == collection->component_type_tuple.count());
-				int component_count = collection->component_tables.count();
-				app->current_collection_type_being_iterated = app->entity_collections.keys()[j];
-				app->current_collection_being_updated = collection;
-				CUTE_DEFER(app->current_collection_type_being_iterated = INVALID_ENTITY_TYPE);
-				CUTE_DEFER(app->current_collection_being_updated = NULL);
-
-				int matches = s_match(system->component_type_tuple, collection->component_type_tuple);
-
-				if (matches == system->component_type_tuple.count()) {
-					s_arrays.count = collection->component_type_tuple.count();
-					s_arrays.ptrs = &collection->component_tables;
-					s_arrays.types = collection->component_type_tuple.data();
-					s_arrays.entities = collection->entity_handles.data();
-					update_fn(dt, &s_arrays, collection->component_tables[0].count(), udata);
-				}
-			}
-		}
+	ecs_world_t* world = s_world();
 
-		if (post_update_fn) post_update_fn(dt, udata);
+	// Pad the size so every component in a table stays aligned.
+	component_config_t& builder = world->component_config_builder;
+	if (builder.alignment) {
+		builder.size_of_component = (builder.size_of_component + builder.alignment - 1) & ~(builder.alignment - 1);
 	}
 
-	for (int i = 0; i < app->delayed_destroy_entities.count(); ++i) {
-		entity_t e = app->delayed_destroy_entities[i];
-		entity_destroy(e);
-	}
-	app->delayed_destroy_entities.clear();
+	// Component ids are handed out in registration order, matching the item index within `component_configs`.
+	component_config_t* config = world->component_configs.insert(INJECT(world->component_config_builder.name), world->component_config_builder);
+	config->id = world->component_configs.count() - 1;
+	if (config->id_out) *config->id_out = config->id;
+	return config->id;
 }
 
-//--------------------------------------------------------------------------------------------------
+void ecs_component_set_name(const char* name)
+{
+	ecs_world_t* world = s_world();
+	world->component_config_builder.name = name;
+}
 
-void ecs_component_begin()
+void ecs_component_set_size(size_t size)
 {
-	app->component_config_builder.clear();
+	ecs_world_t* world = s_world();
+	world->component_config_builder.size_of_component = size;
 }
 
-void ecs_component_end()
+void ecs_component_set_alignment(size_t alignment)
 {
-	app->component_configs.insert(INJECT(app->component_config_builder.name), app->component_config_builder);
+	CUTE_ASSERT(alignment && !(alignment & (alignment - 1)));
+	ecs_world_t* world = s_world();
+	world->component_config_builder.alignment = alignment;
 }
 
-void ecs_component_set_name(const char* name)
+void ecs_component_set_optional_id_out(component_id_t* id_out)
 {
-	app->component_config_builder.name = name;
+	ecs_world_t* world = s_world();
+	world->component_config_builder.id_out = id_out;
 }
 
-void ecs_component_set_size(size_t size)
+component_id_t ecs_component_get_id(const char* component_type)
+{
+	ecs_world_t* world = s_world();
+	component_config_t* config = world->component_configs.find(INJECT(component_type));
+	return config ? config->id : INVALID_COMPONENT_ID;
+}
+
+size_t ecs_component_get_size(component_id_t component_id)
 {
-	app->component_config_builder.size_of_component = size;
+	ecs_world_t* world = s_world();
+	if (component_id < 0 || component_id >= world->component_configs.count()) return 0;
+	return world->component_configs.items()[component_id].size_of_component;
 }
 
 void ecs_component_set_optional_serializer(component_serialize_fn* serializer_fn, void* udata)
 {
-	app->component_config_builder.serializer_fn = serializer_fn;
-	app->component_config_builder.serializer_udata = udata;
+	ecs_world_t* world = s_world();
+	world->component_config_builder.serializer_fn = serializer_fn;
+	world->component_config_builder.serializer_udata = udata;
 }
 
 void ecs_component_set_optional_cleanup(component_cleanup_fn* cleanup_fn, void* udata)
 {
-	app->component_config_builder.cleanup_fn = cleanup_fn;
-	app->component_config_builder.cleanup_udata = udata;
+	ecs_world_t* world = s_world();
+	world->component_config_builder.cleanup_fn = cleanup_fn;
+	world->component_config_builder.cleanup_udata = udata;
+}
+
+void ecs_component_set_optional_prototype(bool bake_prototype)
+{
+	ecs_world_t* world = s_world();
+	world->component_config_builder.bake_prototype = bake_prototype;
+}
+
+void ecs_component_set_optional_pod(bool is_pod, uint32_t layout_version)
+{
+	ecs_world_t* world = s_world();
+	world->component_config_builder.is_pod = is_pod;
+	world->component_config_builder.layout_version = layout_version;
+}
+
+void ecs_component_set_optional_change_tracking(bool track_changes)
+{
+	ecs_world_t* world = s_world();
+	world->component_config_builder.track_changes = track_changes;
+}
+
+void ecs_component_set_optional_post_construct(component_post_construct_fn* post_construct_fn, void* udata)
+{
+	ecs_world_t* world = s_world();
+	world->component_config_builder.post_construct_fn = post_construct_fn;
+	world->component_config_builder.post_construct_udata = udata;
 }
 
 static strpool_id s_kv_string(kv_t* kv, const char* key)
 {
+	ecs_world_t* world = s_world();
 	error_t err = kv_key(kv, key);
 	if (err.is_error()) {
 		if (CUTE_STRCMP(key, "inherits_from")) {
@@ -380,12 +1393,63 @@ static strpool_id s_kv_string(kv_t* kv, const char* key)
 		return { 0 };
 	}
 
-	return strpool_inject(app->strpool, string_raw, (int)string_sz);
+	return strpool_inject(world->strpool, string_raw, (int)string_sz);
+}
+
+static void s_add_column(entity_collection_t* collection, strpool_id component_type)
+{
+	ecs_world_t* world = s_world();
+	component_config_t* config = world->component_configs.find(component_type);
+	CUTE_ASSERT(config);
+
+	int column = collection->component_tables.count();
+	collection->component_type_tuple.add(component_type);
+	typeless_array& table = collection->component_tables.add();
+	table.m_element_size = config->size_of_component;
+	table.set_alignment(config->alignment);
+	typeless_array& prototype = collection->component_prototypes.add();
+	prototype.m_element_size = config->size_of_component;
+	prototype.set_alignment(config->alignment);
+	component_changes_t& changes = collection->component_changes.add();
+	changes.tracked = config->track_changes;
+
+	// Record the column for this component id, so looking up components by id is a single index.
+	while (collection->component_columns.count() <= config->id) collection->component_columns.add(-1);
+	collection->component_columns[config->id] = column;
+}
+
+static void s_bake_prototypes(entity_type_t entity_type, entity_collection_t* collection)
+{
+	// Run the serializers once against the schema (and inheritence chain) for components that opted
+	// in, so `entity_make` can simply copy the bytes.
+	ecs_world_t* world = s_world();
+	for (int i = 0; i < collection->component_type_tuple.count(); ++i) {
+		component_config_t* config = world->component_configs.find(collection->component_type_tuple[i]);
+		if (!config->bake_prototype) continue;
+
+		typeless_array& prototype = collection->component_prototypes[i];
+		void* component = prototype.add();
+		CUTE_MEMSET(component, 0, config->size_of_component);
+		error_t err = s_load_from_schema(entity_type, INVALID_ENTITY, config, component, config->serializer_udata);
+		if (err.is_error()) {
+			CUTE_DEBUG_PRINTF("Unable to bake prototype for component `%s`, falling back to the serializer.\n", config->name);
+			prototype.clear();
+		}
+	}
+}
+
+static void s_match_systems_to_new_collection(entity_type_t entity_type, const entity_collection_t* collection)
+{
+	ecs_world_t* world = s_world();
+	for (int i = 0; i < world->systems.count(); ++i) {
+		s_match_system_to_collection(world->systems + i, entity_type, collection);
+	}
 }
 
 static void s_register_entity_type(const char* schema)
 {
 	// Parse the schema.
+	ecs_world_t* world = s_world();
 	kv_t* kv = kv_make();
 	bool cleanup_kv = true;
 	CUTE_DEFER(if (cleanup_kv) kv_destroy(kv));
@@ -397,17 +1461,17 @@ static void s_register_entity_type(const char* schema)
 	}
 
 	strpool_id entity_type_string = s_kv_string(kv, "entity_type");
-	if (!strpool_isvalid(app->strpool, entity_type_string)) return;
+	if (!strpool_isvalid(world->strpool, entity_type_string)) return;
 	
 	strpool_id inherits_from_string = s_kv_string(kv, "inherits_from");
 	entity_type_t inherits_from = INVALID_ENTITY_TYPE;
-	if (strpool_isvalid(app->strpool, inherits_from_string)) {
-		app->entity_type_string_to_id.find(inherits_from_string, &inherits_from);
+	if (strpool_isvalid(world->strpool, inherits_from_string)) {
+		world->entity_type_string_to_id.find(inherits_from_string, &inherits_from);
 	}
 
 	// Search for all component types present in the schema.
-	int component_config_count = app->component_configs.count();
-	const component_config_t* component_configs = app->component_configs.items();
+	int component_config_count = world->component_configs.count();
+	const component_config_t* component_configs = world->component_configs.items();
 	array<strpool_id> component_type_tuple;
 	for (int i = 0; i < component_config_count; ++i)
 	{
@@ -421,23 +1485,22 @@ static void s_register_entity_type(const char* schema)
 	kv_reset_read_state(kv);
 
 	// Register component types.
-	entity_type_t entity_type = app->entity_type_gen++;
-	app->entity_type_string_to_id.insert(entity_type_string, entity_type);
-	app->entity_type_id_to_string.add(entity_type_string);
-	entity_collection_t* collection = app->entity_collections.insert(entity_type);
+	entity_type_t entity_type = world->entity_type_gen++;
+	world->entity_type_string_to_id.insert(entity_type_string, entity_type);
+	world->entity_type_id_to_string.add(entity_type_string);
+	entity_collection_t* collection = world->entity_collections.insert(entity_type);
 	for (int i = 0; i < component_type_tuple.count(); ++i)
 	{
-		collection->component_type_tuple.add(component_type_tuple[i]);
-		typeless_array& table = collection->component_tables.add();
-		component_config_t* config = app->component_configs.find(component_type_tuple[i]);
-		table.m_element_size = config->size_of_component;
+		s_add_column(collection, component_type_tuple[i]);
 	}
+	s_match_systems_to_new_collection(entity_type, collection);
 
 	// Store the parsed schema.
-	app->entity_parsed_schemas.insert(entity_type, kv);
+	world->entity_parsed_schemas.insert(entity_type, kv);
 	if (inherits_from != INVALID_ENTITY_TYPE) {
-		app->entity_schema_inheritence.insert(entity_type, inherits_from);
+		world->entity_schema_inheritence.insert(entity_type, inherits_from);
 	}
+	s_bake_prototypes(entity_type, collection);
 
 	cleanup_kv = false;
 }
@@ -445,8 +1508,9 @@ static void s_register_entity_type(const char* schema)
 static void s_register_entity_type(array<const char*> component_type_tuple, const char* entity_type_string)
 {
 	// Search for all component types present in the schema.
-	int component_config_count = app->component_configs.count();
-	const component_config_t* component_configs = app->component_configs.items();
+	ecs_world_t* world = s_world();
+	int component_config_count = world->component_configs.count();
+	const component_config_t* component_configs = world->component_configs.items();
 	array<strpool_id> component_type_ids;
 	for (int i = 0; i < component_config_count; ++i)
 	{
@@ -467,53 +1531,64 @@ static void s_register_entity_type(array<const char*> component_type_tuple, cons
 
 	// Register component types.
 	strpool_id entity_type_string_id = INJECT(entity_type_string);
-	entity_type_t entity_type = app->entity_type_gen++;
-	app->entity_type_string_to_id.insert(entity_type_string_id, entity_type);
-	app->entity_type_id_to_string.add(entity_type_string_id);
-	entity_collection_t* collection = app->entity_collections.insert(entity_type);
+	entity_type_t entity_type = world->entity_type_gen++;
+	world->entity_type_string_to_id.insert(entity_type_string_id, entity_type);
+	world->entity_type_id_to_string.add(entity_type_string_id);
+	entity_collection_t* collection = world->entity_collections.insert(entity_type);
 	for (int i = 0; i < component_type_ids.count(); ++i)
 	{
-		collection->component_type_tuple.add(component_type_ids[i]);
-		typeless_array& table = collection->component_tables.add();
-		component_config_t* config = app->component_configs.find(component_type_ids[i]);
-		table.m_element_size = config->size_of_component;
+		s_add_column(collection, component_type_ids[i]);
 	}
+	s_match_systems_to_new_collection(entity_type, collection);
+	s_bake_prototypes(entity_type, collection);
 }
 
 
 void ecs_entity_begin()
 {
-	app->entity_config_builder.clear();
+	ecs_world_t* world = s_world();
+	world->entity_config_builder.clear();
 }
 
 void ecs_entity_end()
 {
-	if (app->entity_config_builder.schema.is_valid()) {
-		s_register_entity_type(app->entity_config_builder.schema.c_str());
+	ecs_world_t* world = s_world();
+	if (world->entity_config_builder.schema.count()) {
+		s_register_entity_type(world->entity_config_builder.schema.data());
+		world->entity_schemas.add().steal_from(&world->entity_config_builder.schema);
 	} else {
-		s_register_entity_type(app->entity_config_builder.component_types, app->entity_config_builder.entity_type);
+		s_register_entity_type(world->entity_config_builder.component_types, world->entity_config_builder.entity_type);
 	}
 }
 
 void ecs_entity_set_name(const char* entity_type)
 {
-	app->entity_config_builder.entity_type = entity_type;
+	ecs_world_t* world = s_world();
+	world->entity_config_builder.entity_type = entity_type;
 }
 
 void ecs_entity_add_component(const char* component_type)
 {
-	app->entity_config_builder.component_types.add(component_type);
+	ecs_world_t* world = s_world();
+	world->entity_config_builder.component_types.add(component_type);
 }
 
 void ecs_entity_set_optional_schema(const char* schema)
 {
-	app->entity_config_builder.schema = schema;
+	ecs_world_t* world = s_world();
+	array<char>& copy = world->entity_config_builder.schema;
+	copy.clear();
+	if (!schema) return;
+	int size = (int)CUTE_STRLEN(schema) + 1;
+	copy.ensure_count(size);
+	CUTE_MEMCPY(copy.data(), schema, size);
 }
 
 const char* entity_get_type_string(entity_t entity)
 {
+	ecs_world_t* world = s_world();
 	entity_type_t entity_type = s_entity_type(entity);
-	return strpool_cstr(app->strpool, app->entity_type_id_to_string[entity_type]);
+	return strpool_cstr(world->strpool, world->entity_type_id_to_string[entity_type]);
 }
 
 bool entity_is_type(entity_t entity, const char* entity_type_name)
@@ -525,15 +1600,17 @@ bool entity_is_type(entity_t entity, const char* entity_type_name)
 
 entity_type_t s_entity_type(kv_t* kv)
 {
+	ecs_world_t* world = s_world();
 	strpool_id entity_type_string = s_kv_string(kv, "entity_type");
-	if (!strpool_isvalid(app->strpool, entity_type_string)) return INVALID_ENTITY_TYPE;
+	if (!strpool_isvalid(world->strpool, entity_type_string)) return INVALID_ENTITY_TYPE;
 	entity_type_t entity_type = INVALID_ENTITY_TYPE;
-	app->entity_type_string_to_id.find(entity_type_string, &entity_type);
+	world->entity_type_string_to_id.find(entity_type_string, &entity_type);
 	return entity_type;
 }
 
 static error_t s_fill_load_id_table(kv_t* kv)
 {
+	ecs_world_t* world = s_world();
 	int entity_count;
 	error_t err = kv_array_begin(kv, &entity_count, "entities");
 	if (err.is_error()) {
@@ -549,7 +1626,7 @@ static error_t s_fill_load_id_table(kv_t* kv)
 			return error_failure("Unable to find entity type.");
 		}
 
-		entity_collection_t* collection = app->entity_collections.find(entity_type);
+		entity_collection_t* collection = world->entity_collections.find(entity_type);
 		CUTE_ASSERT(collection);
 
 		int index = collection->entity_handles.count();
@@ -558,7 +1635,7 @@ static error_t s_fill_load_id_table(kv_t* kv)
 
 		entity_t entity;
 		entity.handle = h;
-		app->load_id_table->add(entity);
+		world->load_id_table->add(entity);
 
 		kv_object_end(kv);
 	}
@@ -570,13 +1647,14 @@ static error_t s_fill_load_id_table(kv_t* kv)
 
 error_t ecs_load_entities(kv_t* kv, array<entity_t>* entities_out)
 {
+	ecs_world_t* world = s_world();
 	if (kv_get_state(kv) != KV_STATE_READ) {
 		return error_failure("`kv` must be in `KV_STATE_READ` mode.");
 	}
 	
 	array<entity_t> load_id_table;
-	app->load_id_table = &load_id_table;
-	CUTE_DEFER(app->load_id_table = NULL);
+	world->load_id_table = &load_id_table;
+	CUTE_DEFER(world->load_id_table = NULL);
 
 	error_t err = s_fill_load_id_table(kv);
 	if (err.is_error()) return err;
@@ -598,14 +1676,14 @@ error_t ecs_load_entities(kv_t* kv, array<entity_t>* entities_out)
 			return error_failure("Unable to find entity type.");
 		}
 
-		entity_collection_t* collection = app->entity_collections.find(entity_type);
+		entity_collection_t* collection = world->entity_collections.find(entity_type);
 		CUTE_ASSERT(collection);
 
 		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
 		for (int i = 0; i < component_type_tuple.count(); ++i)
 		{
 			strpool_id component_type = component_type_tuple[i];
-			component_config_t* config = app->component_configs.find(component_type);
+			component_config_t* config = world->component_configs.find(component_type);
 
 			if (!config) {
 				return error_failure("Unable to find component config.");
@@ -613,7 +1691,7 @@ error_t ecs_load_entities(kv_t* kv, array<entity_t>* entities_out)
 
 			// First load values from the schema.
 			void* component = collection->component_tables[i].add();
-			err = s_load_from_schema(entity_type, entity, config, component, config->serializer_udata);
+			err = s_construct_component(entity_type, collection, i, config, entity, component);
 			if (err.is_error()) {
 				return error_failure("Unable to parse component from schema.");
 			}
@@ -630,6 +1708,7 @@ error_t ecs_load_entities(kv_t* kv, array<entity_t>* entities_out)
 		}
 
 		kv_object_end(kv);
+		s_track_new_rows(collection);
 	}
 
 	kv_array_end(kv);
@@ -643,6 +1722,7 @@ error_t ecs_load_entities(kv_t* kv, array<entity_t>* entities_out)
 
 error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 {
+	ecs_world_t* world = s_world();
 	if (kv_get_state(kv) != KV_STATE_WRITE) {
 		return error_failure("`kv` must be in `KV_STATE_WRITE` mode.");
 	}
@@ -651,8 +1731,8 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 	for (int i = 0; i < entities.count(); ++i)
 		id_table.insert(entities[i], i);
 
-	app->save_id_table = &id_table;
-	CUTE_DEFER(app->save_id_table = NULL);
+	world->save_id_table = &id_table;
+	CUTE_DEFER(world->save_id_table = NULL);
 
 	int entity_count = entities.count();
 	error_t err = kv_array_begin(kv, &entity_count, "entities");
@@ -662,7 +1742,7 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 	{
 		entity_t entity = entities[i];
 		entity_type_t entity_type = s_entity_type(entity);
-		entity_collection_t* collection = app->entity_collections.find(entity_type);
+		entity_collection_t* collection = world->entity_collections.find(entity_type);
 		if (!collection) {
 			return error_failure("Unable to find entity type.");
 		}
@@ -676,7 +1756,7 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 		kv_object_begin(kv);
 
 		kv_key(kv, "entity_type");
-		const char* entity_type_string = strpool_cstr(app->strpool, app->entity_type_id_to_string[entity_type]);
+		const char* entity_type_string = strpool_cstr(world->strpool, world->entity_type_id_to_string[entity_type]);
 		size_t entity_type_string_len = CUTE_STRLEN(entity_type_string);
 		kv_val_string(kv, &entity_type_string, &entity_type_string_len);
 
@@ -686,7 +1766,7 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 		{
 			strpool_id component_type = component_type_tuple[j];
 			const typeless_array& component_table = component_tables[j];
-			component_config_t* config = app->component_configs.find(component_type);
+			component_config_t* config = world->component_configs.find(component_type);
 			const void* component = component_table[index];
 
 			error_t err = kv_object_begin(kv, config->name);
@@ -709,19 +1789,20 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 
 error_t ecs_save_entities(const array<entity_t>& entities)
 {
+	ecs_world_t* world = s_world();
 	dictionary<entity_t, int> id_table;
 	for (int i = 0; i < entities.count(); ++i)
 		id_table.insert(entities[i], i);
 
-	app->save_id_table = &id_table;
-	CUTE_DEFER(app->save_id_table = NULL);
+	world->save_id_table = &id_table;
+	CUTE_DEFER(world->save_id_table = NULL);
 
 	int entity_count = entities.count();
 	for (int i = 0; i < entities.count(); ++i)
 	{
 		entity_t entity = entities[i];
 		entity_type_t entity_type = s_entity_type(entity);
-		entity_collection_t* collection = app->entity_collections.find(entity_type);
+		entity_collection_t* collection = world->entity_collections.find(entity_type);
 		if (!collection) {
 			return error_failure("Unable to find entity type.");
 		}
@@ -732,7 +1813,7 @@ error_t ecs_save_entities(const array<entity_t>& entities)
 		}
 		uint32_t index = collection->entity_handle_table.get_index(entity.handle);
 
-		const char* entity_type_string = strpool_cstr(app->strpool, app->entity_type_id_to_string[entity_type]);
+		const char* entity_type_string = strpool_cstr(world->strpool, world->entity_type_id_to_string[entity_type]);
 
 		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
 		const array<typeless_array>& component_tables = collection->component_tables;
@@ -740,7 +1821,7 @@ error_t ecs_save_entities(const array<entity_t>& entities)
 		{
 			strpool_id component_type = component_type_tuple[j];
 			const typeless_array& component_table = component_tables[j];
-			component_config_t* config = app->component_configs.find(component_type);
+			component_config_t* config = world->component_configs.find(component_type);
 			const void* component = component_table[index];
 
 			error_t err = config->serializer_fn(NULL, false, entity, (void*)component, config->serializer_udata);
@@ -753,9 +1834,426 @@ error_t ecs_save_entities(const array<entity_t>& entities)
 	return error_success();
 }
 
+//--------------------------------------------------------------------------------------------------
+// Binary snapshots.
+
+#define CUTE_SNAPSHOT_MAGIC "cfecsss"
+#define CUTE_SNAPSHOT_VERSION 1
+
+enum snapshot_column_mode_t : uint32_t
+{
+	SNAPSHOT_COLUMN_MODE_RAW,
+	SNAPSHOT_COLUMN_MODE_KV,
+};
+
+static uint64_t s_layout_hash(const component_config_t* config)
+{
+	// FNV-1a over the component name, size and layout version.
+	uint64_t h = 14695981039346656037ULL;
+	for (const char* c = config->name; *c; ++c) h = (h ^ (uint8_t)*c) * 1099511628211ULL;
+	uint64_t extra[2] = { (uint64_t)config->size_of_component, (uint64_t)config->layout_version };
+	const uint8_t* bytes = (const uint8_t*)extra;
+	for (int i = 0; i < (int)sizeof(extra); ++i) h = (h ^ bytes[i]) * 1099511628211ULL;
+	return h;
+}
+
+static CUTE_INLINE bool s_is_raw(const component_config_t* config)
+{
+	// Components without a serializer may still own pointers, so only plain old data is copied as-is.
+	return config->is_pod;
+}
+
+struct snapshot_writer_t
+{
+	void write(const void* data, size_t size)
+	{
+		int offset = buffer.count();
+		buffer.ensure_count(offset + (int)size);
+		CUTE_MEMCPY(buffer.data() + offset, data, size);
+	}
+
+	void write_u32(uint32_t val) { write(&val, sizeof(val)); }
+	void write_u64(uint64_t val) { write(&val, sizeof(val)); }
+
+	void write_string(const char* string)
+	{
+		uint32_t len = (uint32_t)CUTE_STRLEN(string);
+		write_u32(len);
+		write(string, len);
+	}
+
+	array<uint8_t> buffer;
+};
+
+struct snapshot_reader_t
+{
+	const void* read(size_t size)
+	{
+		if (error || size > (size_t)(end - p)) {
+			error = true;
+			return NULL;
+		}
+		const uint8_t* data = p;
+		p += size;
+		return data;
+	}
+
+	uint32_t read_u32() { uint32_t val = 0; const void* data = read(sizeof(val)); if (data) CUTE_MEMCPY(&val, data, sizeof(val)); return val; }
+	uint64_t read_u64() { uint64_t val = 0; const void* data = read(sizeof(val)); if (data) CUTE_MEMCPY(&val, data, sizeof(val)); return val; }
+
+	strpool_id read_string()
+	{
+		uint32_t len = read_u32();
+		const char* string = (const char*)read(len);
+		if (!string) return { 0 };
+		return strpool_inject(strpool, string, (int)len);
+	}
+
+	strpool_t* strpool = NULL;
+	const uint8_t* p = NULL;
+	const uint8_t* end = NULL;
+	bool error = false;
+};
+
+struct snapshot_column_t
+{
+	strpool_id component_type;
+	uint64_t layout_hash;
+	uint32_t size_of_component;
+	uint32_t mode;
+	const void* data;
+	uint32_t data_size;
+};
+
+struct snapshot_collection_t
+{
+	entity_type_t entity_type;
+	int entity_count;
+	const void* handle_table;
+	uint32_t handle_table_size;
+	const void* entity_handles;
+	array<snapshot_column_t> columns;
+};
+
+error_t ecs_save_snapshot(void** snapshot_out, size_t* size_out, void* user_allocator_context)
+{
+	// Entities referenced from serialized components are saved as indices into the list of all entities,
+	// in snapshot order. The handles are restored exactly upon load, so the indices map back 1:1.
+	ecs_world_t* world = s_world();
+	dictionary<entity_t, int> id_table;
+	int collection_count = world->entity_collections.count();
+	entity_collection_t* collections = world->entity_collections.items();
+	for (int i = 0; i < collection_count; ++i) {
+		const array<handle_t>& handles = collections[i].entity_handles;
+		for (int j = 0; j < handles.count(); ++j) {
+			id_table.insert({ handles[j] }, id_table.count());
+		}
+	}
+	world->save_id_table = &id_table;
+	CUTE_DEFER(world->save_id_table = NULL);
+
+	snapshot_writer_t w;
+	w.write(CUTE_SNAPSHOT_MAGIC, 8);
+	w.write_u32(CUTE_SNAPSHOT_VERSION);
+	w.write_u32((uint32_t)collection_count);
+
+	for (int i = 0; i < collection_count; ++i) {
+		entity_collection_t* collection = collections + i;
+		entity_type_t entity_type = world->entity_collections.keys()[i];
+		int entity_count = collection->entity_handles.count();
+
+		w.write_string(strpool_cstr(world->strpool, world->entity_type_id_to_string[entity_type]));
+		w.write_u32(entity_type);
+		w.write_u32((uint32_t)entity_count);
+
+		handle_allocator_t* handle_table = collection->entity_handle_table.m_alloc;
+		size_t handle_table_size = handle_allocator_save_size(handle_table);
+		w.write_u32((uint32_t)handle_table_size);
+		int offset = w.buffer.count();
+		w.buffer.ensure_count(offset + (int)handle_table_size);
+		handle_allocator_save(handle_table, w.buffer.data() + offset);
+		w.write(collection->entity_handles.data(), sizeof(handle_t) * entity_count);
+
+		w.write_u32((uint32_t)collection->component_tables.count());
+		for (int j = 0; j < collection->component_tables.count(); ++j) {
+			component_config_t* config = world->component_configs.find(collection->component_type_tuple[j]);
+			const typeless_array& table = collection->component_tables[j];
+			w.write_string(config->name);
+			w.write_u64(s_layout_hash(config));
+			w.write_u32((uint32_t)config->size_of_component);
+
+			if (!s_is_raw(config) && !config->serializer_fn) {
+				return error_failure("Snapshot components must be plain old data or have a serializer.");
+			}
+
+			if (s_is_raw(config)) {
+				w.write_u32(SNAPSHOT_COLUMN_MODE_RAW);
+				w.write_u32((uint32_t)(config->size_of_component * entity_count));
+				w.write(table.data(), config->size_of_component * entity_count);
+			} else {
+				kv_t* kv = kv_make();
+				CUTE_DEFER(kv_destroy(kv));
+				kv_write_mode(kv);
+				int count = entity_count;
+				kv_array_begin(kv, &count, "components");
+				for (int k = 0; k < entity_count; ++k) {
+					kv_object_begin(kv);
+					error_t err = config->serializer_fn(kv, false, { collection->entity_handles[k] }, (void*)table[k], config->serializer_udata);
+					kv_object_end(kv);
+					if (err.is_error()) return error_failure("Unable to save component.");
+				}
+				kv_array_end(kv);
+				if (kv_error_state(kv).is_error()) return error_failure("Unable to save component.");
+
+				size_t size = kv_size_written(kv);
+				w.write_u32(SNAPSHOT_COLUMN_MODE_KV);
+				w.write_u32((uint32_t)size);
+				w.write(kv_get_buffer(kv), size);
+			}
+		}
+	}
+
+	void* snapshot = CUTE_ALLOC(w.buffer.count(), user_allocator_context);
+	if (!snapshot) return error_failure("Out of memory.");
+	CUTE_MEMCPY(snapshot, w.buffer.data(), w.buffer.count());
+	*snapshot_out = snapshot;
+	if (size_out) *size_out = (size_t)w.buffer.count();
+	return error_success();
+}
+
+static error_t s_parse_snapshot(snapshot_reader_t* r, array<snapshot_collection_t>* collections_out, array<entity_t>* load_id_table)
+{
+	ecs_world_t* world = s_world();
+	const char* magic = (const char*)r->read(8);
+	if (!magic || CUTE_MEMCMP(magic, CUTE_SNAPSHOT_MAGIC, 8)) return error_failure("Not an ECS snapshot.");
+	if (r->read_u32() != CUTE_SNAPSHOT_VERSION) return error_failure("Unsupported ECS snapshot version.");
+
+	int collection_count = (int)r->read_u32();
+	for (int i = 0; i < collection_count && !r->error; ++i) {
+		snapshot_collection_t& c = collections_out->add();
+		strpool_id entity_type_string = r->read_string();
+		entity_type_t saved_entity_type = (entity_type_t)r->read_u32();
+		c.entity_count = (int)r->read_u32();
+		c.handle_table_size = r->read_u32();
+		c.handle_table = r->read(c.handle_table_size);
+		c.entity_handles = r->read(sizeof(handle_t) * c.entity_count);
+		if (r->error) break;
+
+		// Entity handles encode the entity type, so types must match exactly.
+		c.entity_type = INVALID_ENTITY_TYPE;
+		world->entity_type_string_to_id.find(entity_type_string, &c.entity_type);
+		if (c.entity_type == INVALID_ENTITY_TYPE) return error_failure("Snapshot contains an unknown entity type.");
+		if (c.entity_type != saved_entity_type) return error_failure("Entity types were registered in a different order than when the snapshot was saved.");
+		for (int j = 0; j < collections_out->count() - 1; ++j) {
+			if ((*collections_out)[j].entity_type == c.entity_type) return error_failure("Snapshot is corrupt.");
+		}
+
+		for (int j = 0; j < c.entity_count; ++j) {
+			handle_t h;
+			CUTE_MEMCPY(&h, (const uint8_t*)c.entity_handles + sizeof(handle_t) * j, sizeof(handle_t));
+			load_id_table->add({ h });
+		}
+
+		int column_count = (int)r->read_u32();
+		for (int j = 0; j < column_count && !r->error; ++j) {
+			snapshot_column_t& column = c.columns.add();
+			column.component_type = r->read_string();
+			column.layout_hash = r->read_u64();
+			column.size_of_component = r->read_u32();
+			column.mode = r->read_u32();
+			column.data_size = r->read_u32();
+			column.data = r->read(column.data_size);
+			if (r->error) break;
+
+			component_config_t* config = world->component_configs.find(column.component_type);
+			if (!config) continue; // Component type no longer exists, skip it.
+			if (column.mode == SNAPSHOT_COLUMN_MODE_RAW) {
+				if (!s_is_raw(config) || column.layout_hash != s_layout_hash(config) || column.size_of_component != config->size_of_component) {
+					return error_failure("Component layout does not match the snapshot.");
+				}
+				if ((uint64_t)column.data_size != (uint64_t)column.size_of_component * (uint64_t)(uint32_t)c.entity_count) return error_failure("Snapshot is corrupt.");
+			} else if (column.mode == SNAPSHOT_COLUMN_MODE_KV) {
+				if (!config->serializer_fn) return error_failure("Snapshot component requires a serializer.");
+			} else {
+				return error_failure("Snapshot is corrupt.");
+			}
+		}
+	}
+
+	if (r->error) return error_failure("Snapshot is truncated.");
+	return error_success();
+}
+
+static void s_clear_collection(entity_collection_t* collection)
+{
+	ecs_world_t* world = s_world();
+	for (int i = 0; i < collection->component_tables.count(); ++i) {
+		component_config_t* config = world->component_configs.find(collection->component_type_tuple[i]);
+		if (config->cleanup_fn) {
+			for (int j = 0; j < collection->entity_handles.count(); ++j) {
+				config->cleanup_fn({ collection->entity_handles[j] }, collection->component_tables[i][j], config->cleanup_udata);
+			}
+		}
+		collection->component_tables[i].clear();
+		collection->component_changes[i].row_ticks.clear();
+	}
+	for (int i = 0; i < collection->entity_handles.count(); ++i) {
+		collection->entity_handle_table.free_handle(collection->entity_handles[i]);
+	}
+	collection->entity_handles.clear();
+}
+
+struct snapshot_scratch_t
+{
+	handle_allocator_t* handle_table = NULL;
+	array<handle_t> entity_handles;
+	array<typeless_array> component_tables;
+	array<int> constructed_counts; // Rows per table that were constructed, and so need cleanup if discarded.
+};
+
+static error_t s_load_snapshot_column(entity_type_t entity_type, entity_collection_t* collection, int column_index, const snapshot_column_t* column, const handle_t* handles, int entity_count, typeless_array* table, int* constructed_count)
+{
+	ecs_world_t* world = s_world();
+	component_config_t* config = world->component_configs.find(collection->component_type_tuple[column_index]);
+	table->ensure_capacity(entity_count);
+	table->m_count = entity_count;
+
+	if (!column) {
+		// Component was added to the entity type after the snapshot was saved.
+		for (int i = 0; i < entity_count; ++i) {
+			error_t err = s_construct_component(entity_type, collection, column_index, config, { handles[i] }, (*table)[i]);
+			if (err.is_error()) return err;
+			++*constructed_count;
+		}
+	} else if (column->mode == SNAPSHOT_COLUMN_MODE_RAW) {
+		CUTE_MEMCPY(table->data(), column->data, column->data_size);
+	} else {
+		kv_t* kv = kv_make();
+		CUTE_DEFER(kv_destroy(kv));
+		error_t err = kv_parse(kv, column->data, column->data_size);
+		if (err.is_error()) return err;
+		int count;
+		err = kv_array_begin(kv, &count, "components");
+		if (err.is_error() || count != entity_count) return error_failure("Snapshot is corrupt.");
+		for (int i = 0; i < entity_count; ++i) {
+			entity_t entity = { handles[i] };
+			void* component = (*table)[i];
+			err = s_construct_component(entity_type, collection, column_index, config, entity, component);
+			if (err.is_error()) return err;
+			++*constructed_count;
+			kv_object_begin(kv);
+			err = config->serializer_fn(kv, true, entity, component, config->serializer_udata);
+			kv_object_end(kv);
+			if (err.is_error()) return error_failure("Unable to parse component.");
+		}
+		kv_array_end(kv);
+	}
+
+	return error_success();
+}
+
+static error_t s_load_snapshot_collection(const snapshot_collection_t* c, snapshot_scratch_t* scratch)
+{
+	ecs_world_t* world = s_world();
+	entity_collection_t* collection = world->entity_collections.items() + c->entity_type;
+	scratch->entity_handles.ensure_count(c->entity_count);
+	CUTE_MEMCPY(scratch->entity_handles.data(), c->entity_handles, sizeof(handle_t) * c->entity_count);
+
+	scratch->handle_table = handle_allocator_make(0);
+	error_t err = handle_allocator_load(scratch->handle_table, c->handle_table, c->handle_table_size);
+	if (err.is_error()) return err;
+
+	for (int i = 0; i < collection->component_type_tuple.count(); ++i) {
+		const snapshot_column_t* column = NULL;
+		for (int j = 0; j < c->columns.count(); ++j) {
+			if (c->columns[j].component_type.val == collection->component_type_tuple[i].val) {
+				column = c->columns + j;
+				break;
+			}
+		}
+
+		typeless_array& table = scratch->component_tables.add();
+		table.m_element_size = collection->component_tables[i].m_element_size;
+		table.set_alignment(collection->component_tables[i].m_alignment);
+		int& constructed_count = scratch->constructed_counts.add();
+		constructed_count = 0;
+		err = s_load_snapshot_column(c->entity_type, collection, i, column, scratch->entity_handles.data(), c->entity_count, &table, &constructed_count);
+		if (err.is_error()) return err;
+	}
+
+	return error_success();
+}
+
+static void s_discard_snapshot_scratch(const array<snapshot_collection_t>& snapshot_collections, array<snapshot_scratch_t>* scratch)
+{
+	ecs_world_t* world = s_world();
+	for (int i = 0; i < scratch->count(); ++i) {
+		snapshot_scratch_t& s = (*scratch)[i];
+		entity_collection_t* collection = world->entity_collections.items() + snapshot_collections[i].entity_type;
+		for (int j = 0; j < s.component_tables.count(); ++j) {
+			component_config_t* config = world->component_configs.find(collection->component_type_tuple[j]);
+			if (!config->cleanup_fn) continue;
+			int count = min(s.constructed_counts[j], s.component_tables[j].count());
+			for (int k = 0; k < count; ++k) {
+				config->cleanup_fn({ s.entity_handles[k] }, s.component_tables[j][k], config->cleanup_udata);
+			}
+		}
+		if (s.handle_table) handle_allocator_destroy(s.handle_table);
+	}
+}
+
+error_t ecs_load_snapshot(const void* snapshot, size_t size)
+{
+	// Parse and load the whole snapshot into scratch tables before touching any entities, so
+	// the world is left as-is if anything fails.
+	ecs_world_t* world = s_world();
+	snapshot_reader_t r;
+	r.strpool = world->strpool;
+	r.p = (const uint8_t*)snapshot;
+	r.end = r.p + size;
+	array<snapshot_collection_t> snapshot_collections;
+	array<entity_t> load_id_table;
+	error_t err = s_parse_snapshot(&r, &snapshot_collections, &load_id_table);
+	if (err.is_error()) return err;
+
+	world->load_id_table = &load_id_table;
+	CUTE_DEFER(world->load_id_table = NULL);
+
+	array<snapshot_scratch_t> scratch;
+	CUTE_DEFER(s_discard_snapshot_scratch(snapshot_collections, &scratch));
+	for (int i = 0; i < snapshot_collections.count(); ++i) {
+		err = s_load_snapshot_collection(snapshot_collections + i, &scratch.add());
+		if (err.is_error()) return err;
+	}
+
+	int collection_count = world->entity_collections.count();
+	for (int i = 0; i < collection_count; ++i) {
+		s_clear_collection(world->entity_collections.items() + i);
+	}
+
+	// Swap the scratch tables in. The old handle tables are left in `scratch` to be destroyed.
+	for (int i = 0; i < snapshot_collections.count(); ++i) {
+		const snapshot_collection_t& c = snapshot_collections[i];
+		snapshot_scratch_t& s = scratch[i];
+		entity_collection_t* collection = world->entity_collections.items() + c.entity_type;
+
+		handle_allocator_t* old_handle_table = collection->entity_handle_table.m_alloc;
+		collection->entity_handle_table.m_alloc = s.handle_table;
+		s.handle_table = old_handle_table;
+		collection->entity_handles.steal_from(&s.entity_handles);
+		for (int j = 0; j < s.component_tables.count(); ++j) {
+			collection->component_tables[j].steal_from(s.component_tables + j);
+		}
+		s_track_new_rows(collection);
+	}
+
+	return error_success();
+}
+
 bool ecs_is_entity_type_valid(const char* entity_type)
 {
-	if (app->entity_type_string_to_id.find(INJECT(entity_type))) {
+	ecs_world_t* world = s_world();
+	if (world->entity_type_string_to_id.find(INJECT(entity_type))) {
 		return true;
 	} else {
 		return false;
@@ -764,11 +2262,12 @@ bool ecs_is_entity_type_valid(const char* entity_type)
 
 array<const char*> ecs_get_entity_list()
 {
+	ecs_world_t* world = s_world();
 	array<const char*> names;
 
-	for (int i = 0; i < app->entity_type_id_to_string.count(); ++i) {
-		strpool_id id = app->entity_type_id_to_string[i];
-		const char* name = strpool_cstr(app->strpool, id);
+	for (int i = 0; i < world->entity_type_id_to_string.count(); ++i) {
+		strpool_id id = world->entity_type_id_to_string[i];
+		const char* name = strpool_cstr(world->strpool, id);
 		names.add(name);
 	}
 
@@ -777,13 +2276,14 @@ array<const char*> ecs_get_entity_list()
 
 array<const char*> ecs_get_component_list()
 {
+	ecs_world_t* world = s_world();
 	array<const char*> names;
-	int count = app->component_configs.count();
-	strpool_id* ids = app->component_configs.keys();
+	int count = world->component_configs.count();
+	strpool_id* ids = world->component_configs.keys();
 
 	for (int i = 0; i < count; ++i) {
 		strpool_id id = ids[i];
-		const char* name = strpool_cstr(app->strpool, id);
+		const char* name = strpool_cstr(world->strpool, id);
 		names.add(name);
 	}
 
@@ -792,11 +2292,12 @@ array<const char*> ecs_get_component_list()
 
 array<const char*> ecs_get_system_list()
 {
+	ecs_world_t* world = s_world();
 	array<const char*> names;
 
-	for (int i = 0; i < app->systems.count(); ++i) {
-		strpool_id id = app->systems[i].name;
-		const char* name = id.val != 0 ? strpool_cstr(app->strpool, id) : "System name was not set.";
+	for (int i = 0; i < world->systems.count(); ++i) {
+		strpool_id id = world->systems[i].name;
+		const char* name = id.val != 0 ? strpool_cstr(world->strpool, id) : "System name was not set.";
 		names.add(name);
 	}
 
@@ -805,22 +2306,23 @@ array<const char*> ecs_get_system_list()
 
 array<const char*> ecs_get_component_list_for_entity_type(const char* entity_type)
 {
+	ecs_world_t* world = s_world();
 	array<const char*> result;
 
 	entity_type_t type = INVALID_ENTITY_TYPE;
-	app->entity_type_string_to_id.find(INJECT(entity_type), &type);
+	world->entity_type_string_to_id.find(INJECT(entity_type), &type);
 	if (type == INVALID_ENTITY_TYPE) {
 		return result;
 	}
 
-	entity_collection_t* collection = app->entity_collections.find(type);
+	entity_collection_t* collection = world->entity_collections.find(type);
 	CUTE_ASSERT(collection);
 
 	const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
 	for (int i = 0; i < component_type_tuple.count(); ++i)
 	{
 		strpool_id component_type = component_type_tuple[i];
-		component_config_t* config = app->component_configs.find(component_type);
+		component_config_t* config = world->component_configs.find(component_type);
 		CUTE_ASSERT(config);
 		result.add(config->name);
 	}
@@ -828,4 +2330,123 @@ array<const char*> ecs_get_component_list_for_entity_type(const char* entity_typ
 	return result;
 }
 
+//--------------------------------------------------------------------------------------------------
+// Stats.
+
+void ecs_get_system_stats(array<ecs_system_stats_t>* stats_out)
+{
+	ecs_world_t* world = s_world();
+	stats_out->clear();
+	for (int i = 0; i < world->systems.count(); ++i) {
+		system_internal_t* system = world->systems + i;
+		ecs_system_stats_t& stats = stats_out->add();
+		stats = system->stats;
+		stats.name = system->name.val ? strpool_cstr(world->strpool, system->name) : NULL;
+	}
+}
+
+void ecs_get_component_table_stats(array<ecs_component_table_stats_t>* stats_out)
+{
+	ecs_world_t* world = s_world();
+	stats_out->clear();
+	for (int i = 0; i < world->entity_collections.count(); ++i) {
+		entity_collection_t* collection = world->entity_collections.items() + i;
+		const char* entity_type = strpool_cstr(world->strpool, world->entity_type_id_to_string[world->entity_collections.keys()[i]]);
+		for (int j = 0; j < collection->component_tables.count(); ++j) {
+			const typeless_array& table = collection->component_tables[j];
+			ecs_component_table_stats_t& stats = stats_out->add();
+			stats.entity_type = entity_type;
+			stats.component_type = strpool_cstr(world->strpool, collection->component_type_tuple[j]);
+			stats.count = table.count();
+			stats.capacity = table.capacity();
+			stats.bytes_used = table.m_element_size * table.count();
+			stats.bytes_reserved = table.m_element_size * table.capacity();
+		}
+	}
+}
+
+void ecs_get_entity_type_stats(array<ecs_entity_type_stats_t>* stats_out)
+{
+	ecs_world_t* world = s_world();
+	stats_out->clear();
+	for (int i = 0; i < world->entity_collections.count(); ++i) {
+		entity_collection_t* collection = world->entity_collections.items() + i;
+		ecs_entity_type_stats_t& stats = stats_out->add();
+		stats.entity_type = strpool_cstr(world->strpool, world->entity_type_id_to_string[world->entity_collections.keys()[i]]);
+		stats.entity_count = collection->entity_handles.count();
+		stats.handle_capacity = handle_allocator_capacity(collection->entity_handle_table.m_alloc);
+		stats.handles_free = handle_allocator_free_count(collection->entity_handle_table.m_alloc);
+	}
+}
+
+static void s_imgui_table_headers(const char** names, int count)
+{
+	for (int i = 0; i < count; ++i) ImGui::TableSetupColumn(names[i]);
+	ImGui::TableHeadersRow();
+}
+
+void ecs_imgui_stats_window(bool* p_open)
+{
+	if (!app->using_imgui) return;
+
+	const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+	if (ImGui::Begin("ECS Stats", p_open)) {
+		if (ImGui::CollapsingHeader("Systems", ImGuiTreeNodeFlags_DefaultOpen)) {
+			array<ecs_system_stats_t> stats;
+			ecs_get_system_stats(&stats);
+			const char* headers[] = { "System", "Pre (ms)", "Update (ms)", "Post (ms)", "Collections", "Entities" };
+			if (ImGui::BeginTable("ecs_system_stats", CUTE_ARRAY_SIZE(headers), flags)) {
+				s_imgui_table_headers(headers, CUTE_ARRAY_SIZE(headers));
+				for (int i = 0; i < stats.count(); ++i) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::Text("%s", stats[i].name ? stats[i].name : "(unnamed)");
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", stats[i].pre_update_seconds * 1000.0f);
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", stats[i].update_seconds * 1000.0f);
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", stats[i].post_update_seconds * 1000.0f);
+					ImGui::TableNextColumn(); ImGui::Text("%d", stats[i].collections_updated);
+					ImGui::TableNextColumn(); ImGui::Text("%d", stats[i].entities_updated);
+				}
+				ImGui::EndTable();
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Entity Types")) {
+			array<ecs_entity_type_stats_t> stats;
+			ecs_get_entity_type_stats(&stats);
+			const char* headers[] = { "Entity Type", "Entities", "Handle Slots", "Free Handles" };
+			if (ImGui::BeginTable("ecs_entity_type_stats", CUTE_ARRAY_SIZE(headers), flags)) {
+				s_imgui_table_headers(headers, CUTE_ARRAY_SIZE(headers));
+				for (int i = 0; i < stats.count(); ++i) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::Text("%s", stats[i].entity_type);
+					ImGui::TableNextColumn(); ImGui::Text("%d", stats[i].entity_count);
+					ImGui::TableNextColumn(); ImGui::Text("%d", stats[i].handle_capacity);
+					ImGui::TableNextColumn(); ImGui::Text("%d", stats[i].handles_free);
+				}
+				ImGui::EndTable();
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Component Tables")) {
+			array<ecs_component_table_stats_t> stats;
+			ecs_get_component_table_stats(&stats);
+			const char* headers[] = { "Entity Type", "Component", "Count", "Capacity", "Bytes Used", "Bytes Reserved" };
+			if (ImGui::BeginTable("ecs_component_table_stats", CUTE_ARRAY_SIZE(headers), flags)) {
+				s_imgui_table_headers(headers, CUTE_ARRAY_SIZE(headers));
+				for (int i = 0; i < stats.count(); ++i) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::Text("%s", stats[i].entity_type);
+					ImGui::TableNextColumn(); ImGui::Text("%s", stats[i].component_type);
+					ImGui::TableNextColumn(); ImGui::Text("%d", stats[i].count);
+					ImGui::TableNextColumn(); ImGui::Text("%d", stats[i].capacity);
+					ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats[i].bytes_used);
+					ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)stats[i].bytes_reserved);
+				}
+				ImGui::EndTable();
+			}
+		}
+	}
+	ImGui::End();
+}
+
 }
@@ -48,6 +48,7 @@ struct handle_allocator_t
 	}
 
 	uint32_t m_freelist = ~0;
+	int m_free_count = 0;
 	array<handle_entry_t> m_handles;
 	void* m_mem_ctx = NULL;
 };
@@ -63,12 +64,26 @@ static void s_add_elements_to_freelist(handle_allocator_t* table, int first_inde
 		m_handles[i] = handle;
 	}
 
+	// Link the new elements in front of any existing free handles.
 	handle_entry_t last_handle;
-	last_handle.data.user_index = UINT32_MAX;
+	last_handle.data.user_index = table->m_freelist;
 	last_handle.data.generation = 0;
 	m_handles[last_index] = last_handle;
 
 	table->m_freelist = first_index;
+	table->m_free_count += last_index - first_index + 1;
+}
+
+static void s_grow(handle_allocator_t* table, int min_new_elements)
+{
+	// Grow by count (not capacity) so existing handles are copied over when the array resizes.
+	int first_index = table->m_handles.count();
+	int new_count = first_index ? first_index * 2 : 256;
+	if (!first_index) first_index = 1;
+	while (new_count - first_index < min_new_elements) new_count *= 2;
+	table->m_handles.ensure_count(new_count);
+	int last_index = table->m_handles.count() - 1;
+	s_add_elements_to_freelist(table, first_index, last_index);
 }
 
 handle_allocator_t* handle_allocator_make(int initial_capacity, void* user_allocator_context)
@@ -77,8 +92,8 @@ handle_allocator_t* handle_allocator_make(int initial_capacity, void* user_alloc
 	CUTE_PLACEMENT_NEW(table) handle_allocator_t(user_allocator_context);
 
 	if (initial_capacity) {
-		table->m_handles.ensure_capacity(initial_capacity);
-		int last_index = table->m_handles.capacity() - 1;
+		table->m_handles.ensure_count(initial_capacity);
+		int last_index = table->m_handles.count() - 1;
 		s_add_elements_to_freelist(table, 0, last_index);
 	}
 
@@ -97,17 +112,14 @@ handle_t handle_allocator_alloc(handle_allocator_t* table, uint32_t index, uint1
 {
 	int freelist_index = table->m_freelist;
 	if (freelist_index == UINT32_MAX) {
-		int first_index = table->m_handles.capacity();
-		if (!first_index) first_index = 1;
-		table->m_handles.ensure_capacity(first_index * 2);
-		int last_index = table->m_handles.capacity() - 1;
-		s_add_elements_to_freelist(table, first_index, last_index);
+		s_grow(table, 1);
 		freelist_index = table->m_freelist;
 	}
 
 	// Pop m_freelist.
 	handle_entry_t* m_handles = table->m_handles.data();
 	table->m_freelist = m_handles[freelist_index].data.user_index;
+	table->m_free_count--;
 
 	// Setup handle indices.
 	m_handles[freelist_index].data.user_index = index;
@@ -156,6 +168,59 @@ void handle_allocator_free(handle_allocator_t* table, handle_t handle)
 	m_handles[table_index].data.user_index = table->m_freelist;
 	m_handles[table_index].data.generation++;
 	table->m_freelist = table_index;
+	table->m_free_count++;
+}
+
+size_t handle_allocator_save_size(handle_allocator_t* table)
+{
+	return sizeof(uint32_t) + sizeof(int) * 2 + sizeof(handle_entry_t) * table->m_handles.count();
+}
+
+void handle_allocator_save(handle_allocator_t* table, void* buffer)
+{
+	uint8_t* p = (uint8_t*)buffer;
+	int count = table->m_handles.count();
+	CUTE_MEMCPY(p, &table->m_freelist, sizeof(uint32_t)); p += sizeof(uint32_t);
+	CUTE_MEMCPY(p, &table->m_free_count, sizeof(int)); p += sizeof(int);
+	CUTE_MEMCPY(p, &count, sizeof(int)); p += sizeof(int);
+	CUTE_MEMCPY(p, table->m_handles.data(), sizeof(handle_entry_t) * count);
+}
+
+error_t handle_allocator_load(handle_allocator_t* table, const void* buffer, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)buffer;
+	if (size < sizeof(uint32_t) + sizeof(int) * 2) return error_failure("Handle table data is truncated.");
+	uint32_t freelist;
+	int free_count, count;
+	CUTE_MEMCPY(&freelist, p, sizeof(uint32_t)); p += sizeof(uint32_t);
+	CUTE_MEMCPY(&free_count, p, sizeof(int)); p += sizeof(int);
+	CUTE_MEMCPY(&count, p, sizeof(int)); p += sizeof(int);
+	if (count < 0 || size != sizeof(uint32_t) + sizeof(int) * 2 + sizeof(handle_entry_t) * count) return error_failure("Handle table data is truncated.");
+	if (freelist != UINT32_MAX && freelist >= (uint32_t)count) return error_failure("Handle table data is corrupt.");
+
+	table->m_handles.clear();
+	table->m_handles.ensure_count(count);
+	CUTE_MEMCPY(table->m_handles.data(), p, sizeof(handle_entry_t) * count);
+	table->m_freelist = freelist;
+	table->m_free_count = free_count;
+	return error_success();
+}
+
+int handle_allocator_capacity(handle_allocator_t* table)
+{
+	return table->m_handles.count();
+}
+
+int handle_allocator_free_count(handle_allocator_t* table)
+{
+	return table->m_free_count;
+}
+
+void handle_allocator_reserve(handle_allocator_t* table, int count)
+{
+	if (table->m_free_count < count) {
+		s_grow(table, count - table->m_free_count);
+	}
 }
 
 int handle_allocator_is_handle_valid(handle_allocator_t* table, handle_t handle)
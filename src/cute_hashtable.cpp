@@ -77,8 +77,8 @@ int hashtable_init(hashtable_t* table, int key_size, int item_size, int capacity
 
 void hashtable_cleanup(hashtable_t* table)
 {
-	CUTE_FREE(table->slots, mem_ctx);
-	CUTE_FREE(table->items_key, mem_ctx);
+	CUTE_FREE(table->slots, table->mem_ctx);
+	CUTE_FREE(table->items_key, table->mem_ctx);
 }
 
 static CUTE_INLINE int s_keys_equal(const hashtable_t* table, const void* a, const void* b)
@@ -145,8 +145,8 @@ static void s_expand_slots(hashtable_t* table)
 	int const old_capacity = table->slot_capacity;
 	hashtable_slot_t* old_slots = table->slots;
 
-	table->slot_capacity *= 2;
-	int slot_mask = table->slot_capacity - 1;
+	// Slots are addressed with `hash % slot_capacity` everywhere else, so keep the capacity prime.
+	table->slot_capacity = s_next_prime(old_capacity * 2);
 
 	int size = (int)(table->slot_capacity * sizeof(*table->slots));
 	table->slots = (hashtable_slot_t*)CUTE_ALLOC(size, table->mem_ctx);
@@ -157,10 +157,10 @@ static void s_expand_slots(hashtable_t* table)
 	{
 		uint64_t hash = old_slots[i].key_hash;
 		if (hash) {
-			int const base_slot = (int)(hash & (uint64_t)slot_mask);
+			int const base_slot = (int)(hash % (uint64_t)table->slot_capacity);
 			int slot = base_slot;
 			while (table->slots[slot].key_hash)
-				slot = (slot + 1) & slot_mask;
+				slot = (slot + 1) % table->slot_capacity;
 			table->slots[slot].key_hash = hash;
 			int item_index = old_slots[i].item_index;
 			table->slots[slot].item_index = item_index;
@@ -175,7 +175,7 @@ static void s_expand_slots(hashtable_t* table)
 static void s_expand_items(hashtable_t* table)
 {
 	table->item_capacity *= 2;
-	uint64_t* new_items_key = (uint64_t*)CUTE_ALLOC(table->item_capacity * (table->key_size + sizeof(*table->items_slot_index) + table->item_size) + table->item_size + table->key_size, table->mem_ctx);
+	uint8_t* new_items_key = (uint8_t*)CUTE_ALLOC(table->item_capacity * (table->key_size + sizeof(*table->items_slot_index) + table->item_size) + table->item_size + table->key_size, table->mem_ctx);
 	CUTE_ASSERT(new_items_key);
 
 	int* new_items_slot_index = (int*)(new_items_key + table->item_capacity * table->key_size);
@@ -184,7 +184,7 @@ static void s_expand_items(hashtable_t* table)
 	void* new_temp_item = (void*)(((uintptr_t)new_temp_key) + table->key_size);
 
 	CUTE_MEMCPY(new_items_key, table->items_key, table->count * table->key_size);
-	CUTE_MEMCPY(new_items_slot_index, table->items_slot_index, table->count * table->key_size);
+	CUTE_MEMCPY(new_items_slot_index, table->items_slot_index, table->count * sizeof(*table->items_slot_index));
 	CUTE_MEMCPY(new_items_data, table->items_data, table->count * table->item_size);
 
 	CUTE_FREE(table->items_key, table->mem_ctx);
@@ -201,9 +201,12 @@ void* hashtable_insert(hashtable_t* table, const void* key, const void* item)
 	CUTE_ASSERT(s_find_slot(table, key) < 0);
 	uint64_t hash = s_calc_hash(key, table->key_size);
 
-	if (table->count >= table->slot_capacity) {
+	if (table->count >= table->item_capacity) {
 		s_expand_items(table);
 	}
+	if (table->count >= table->slot_capacity / 2) {
+		s_expand_slots(table);
+	}
 
 	int base_slot = (int)(hash % (uint64_t)table->slot_capacity);
 	int base_count = table->slots[base_slot].base_count;
@@ -67,7 +67,10 @@ struct kv_object_t
 	int parsing_array = 0;
 
 	kv_string_t key;
-	array<kv_field_t> fields;
+
+	// Most objects hold a handful of fields, so start small instead of the default array capacity.
+	// Documents with many small objects (such as saved entities) otherwise spend most of their memory here.
+	array<kv_field_t> fields = array<kv_field_t>(8, NULL);
 };
 
 #define CUTE_KV_NOT_IN_ARRAY               0
@@ -82,6 +85,12 @@ struct kv_cache_t
 
 struct kv_t
 {
+	kv_t(void* user_allocator_context)
+		: write_buffer(user_allocator_context)
+		, mem_ctx(user_allocator_context)
+	{
+	}
+
 	kv_state_t mode = KV_STATE_UNITIALIZED;
 	uint8_t* in = NULL;
 	uint8_t* in_end = NULL;
@@ -117,8 +126,7 @@ struct kv_t
 kv_t* kv_make(void* user_allocator_context)
 {
 	kv_t* kv = (kv_t*)CUTE_ALLOC(sizeof(kv_t), user_allocator_context);
-	CUTE_PLACEMENT_NEW(kv) kv_t;
-	kv->mem_ctx = user_allocator_context;
+	CUTE_PLACEMENT_NEW(kv) kv_t(user_allocator_context);
 
 	kv_cache_t cache;
 	cache.kv = kv;
@@ -418,6 +426,8 @@ static error_t s_parse_object(kv_t* kv, int* index, bool is_top_level)
 			}
 		}
 
+		// Nested objects are added to `kv->objects` and can move it, so look the object up again.
+		object = kv->objects + parent_index;
 		kv_field_t* field = &object->fields.add();
 		CUTE_PLACEMENT_NEW(field) kv_field_t;
 
@@ -48,6 +48,7 @@ memory_pool_t* memory_pool_make(int element_size, int element_count, void* user_
 	pool->arena = (uint8_t*)(pool + 1);
 	pool->free_list = pool->arena;
 	pool->overflow_count = 0;
+	pool->mem_ctx = user_allocator_context;
 
 	for (int i = 0; i < element_count - 1; ++i)
 	{
@@ -26,6 +26,25 @@
 namespace cute
 {
 
+static void* s_alloc(size_t size, size_t alignment, void* mem_ctx)
+{
+	if (!alignment) return CUTE_ALLOC(size, mem_ctx);
+
+	// Over-allocate, and stash the original pointer just before the aligned one.
+	void* p = CUTE_ALLOC(size + alignment - 1 + sizeof(void*), mem_ctx);
+	if (!p) return NULL;
+	uintptr_t aligned = ((uintptr_t)p + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	((void**)aligned)[-1] = p;
+	return (void*)aligned;
+}
+
+static void s_free(void* p, size_t alignment, void* mem_ctx)
+{
+	if (!p) return;
+	if (!alignment) CUTE_FREE(p, mem_ctx);
+	else CUTE_FREE(((void**)p)[-1], mem_ctx);
+}
+
 typeless_array::typeless_array()
 {
 }
@@ -47,7 +66,14 @@ typeless_array::typeless_array(size_t element_size, int capacity, void* user_all
 
 typeless_array::~typeless_array()
 {
-	CUTE_FREE(m_items, m_mem_ctx);
+	s_free(m_items, m_alignment, m_mem_ctx);
+}
+
+void typeless_array::set_alignment(size_t alignment)
+{
+	CUTE_ASSERT(!(alignment & (alignment - 1)));
+	CUTE_ASSERT(!m_items);
+	m_alignment = alignment;
 }
 
 void* typeless_array::add()
@@ -135,10 +161,10 @@ void typeless_array::ensure_capacity(int num_elements)
 		}
 
 		size_t new_size = m_element_size * new_capacity;
-		void* new_items = CUTE_ALLOC(new_size, m_mem_ctx);
+		void* new_items = s_alloc(new_size, m_alignment, m_mem_ctx);
 		CUTE_ASSERT(new_items);
 		CUTE_MEMCPY(new_items, m_items, m_element_size * m_count);
-		CUTE_FREE(m_items, m_mem_ctx);
+		s_free(m_items, m_alignment, m_mem_ctx);
 		m_items = new_items;
 		m_capacity = new_capacity;
 	}
@@ -150,6 +176,7 @@ void typeless_array::steal_from(typeless_array* steal_from_me)
 	m_capacity = steal_from_me->m_capacity;
 	m_count = steal_from_me->m_count;
 	m_items = steal_from_me->m_items;
+	m_alignment = steal_from_me->m_alignment;
 	m_mem_ctx = steal_from_me->m_mem_ctx;
 	CUTE_PLACEMENT_NEW(steal_from_me) typeless_array();
 }
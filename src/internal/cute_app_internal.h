@@ -36,6 +36,7 @@
 #include <cute_gfx.h>
 #include <cute_input.h>
 #include <cute_string.h>
+#include <cute_concurrency.h>
 
 #include <internal/cute_object_table_internal.h>
 #include <internal/cute_font_internal.h>
@@ -79,12 +80,43 @@ struct window_state_t
 	bool moved = false;
 };
 
+using entity_type_t = uint16_t;
+#define INVALID_ENTITY_TYPE ((uint16_t)~0)
+
+// Records delayed structural changes made by a single thread, see `entity_delayed_make`.
+struct ecs_command_buffer_t
+{
+	thread_id_t owner = 0;
+	int index = 0;
+	uint32_t seq = 0;
+	uint32_t pending_count = 0;
+	array<uint8_t> commands;
+	array<entity_t> resolved;
+};
+
+struct component_changes_t
+{
+	bool tracked = false;
+	uint64_t changed_tick = 0; // Most recent change tick of any row.
+	array<uint64_t> row_ticks; // Change tick of each row.
+};
+
+struct ecs_sort_key_t
+{
+	uint64_t key;
+	int row;
+};
+
 struct entity_collection_t
 {
 	handle_table_t entity_handle_table;
 	array<handle_t> entity_handles; // TODO - Replace with a counter? Or delete?
 	array<strpool_id> component_type_tuple;
 	array<typeless_array> component_tables;
+	array<int> component_columns; // Maps a `component_id_t` to an index in `component_tables`, or -1.
+	array<typeless_array> component_prototypes; // Baked default value per column, or empty if not baked.
+	array<component_changes_t> component_changes; // Per column, see `ecs_component_set_optional_change_tracking`.
+	int sort_cursor = 0; // First row of the next window sorted by `ecs_sort_collection_incremental`.
 };
 
 struct system_internal_t
@@ -96,7 +128,13 @@ struct system_internal_t
 		pre_update_fn = NULL;
 		update_fn = NULL;
 		post_update_fn = NULL;
+		parallel_for_grain_size = 0;
+		declared_access = false;
+		last_run_tick = 0;
+		stats = { 0 };
 		component_type_tuple.clear();
+		write_component_type_tuple.clear();
+		matched_entity_types.clear();
 	}
 
 	strpool_id name = { 0 };
@@ -104,7 +142,18 @@ struct system_internal_t
 	void (*pre_update_fn)(float dt, void* udata) = NULL;
 	system_update_fn* update_fn = NULL;
 	void (*post_update_fn)(float dt, void* udata) = NULL;
+	int parallel_for_grain_size = 0;
+	uint64_t last_run_tick = 0;
+	ecs_system_stats_t stats = { 0 };
+
+	// Systems that never declared read/write access are treated as a barrier by the scheduler.
+	bool declared_access = false;
 	array<strpool_id> component_type_tuple;
+	array<strpool_id> write_component_type_tuple;
+
+	// Cached list of entity types with all of the required components, updated as new entity types
+	// are registered.
+	array<entity_type_t> matched_entity_types;
 };
 
 struct component_config_t
@@ -112,19 +161,37 @@ struct component_config_t
 	void clear()
 	{
 		name = NULL;
+		id = INVALID_COMPONENT_ID;
+		id_out = NULL;
 		size_of_component = 0;
+		alignment = 0;
 		serializer_fn = NULL;
 		cleanup_fn = NULL;
+		post_construct_fn = NULL;
 		serializer_udata = NULL;
 		cleanup_udata = NULL;
+		post_construct_udata = NULL;
+		bake_prototype = false;
+		is_pod = false;
+		layout_version = 0;
+		track_changes = false;
 	}
 
 	const char* name = NULL;
+	component_id_t id = INVALID_COMPONENT_ID;
+	component_id_t* id_out = NULL;
 	size_t size_of_component = 0;
+	size_t alignment = 0;
 	component_serialize_fn* serializer_fn = NULL;
 	component_cleanup_fn* cleanup_fn = NULL;
+	component_post_construct_fn* post_construct_fn = NULL;
 	void* serializer_udata = NULL;
 	void* cleanup_udata = NULL;
+	void* post_construct_udata = NULL;
+	bool bake_prototype = false;
+	bool is_pod = false;
+	uint32_t layout_version = 0;
+	bool track_changes = false;
 };
 
 struct entity_config_t
@@ -133,16 +200,52 @@ struct entity_config_t
 	{
 		entity_type = NULL;
 		component_types.clear();
-		schema.id.val = 0;
+		schema.clear();
 	}
 
 	const char* entity_type = NULL;
 	array<const char*> component_types;
-	string_t schema;
+	array<char> schema; // A copy, not a `string_t`, as the global string pool is not thread-safe.
 };
 
-using entity_type_t = uint16_t;
-#define INVALID_ENTITY_TYPE ((uint16_t)~0)
+struct ecs_world_t
+{
+	int id = 0; // Unique for the lifetime of the process, unlike the world's address.
+	strpool_t* strpool = NULL;
+	threadpool_t* threadpool = NULL;
+
+	// TODO: Set allocator context for these data structures.
+	system_internal_t system_internal_builder;
+	array<system_internal_t> systems;
+	entity_config_t entity_config_builder;
+	entity_type_t entity_type_gen = 0;
+	dictionary<strpool_id, entity_type_t> entity_type_string_to_id;
+	array<strpool_id> entity_type_id_to_string;
+	dictionary<entity_type_t, entity_collection_t> entity_collections;
+	mutex_t command_buffers_mutex = mutex_create();
+	array<ecs_command_buffer_t*> command_buffers;
+	array<array<uint8_t>> command_playback;
+	bool system_schedule_dirty = true;
+	uint64_t ecs_change_tick = 1;
+	array<array<int>> system_schedule;
+	array<array<handle_t>> destroy_many_handles;
+	array<int> destroy_many_rows;
+	array<int> destroy_many_moves;
+	bool destroying_many = false;
+	array<ecs_sort_key_t> sort_keys;
+	array<uint8_t> sort_scratch;
+
+	component_config_t component_config_builder;
+	dictionary<strpool_id, component_config_t> component_configs;
+	dictionary<entity_type_t, kv_t*> entity_parsed_schemas;
+	array<array<char>> entity_schemas; // Copies of each registered schema, which the parsed schemas point into.
+	dictionary<entity_type_t, uint16_t> entity_schema_inheritence;
+
+	dictionary<entity_t, int>* save_id_table = NULL;
+	array<entity_t>* load_id_table = NULL;
+
+	void* mem_ctx = NULL;
+};
 
 struct app_t
 {
@@ -154,6 +257,8 @@ struct app_t
 	cs_context_t* cute_sound = NULL;
 	bool spawned_mix_thread = false;
 	threadpool_t* threadpool = NULL;
+	completion_queue_t* main_thread_queue = NULL; // Drained in `app_update`, see `app_main_thread_queue`.
+	arena_t* frame_arena = NULL; // Reset in `app_update`, see `app_frame_arena`.
 	audio_system_t* audio_system = NULL;
 	cute_font_t* courier_new = NULL;
 	array<cute_font_vert_t> font_verts;
@@ -202,25 +307,7 @@ struct app_t
 	batch_t* png_batch = NULL;
 	png_cache_t* png_cache = NULL;
 
-	// TODO: Set allocator context for these data structures.
-	system_internal_t system_internal_builder;
-	array<system_internal_t> systems;
-	entity_config_t entity_config_builder;
-	entity_type_t entity_type_gen = 0;
-	dictionary<strpool_id, entity_type_t> entity_type_string_to_id;
-	array<strpool_id> entity_type_id_to_string;
-	dictionary<entity_type_t, entity_collection_t> entity_collections;
-	entity_type_t current_collection_type_being_iterated = ~0;
-	entity_collection_t* current_collection_being_updated = NULL;
-	array<entity_t> delayed_destroy_entities;
-
-	component_config_t component_config_builder;
-	dictionary<strpool_id, component_config_t> component_configs;
-	dictionary<entity_type_t, kv_t*> entity_parsed_schemas;
-	dictionary<entity_type_t, uint16_t> entity_schema_inheritence;
-
-	dictionary<entity_t, int>* save_id_table = NULL;
-	array<entity_t>* load_id_table = NULL;
+	ecs_world_t* ecs_world = NULL; // Default world, see `ecs_set_world`.
 
 	void* mem_ctx = NULL;
 };
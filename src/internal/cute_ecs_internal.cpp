@@ -29,15 +29,16 @@ error_t kv_val_entity(kv_t* kv, entity_t* entity)
 {
 	kv_state_t state = kv_get_state(kv);
 	CUTE_ASSERT(state != KV_STATE_UNITIALIZED);
+	ecs_world_t* world = ecs_get_world();
 
 	if (state == KV_STATE_READ) {
 		int index;
 		error_t err = kv_val(kv, &index);
 		if (err.is_error()) return err;
-		*entity = app->load_id_table->operator[](index);
+		*entity = world->load_id_table->operator[](index);
 		return error_success();
 	} else {
-		int* index_ptr = app->save_id_table->find(*entity);
+		int* index_ptr = world->save_id_table->find(*entity);
 		CUTE_ASSERT(index_ptr);
 		return kv_val(kv, index_ptr);
 	}
@@ -0,0 +1,249 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+// ECS throughput benchmarks. Each benchmark runs at several entity counts within a fresh world, and
+// results are written as CSV (the default) or JSON, one row per benchmark and entity count.
+//
+// Usage: cute_bench_ecs [--format csv|json] [--out path] [--sizes 1000,100000,1000000] [--runs 10]
+
+#include <cute.h>
+using namespace cute;
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct bench_position_t
+{
+	float x;
+	float y;
+};
+
+struct bench_velocity_t
+{
+	float x;
+	float y;
+};
+
+cute::error_t bench_vec_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	bench_position_t* v = (bench_position_t*)component;
+	if (reading) {
+		v->x = 0;
+		v->y = 0;
+		if (!kv) return error_success();
+	}
+	kv_key(kv, "x"); kv_val(kv, &v->x);
+	kv_key(kv, "y"); kv_val(kv, &v->y);
+	return kv_error_state(kv);
+}
+
+void update_bench_move_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	ecs_view<bench_position_t, bench_velocity_t> view(arrays, count);
+	ecs_span_t<bench_position_t> positions = view.get<bench_position_t>();
+	ecs_span_t<bench_velocity_t> velocities = view.get<bench_velocity_t>();
+	for (int i = 0; i < view.count; ++i) {
+		positions[i].x += velocities[i].x * dt;
+		positions[i].y += velocities[i].y * dt;
+	}
+}
+
+static void s_register()
+{
+	ecs_component_begin();
+	ecs_component_set_name("position");
+	ecs_component_set_type<bench_position_t>();
+	ecs_component_set_optional_serializer(bench_vec_serialize);
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("velocity");
+	ecs_component_set_type<bench_velocity_t>();
+	ecs_component_set_optional_serializer(bench_vec_serialize);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Mover");
+	ecs_entity_add_component("position");
+	ecs_entity_add_component("velocity");
+	ecs_entity_end();
+
+	ecs_system_begin();
+	ecs_system_set_name("move");
+	ecs_system_set_update(update_bench_move_system);
+	ecs_system_require_component("position");
+	ecs_system_require_component("velocity");
+	ecs_system_end();
+}
+
+struct bench_result_t
+{
+	const char* name;
+	int entity_count;
+	double seconds;
+};
+
+static array<bench_result_t> s_results;
+static float s_sink; // Keeps the compiler from discarding reads.
+
+static void s_record(const char* name, int entity_count, double seconds)
+{
+	s_results.add({ name, entity_count, seconds });
+	fprintf(stderr, "%-28s %9d entities %12.3f ms\n", name, entity_count, seconds * 1000.0);
+}
+
+static void s_bench(int n, int runs)
+{
+	ecs_world_t* world = ecs_world_make();
+	ecs_set_world(world);
+	s_register();
+
+	array<entity_t> entities;
+	entities.ensure_count(n);
+	cute::timer_t timer = timer_init();
+
+	for (int i = 0; i < n; ++i) entities[i] = entity_make("Mover");
+	s_record("entity_make", n, timer_dt(&timer));
+
+	for (int i = 0; i < n; ++i) {
+		bench_velocity_t* velocity = entity_get_component<bench_velocity_t>(entities[i]);
+		velocity->x = (float)(i % 7);
+		velocity->y = (float)(i % 13);
+	}
+	timer_dt(&timer);
+
+	float sum = 0;
+	component_id_t position_id = ecs_component_get_id("position");
+	for (int i = 0; i < n; ++i) sum += ((bench_position_t*)entity_get_component(entities[i], position_id))->x;
+	s_record("entity_get_component_by_id", n, timer_dt(&timer));
+
+	for (int i = 0; i < n; ++i) sum += ((bench_position_t*)entity_get_component(entities[i], "position"))->y;
+	s_record("entity_get_component_by_name", n, timer_dt(&timer));
+	s_sink += sum;
+
+	for (int i = 0; i < runs; ++i) ecs_run_systems(1.0f / 60.0f);
+	s_record("ecs_run_systems", n, timer_dt(&timer) / runs);
+
+	kv_t* writer = kv_make();
+	kv_write_mode(writer);
+	cute::error_t err = ecs_save_entities(entities, writer);
+	CUTE_ASSERT(!err.is_error());
+	s_record("ecs_save_entities", n, timer_dt(&timer));
+
+	for (int i = 0; i < n; ++i) entity_destroy(entities[i]);
+	s_record("entity_destroy", n, timer_dt(&timer));
+
+	kv_t* reader = kv_make();
+	err = kv_parse(reader, kv_get_buffer(writer), kv_size_written(writer));
+	CUTE_ASSERT(!err.is_error());
+	timer_dt(&timer);
+	err = ecs_load_entities(reader, &entities);
+	CUTE_ASSERT(!err.is_error());
+	s_record("ecs_load_entities", n, timer_dt(&timer));
+	kv_destroy(reader);
+	kv_destroy(writer);
+
+	void* snapshot = NULL;
+	size_t snapshot_size = 0;
+	timer_dt(&timer);
+	err = ecs_save_snapshot(&snapshot, &snapshot_size);
+	CUTE_ASSERT(!err.is_error());
+	s_record("ecs_save_snapshot", n, timer_dt(&timer));
+
+	err = ecs_load_snapshot(snapshot, snapshot_size);
+	CUTE_ASSERT(!err.is_error());
+	s_record("ecs_load_snapshot", n, timer_dt(&timer));
+	CUTE_FREE(snapshot, NULL);
+
+	entity_destroy_many(entities.data(), entities.count());
+	timer_dt(&timer);
+	err = entity_make_many("Mover", n, entities.data());
+	CUTE_ASSERT(!err.is_error());
+	s_record("entity_make_many", n, timer_dt(&timer));
+
+	entity_destroy_many(entities.data(), n);
+	s_record("entity_destroy_many", n, timer_dt(&timer));
+
+	ecs_set_world(NULL);
+	ecs_world_destroy(world);
+}
+
+static void s_write_csv(FILE* fp)
+{
+	fprintf(fp, "benchmark,entities,seconds,ns_per_entity\n");
+	for (int i = 0; i < s_results.count(); ++i) {
+		const bench_result_t& r = s_results[i];
+		fprintf(fp, "%s,%d,%.9f,%.3f\n", r.name, r.entity_count, r.seconds, r.seconds * 1.0e9 / r.entity_count);
+	}
+}
+
+static void s_write_json(FILE* fp)
+{
+	fprintf(fp, "[\n");
+	for (int i = 0; i < s_results.count(); ++i) {
+		const bench_result_t& r = s_results[i];
+		fprintf(fp, "\t{ \"benchmark\": \"%s\", \"entities\": %d, \"seconds\": %.9f, \"ns_per_entity\": %.3f }%s\n", r.name, r.entity_count, r.seconds, r.seconds * 1.0e9 / r.entity_count, i + 1 < s_results.count() ? "," : "");
+	}
+	fprintf(fp, "]\n");
+}
+
+int main(int argc, const char** argv)
+{
+	const char* format = "csv";
+	const char* out_path = NULL;
+	const char* sizes = "1000,100000,1000000";
+	int runs = 10;
+	for (int i = 1; i < argc; ++i) {
+		if (!CUTE_STRCMP(argv[i], "--format") && i + 1 < argc) format = argv[++i];
+		else if (!CUTE_STRCMP(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+		else if (!CUTE_STRCMP(argv[i], "--sizes") && i + 1 < argc) sizes = argv[++i];
+		else if (!CUTE_STRCMP(argv[i], "--runs") && i + 1 < argc) runs = max(atoi(argv[++i]), 1);
+		else {
+			fprintf(stderr, "Usage: %s [--format csv|json] [--out path] [--sizes 1000,100000,1000000] [--runs 10]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN, argv[0]).is_error()) {
+		fprintf(stderr, "Unable to make the app.\n");
+		return -1;
+	}
+
+	for (const char* s = sizes; *s;) {
+		int n = atoi(s);
+		if (n > 0) s_bench(n, runs);
+		while (*s && *s != ',') ++s;
+		if (*s == ',') ++s;
+	}
+
+	FILE* fp = out_path ? fopen(out_path, "w") : stdout;
+	if (!fp) {
+		fprintf(stderr, "Unable to open \"%s\".\n", out_path);
+		app_destroy();
+		return -1;
+	}
+	if (!CUTE_STRCMP(format, "json")) s_write_json(fp);
+	else s_write_csv(fp);
+	if (fp != stdout) fclose(fp);
+
+	app_destroy();
+	return s_sink == 12345.0f ? 1 : 0;
+}
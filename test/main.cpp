@@ -31,6 +31,8 @@
 
 #include <test_handle.h>
 #include <test_circular_buffer.h>
+#include <test_threadpool.h>
+#include <test_queue.h>
 #include <test_doubly_list.h>
 #include <test_base64.h>
 #include <test_kv.h>
@@ -38,6 +40,7 @@
 #include <test_ecs.h>
 #include <test_lru_cache.h>
 #include <test_array.h>
+#include <test_arena.h>
 #include <test_aseprite.h>
 #include <test_png_cache.h>
 #include <test_sprite.h>
@@ -70,12 +73,27 @@ int main(int argc, const char** argv)
 		CUTE_TEST_CASE_ENTRY(test_circular_buffer_overflow),
 		CUTE_TEST_CASE_ENTRY(test_circular_buffer_underflow),
 		CUTE_TEST_CASE_ENTRY(test_circular_buffer_two_threads),
+		CUTE_TEST_CASE_ENTRY(test_circular_buffer_batch),
+		CUTE_TEST_CASE_ENTRY(test_circular_buffer_grow),
+		CUTE_TEST_CASE_ENTRY(test_circular_buffer_reserve_and_commit),
+		CUTE_TEST_CASE_ENTRY(test_threadpool_many_tasks),
+		CUTE_TEST_CASE_ENTRY(test_threadpool_nested_tasks),
+		CUTE_TEST_CASE_ENTRY(test_threadpool_counters),
+		CUTE_TEST_CASE_ENTRY(test_threadpool_continuation_race),
+		CUTE_TEST_CASE_ENTRY(test_parallel_for_and_reduce),
+		CUTE_TEST_CASE_ENTRY(test_atomic_cas),
+		CUTE_TEST_CASE_ENTRY(test_completion_queue),
+		CUTE_TEST_CASE_ENTRY(test_threadpool_stats),
+		CUTE_TEST_CASE_ENTRY(test_mpmc_queue_basic),
+		CUTE_TEST_CASE_ENTRY(test_mpmc_queue_threads),
+		CUTE_TEST_CASE_ENTRY(test_spsc_ring),
 		CUTE_TEST_CASE_ENTRY(test_doubly_list),
 		CUTE_TEST_CASE_ENTRY(test_base64_encode),
 		CUTE_TEST_CASE_ENTRY(test_kv_basic),
 		CUTE_TEST_CASE_ENTRY(test_kv_std_string_to_disk),
 		CUTE_TEST_CASE_ENTRY(test_kv_std_string_from_disk),
 		CUTE_TEST_CASE_ENTRY(test_kv_std_vector),
+		CUTE_TEST_CASE_ENTRY(test_kv_many_objects),
 		CUTE_TEST_CASE_ENTRY(test_kv_write_delta_basic),
 		CUTE_TEST_CASE_ENTRY(test_kv_read_delta_basic),
 		CUTE_TEST_CASE_ENTRY(test_kv_write_delta_deep),
@@ -88,12 +106,29 @@ int main(int argc, const char** argv)
 		CUTE_TEST_CASE_ENTRY(test_audio_load_asynchronous),
 		CUTE_TEST_CASE_ENTRY(test_ecs_octorok),
 		CUTE_TEST_CASE_ENTRY(test_ecs_no_kv),
+		CUTE_TEST_CASE_ENTRY(test_ecs_parallel_systems),
+		CUTE_TEST_CASE_ENTRY(test_ecs_parallel_for),
+		CUTE_TEST_CASE_ENTRY(test_ecs_component_ids),
+		CUTE_TEST_CASE_ENTRY(test_ecs_view),
+		CUTE_TEST_CASE_ENTRY(test_ecs_prototypes),
+		CUTE_TEST_CASE_ENTRY(test_ecs_make_destroy_many),
+		CUTE_TEST_CASE_ENTRY(test_ecs_snapshot),
+		CUTE_TEST_CASE_ENTRY(test_ecs_change_tracking),
+		CUTE_TEST_CASE_ENTRY(test_ecs_delayed_commands),
+		CUTE_TEST_CASE_ENTRY(test_ecs_stats),
+		CUTE_TEST_CASE_ENTRY(test_ecs_worlds),
+		CUTE_TEST_CASE_ENTRY(test_ecs_sort),
+		CUTE_TEST_CASE_ENTRY(test_ecs_alignment),
 		CUTE_TEST_CASE_ENTRY(test_lru_cache),
 		CUTE_TEST_CASE_ENTRY(test_array_list_init),
+		CUTE_TEST_CASE_ENTRY(test_arena),
+		CUTE_TEST_CASE_ENTRY(test_arena_scratch),
 		CUTE_TEST_CASE_ENTRY(test_aseprite_make_destroy),
 		CUTE_TEST_CASE_ENTRY(test_png_cache),
 		CUTE_TEST_CASE_ENTRY(test_sprite_make),
 		CUTE_TEST_CASE_ENTRY(test_coroutine),
+		CUTE_TEST_CASE_ENTRY(test_coroutine_scheduler),
+		CUTE_TEST_CASE_ENTRY(test_coroutine_await),
 	};
 	int test_count = sizeof(tests) / sizeof(*tests);
 	int fail_count = 0;
@@ -0,0 +1,107 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute_arena.h>
+#include <cute_array.h>
+#include <cute_concurrency.h>
+#include <cute_kv.h>
+using namespace cute;
+
+CUTE_TEST_CASE(test_arena, "Allocate from an arena, directly and as an allocator context, then reset and reuse it.");
+int test_arena()
+{
+	arena_t* arena = arena_make(1024);
+	CUTE_TEST_CHECK_POINTER(arena);
+
+	// Alignment is respected, and allocations bigger than a block get a block of their own.
+	uint8_t* a = (uint8_t*)arena_alloc(arena, 3, 1);
+	uint8_t* b = (uint8_t*)arena_alloc(arena, 8, 64);
+	CUTE_TEST_ASSERT(b >= a + 3);
+	CUTE_TEST_ASSERT(((uintptr_t)b & 63) == 0);
+	uint8_t* big = (uint8_t*)arena_alloc(arena, 4096);
+	CUTE_TEST_CHECK_POINTER(big);
+	CUTE_MEMSET(big, 0xFF, 4096);
+	CUTE_TEST_ASSERT(big >= b + 8 || big + 4096 <= a);
+
+	// Resetting hands the same memory out again, without touching the heap.
+	arena_reset(arena);
+	CUTE_TEST_ASSERT(arena_alloc(arena, 3, 1) == a);
+	CUTE_TEST_ASSERT(arena_alloc(arena, 8, 64) == b);
+	CUTE_TEST_ASSERT(arena_alloc(arena, 4096) == big);
+
+	// Marks roll back everything allocated after them.
+	arena_reset(arena);
+	arena_alloc(arena, 100);
+	arena_mark_t mark = arena_save(arena);
+	void* c = arena_alloc(arena, 900);
+	arena_alloc(arena, 900);
+	arena_restore(arena, mark);
+	CUTE_TEST_ASSERT(arena_alloc(arena, 900) == c);
+
+	// Containers and CF objects take the arena as their allocator context, and freeing is a no-op.
+	arena_reset(arena);
+	{
+		array<int> ints(arena);
+		for (int i = 0; i < 1000; ++i) ints.add(i);
+		for (int i = 0; i < 1000; ++i) CUTE_TEST_ASSERT(ints[i] == i);
+
+		kv_t* kv = kv_make(arena);
+		kv_write_mode(kv);
+		int val = 7;
+		CUTE_TEST_ASSERT(!kv_key(kv, "val").is_error());
+		CUTE_TEST_ASSERT(!kv_val(kv, &val).is_error());
+		CUTE_TEST_ASSERT(kv_size_written(kv) > 0);
+		kv_destroy(kv);
+	}
+	CUTE_FREE(arena_alloc(arena, 16), arena);
+
+	arena_destroy(arena);
+
+	return 0;
+}
+
+int test_arena_scratch_thread(void* udata)
+{
+	arena_t** out = (arena_t**)udata;
+	arena_t* scratch = arena_scratch();
+	*out = scratch;
+	arena_mark_t mark = arena_save(scratch);
+	int* ints = (int*)arena_alloc(scratch, sizeof(int) * 100);
+	for (int i = 0; i < 100; ++i) ints[i] = i;
+	arena_restore(scratch, mark);
+	return scratch == arena_scratch() ? 0 : -1;
+}
+
+CUTE_TEST_CASE(test_arena_scratch, "Make sure each thread gets its own scratch arena.");
+int test_arena_scratch()
+{
+	arena_t* scratch = arena_scratch();
+	CUTE_TEST_CHECK_POINTER(scratch);
+	CUTE_TEST_ASSERT(scratch == arena_scratch());
+
+	arena_t* other = NULL;
+	thread_t* thread = thread_create(test_arena_scratch_thread, "scratch", &other);
+	CUTE_TEST_ASSERT(!thread_wait(thread).is_error());
+	CUTE_TEST_CHECK_POINTER(other);
+	CUTE_TEST_ASSERT(other != scratch);
+
+	return 0;
+}
@@ -176,3 +176,109 @@ int test_circular_buffer_two_threads()
 
 	return 0;
 }
+
+CUTE_TEST_CASE(test_circular_buffer_batch, "Push and pull batches of elements, wrapping around the end of the buffer.");
+int test_circular_buffer_batch()
+{
+	circular_buffer_t buffer = circular_buffer_make(sizeof(int) * 10);
+	CUTE_TEST_CHECK_POINTER(buffer.data);
+
+	int in[16];
+	int out[16];
+	for (int i = 0; i < 16; ++i) in[i] = i;
+
+	for (int iters = 0; iters < 10; ++iters)
+	{
+		CUTE_TEST_ASSERT(circular_buffer_push_batch(&buffer, in, sizeof(int), 3) == 3);
+		CUTE_TEST_ASSERT(circular_buffer_push_batch(&buffer, in + 3, sizeof(int), 13) == 7);
+		CUTE_TEST_ASSERT(circular_buffer_push_batch(&buffer, in, sizeof(int), 1) == 0);
+		CUTE_TEST_ASSERT(circular_buffer_pull_batch(&buffer, out, sizeof(int), 4) == 4);
+		CUTE_TEST_ASSERT(circular_buffer_pull_batch(&buffer, out + 4, sizeof(int), 16) == 6);
+		CUTE_TEST_ASSERT(circular_buffer_pull_batch(&buffer, out, sizeof(int), 1) == 0);
+		for (int i = 0; i < 10; ++i) CUTE_TEST_ASSERT(out[i] == i);
+
+		// Shift where the next batch starts so it wraps around the end.
+		CUTE_TEST_CHECK(circular_buffer_push(&buffer, in, sizeof(int) * 3));
+		CUTE_TEST_CHECK(circular_buffer_pull(&buffer, out, sizeof(int) * 3));
+	}
+
+	circular_buffer_free(&buffer);
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_circular_buffer_grow, "Grow a buffer holding wrapped around data, and keep the data in order.");
+int test_circular_buffer_grow()
+{
+	int bytes = 10;
+	circular_buffer_t buffer = circular_buffer_make(bytes);
+	CUTE_TEST_CHECK_POINTER(buffer.data);
+
+	uint8_t data[20];
+	for (int i = 0; i < 20; ++i) data[i] = (uint8_t)i;
+	CUTE_TEST_CHECK(circular_buffer_push(&buffer, data, 7));
+	CUTE_TEST_CHECK(circular_buffer_pull(&buffer, data, 7));
+	CUTE_TEST_CHECK(circular_buffer_push(&buffer, data, 8));
+	CUTE_TEST_CHECK(!circular_buffer_grow(&buffer, 5));
+	CUTE_TEST_CHECK(circular_buffer_grow(&buffer, 20));
+	CUTE_TEST_CHECK(circular_buffer_push(&buffer, data + 8, 12));
+	CUTE_TEST_CHECK(!circular_buffer_push(&buffer, data, 1));
+
+	uint8_t out[20];
+	CUTE_TEST_CHECK(circular_buffer_pull(&buffer, out, 20));
+	for (int i = 0; i < 20; ++i) CUTE_TEST_ASSERT(out[i] == i);
+
+	circular_buffer_free(&buffer);
+
+	return 0;
+}
+
+int test_circular_buffer_reserve_push(void *data)
+{
+	circular_buffer_t* buffer = (circular_buffer_t*)data;
+
+	// Write incrementing bytes straight into the buffer.
+	int count = 0;
+	while (count < 100000 && test_circular_buffer_running)
+	{
+		void* span;
+		int size = circular_buffer_reserve_push(buffer, &span);
+		size = min(size, 100000 - count);
+		for (int i = 0; i < size; ++i) ((uint8_t*)span)[i] = (uint8_t)(count + i);
+		circular_buffer_commit_push(buffer, size);
+		count += size;
+	}
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_circular_buffer_reserve_and_commit, "Stream bytes between two threads through reserved spans, without copying.");
+int test_circular_buffer_reserve_and_commit()
+{
+	circular_buffer_t buffer = circular_buffer_make(97);
+	CUTE_TEST_CHECK_POINTER(buffer.data);
+
+	thread_t* push = thread_create(test_circular_buffer_reserve_push, "thread push", &buffer);
+
+	int count = 0;
+	int errors = 0;
+	while (count < 100000)
+	{
+		void* span;
+		int size = circular_buffer_reserve_pull(&buffer, &span);
+		for (int i = 0; i < size; ++i) {
+			if (((uint8_t*)span)[i] != (uint8_t)(count + i)) ++errors;
+		}
+		circular_buffer_commit_pull(&buffer, size);
+		count += size;
+	}
+	CUTE_TEST_ASSERT(errors == 0);
+
+	void* span;
+	CUTE_TEST_ASSERT(circular_buffer_reserve_pull(&buffer, &span) == 0);
+	CUTE_TEST_ASSERT(!thread_wait(push).is_error());
+
+	circular_buffer_free(&buffer);
+
+	return 0;
+}
@@ -93,3 +93,186 @@ int test_coroutine()
 
 	return 0;
 }
+
+struct test_scheduled_t
+{
+	int index;
+	int woke_frame;
+	int runs;
+};
+
+static int s_test_scheduler_frame;
+
+void coroutine_scheduled_func(coroutine_t* co)
+{
+	test_scheduled_t* data = (test_scheduled_t*)coroutine_get_udata(co);
+	data->runs++;
+	coroutine_wait(co, (data->index % 10 + 1) * 0.1f);
+	data->woke_frame = s_test_scheduler_frame;
+	data->runs++;
+	coroutine_yield(co);
+	data->runs++;
+}
+
+void coroutine_long_wait_func(coroutine_t* co)
+{
+	test_scheduled_t* data = (test_scheduled_t*)coroutine_get_udata(co);
+	coroutine_wait(co, 5.0f * 60.0f * 60.0f);
+	data->woke_frame = s_test_scheduler_frame;
+}
+
+CUTE_TEST_CASE(test_coroutine_scheduler, "Run many coroutines on a scheduler, and make sure waits resume them on the right frame.");
+int test_coroutine_scheduler()
+{
+	coroutine_scheduler_t* scheduler = coroutine_scheduler_make(1024 * 16);
+	CUTE_TEST_CHECK_POINTER(scheduler);
+
+	const int count = 1000;
+	test_scheduled_t* data = (test_scheduled_t*)CUTE_ALLOC(sizeof(test_scheduled_t) * count, NULL);
+	for (int i = 0; i < count; ++i) {
+		data[i].index = i;
+		data[i].woke_frame = -1;
+		data[i].runs = 0;
+		coroutine_scheduler_spawn(scheduler, coroutine_scheduled_func, data + i);
+	}
+	CUTE_TEST_ASSERT(coroutine_scheduler_count(scheduler) == count);
+
+	// Everything starts on the first update, then waits from 0.1 to 1 second at 50ms per frame.
+	for (s_test_scheduler_frame = 0; s_test_scheduler_frame < 30; ++s_test_scheduler_frame) {
+		coroutine_scheduler_update(scheduler, 0.05f);
+		if (s_test_scheduler_frame == 0) {
+			CUTE_TEST_ASSERT(coroutine_scheduler_waiting_count(scheduler) == count);
+		}
+	}
+	for (int i = 0; i < count; ++i) {
+		CUTE_TEST_ASSERT(data[i].woke_frame == (i % 10 + 1) * 2);
+		CUTE_TEST_ASSERT(data[i].runs == 3);
+	}
+	CUTE_TEST_ASSERT(coroutine_scheduler_count(scheduler) == 0);
+	CUTE_TEST_ASSERT(coroutine_scheduler_waiting_count(scheduler) == 0);
+
+	// Finished coroutines hand their stacks to the next spawn.
+	coroutine_t* co = coroutine_scheduler_spawn(scheduler, coroutine_scheduled_func, data);
+	coroutine_destroy(co);
+	CUTE_TEST_ASSERT(coroutine_scheduler_spawn(scheduler, coroutine_scheduled_func, data) == co);
+
+	// Destroying a parked coroutine takes it out of the timer wheel.
+	coroutine_scheduler_update(scheduler, 0.05f);
+	CUTE_TEST_ASSERT(coroutine_scheduler_waiting_count(scheduler) == 1);
+	coroutine_destroy(co);
+	CUTE_TEST_ASSERT(coroutine_scheduler_waiting_count(scheduler) == 0);
+	CUTE_TEST_ASSERT(coroutine_scheduler_count(scheduler) == 0);
+
+	// Waits longer than the timer wheel spans get parked again until they're due.
+	data[0].woke_frame = -1;
+	coroutine_scheduler_spawn(scheduler, coroutine_long_wait_func, data);
+	for (s_test_scheduler_frame = 0; s_test_scheduler_frame < 30; ++s_test_scheduler_frame) {
+		coroutine_scheduler_update(scheduler, 1000.0f);
+	}
+	CUTE_TEST_ASSERT(data[0].woke_frame == 18);
+	CUTE_TEST_ASSERT(coroutine_scheduler_count(scheduler) == 0);
+
+	// A single update may span many hours at once.
+	data[0].woke_frame = -1;
+	coroutine_scheduler_spawn(scheduler, coroutine_long_wait_func, data);
+	s_test_scheduler_frame = 0;
+	coroutine_scheduler_update(scheduler, 0.05f);
+	s_test_scheduler_frame = 1;
+	coroutine_scheduler_update(scheduler, 4.0f * 60.0f * 60.0f);
+	CUTE_TEST_ASSERT(data[0].woke_frame == -1);
+	s_test_scheduler_frame = 2;
+	coroutine_scheduler_update(scheduler, 4.0f * 60.0f * 60.0f);
+	CUTE_TEST_ASSERT(data[0].woke_frame == 2);
+	CUTE_TEST_ASSERT(coroutine_scheduler_count(scheduler) == 0);
+
+	// Coroutines still alive are cleaned up along with the scheduler.
+	coroutine_scheduler_spawn(scheduler, coroutine_scheduled_func, data);
+	coroutine_scheduler_spawn(scheduler, coroutine_scheduled_func, data + 1);
+	coroutine_scheduler_update(scheduler, 0.05f);
+	coroutine_scheduler_destroy(scheduler);
+	CUTE_FREE(data, NULL);
+
+	return 0;
+}
+
+struct test_await_t
+{
+	threadpool_t* pool;
+	atomic_int_t done;
+	int seen;
+	int finished;
+};
+
+void test_await_task(void* param)
+{
+	test_await_t* data = (test_await_t*)param;
+	int sum = 0;
+	for (int i = 0; i < 100000; ++i) sum += i & 3;
+	atomic_add(&data->done, sum ? 1 : 0);
+}
+
+void coroutine_await_func(coroutine_t* co)
+{
+	test_await_t* data = (test_await_t*)coroutine_get_udata(co);
+	task_counter_t counter = { };
+	for (int i = 0; i < 8; ++i) {
+		threadpool_add_task(data->pool, test_await_task, data, &counter);
+	}
+	coroutine_await(co, data->pool, &counter);
+	data->seen = atomic_get(&data->done);
+
+	// Awaiting a counter that's already done carries on right away.
+	coroutine_await(co, data->pool, &counter);
+	data->finished = 1;
+}
+
+CUTE_TEST_CASE(test_coroutine_await, "Await threadpool tasks from coroutines, both scheduled and resumed by hand.");
+int test_coroutine_await()
+{
+	threadpool_t* pool = threadpool_create(2);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	// Scheduled coroutines are woken up by the scheduler once their tasks finish.
+	coroutine_scheduler_t* scheduler = coroutine_scheduler_make(1024 * 16);
+	test_await_t data[4];
+	for (int i = 0; i < 4; ++i) {
+		data[i].pool = pool;
+		data[i].done = atomic_zero();
+		data[i].seen = 0;
+		data[i].finished = 0;
+		coroutine_scheduler_spawn(scheduler, coroutine_await_func, data + i);
+	}
+	coroutine_scheduler_update(scheduler, 0);
+	while (coroutine_scheduler_count(scheduler)) {
+		coroutine_scheduler_update(scheduler, 0);
+	}
+	CUTE_TEST_ASSERT(coroutine_scheduler_awaiting_count(scheduler) == 0);
+	for (int i = 0; i < 4; ++i) {
+		CUTE_TEST_ASSERT(data[i].seen == 8);
+		CUTE_TEST_ASSERT(data[i].finished);
+	}
+
+	// The scheduler lets tasks still being awaited finish before it's destroyed.
+	data[0].done = atomic_zero();
+	data[0].finished = 0;
+	coroutine_scheduler_spawn(scheduler, coroutine_await_func, data);
+	coroutine_scheduler_update(scheduler, 0);
+	coroutine_scheduler_destroy(scheduler);
+	CUTE_TEST_ASSERT(atomic_get(&data[0].done) == 8);
+	CUTE_TEST_ASSERT(!data[0].finished);
+
+	// Coroutines resumed by hand skip resumes until their tasks are done.
+	data[0].done = atomic_zero();
+	data[0].seen = 0;
+	coroutine_t* co = coroutine_make(coroutine_await_func, 1024 * 16, data);
+	while (coroutine_state(co) != COROUTINE_STATE_DEAD) {
+		CUTE_TEST_ASSERT(!coroutine_resume(co).is_error());
+	}
+	CUTE_TEST_ASSERT(data[0].seen == 8);
+	CUTE_TEST_ASSERT(data[0].finished);
+	coroutine_destroy(co);
+
+	threadpool_destroy(pool);
+
+	return 0;
+}
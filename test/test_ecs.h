@@ -21,6 +21,7 @@
 
 #include <cute_ecs.h>
 #include <cute_kv_utils.h>
+#include <cute_concurrency.h>
 
 #include <internal/cute_ecs_internal.h>
 
@@ -349,3 +350,1227 @@ int test_ecs_no_kv()
 
 	return 0;
 }
+
+// -------------------------------------------------------------------------------------------------
+
+struct test_component_position_t
+{
+	int x = 0;
+};
+
+struct test_component_velocity_t
+{
+	int dx = 0;
+};
+
+struct test_component_health_t
+{
+	int hp = 0;
+};
+
+void update_test_move_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	FIND_COMPONENTS(test_component_position_t);
+	FIND_COMPONENTS(test_component_velocity_t);
+	for (int i = 0; i < count; ++i) {
+		test_component_position_ts[i].x += test_component_velocity_ts[i].dx;
+	}
+}
+
+void update_test_heal_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	FIND_COMPONENTS(test_component_health_t);
+	for (int i = 0; i < count; ++i) {
+		test_component_health_ts[i].hp += 1;
+	}
+}
+
+void update_test_accelerate_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	FIND_COMPONENTS(test_component_velocity_t);
+	for (int i = 0; i < count; ++i) {
+		test_component_velocity_ts[i].dx *= 2;
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_parallel_systems, "Run systems with declared component access in parallel.");
+int test_ecs_parallel_systems()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_size(sizeof(test_component_position_t));
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_velocity_t");
+	ecs_component_set_size(sizeof(test_component_velocity_t));
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_health_t");
+	ecs_component_set_size(sizeof(test_component_health_t));
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Mover");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_velocity_t");
+	ecs_entity_add_component("test_component_health_t");
+	ecs_entity_end();
+
+	// Moving and healing touch disjoint components and may run at the same time. Accelerating writes
+	// velocity, which moving reads, so it must run after moving.
+	ecs_system_begin();
+	ecs_system_set_update(update_test_move_system);
+	ecs_system_require_component_write("test_component_position_t");
+	ecs_system_require_component_read("test_component_velocity_t");
+	ecs_system_end();
+
+	ecs_system_begin();
+	ecs_system_set_update(update_test_heal_system);
+	ecs_system_require_component_write("test_component_health_t");
+	ecs_system_end();
+
+	ecs_system_begin();
+	ecs_system_set_update(update_test_accelerate_system);
+	ecs_system_require_component_write("test_component_velocity_t");
+	ecs_system_end();
+
+	array<entity_t> entities;
+	for (int i = 0; i < 100; ++i) {
+		entity_t e = entity_make("Mover");
+		CUTE_TEST_ASSERT(e != INVALID_ENTITY);
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(e, "test_component_position_t");
+		test_component_velocity_t* velocity = (test_component_velocity_t*)entity_get_component(e, "test_component_velocity_t");
+		test_component_health_t* health = (test_component_health_t*)entity_get_component(e, "test_component_health_t");
+		position->x = 0;
+		velocity->dx = 1;
+		health->hp = 0;
+		entities.add(e);
+	}
+
+	ecs_run_systems(0);
+	ecs_run_systems(0);
+
+	for (int i = 0; i < entities.count(); ++i) {
+		entity_t e = entities[i];
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(e, "test_component_position_t");
+		test_component_velocity_t* velocity = (test_component_velocity_t*)entity_get_component(e, "test_component_velocity_t");
+		test_component_health_t* health = (test_component_health_t*)entity_get_component(e, "test_component_health_t");
+		CUTE_TEST_ASSERT(position->x == 3);
+		CUTE_TEST_ASSERT(velocity->dx == 4);
+		CUTE_TEST_ASSERT(health->hp == 2);
+	}
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+int s_parallel_for_mismatches;
+void update_test_parallel_for_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	FIND_COMPONENTS(test_component_position_t);
+	entity_t* entities = ecs_arrays_get_entities(arrays);
+	for (int i = 0; i < count; ++i) {
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(entities[i], "test_component_position_t");
+		if (position != test_component_position_ts + i) {
+			atomic_add((atomic_int_t*)udata, 1);
+		}
+		position->x += 1;
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_parallel_for, "Update a single system over sub-ranges of a collection in parallel.");
+int test_ecs_parallel_for()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_size(sizeof(test_component_position_t));
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dot");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_end();
+
+	atomic_int_t mismatches = atomic_zero();
+	ecs_system_begin();
+	ecs_system_set_update(update_test_parallel_for_system);
+	ecs_system_require_component_write("test_component_position_t");
+	ecs_system_set_optional_update_udata(&mismatches);
+	ecs_system_set_optional_parallel_for(64);
+	ecs_system_end();
+
+	array<entity_t> entities;
+	for (int i = 0; i < 1000; ++i) {
+		entity_t e = entity_make("Dot");
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(e, "test_component_position_t");
+		position->x = i;
+		entities.add(e);
+	}
+
+	ecs_run_systems(0);
+
+	CUTE_TEST_ASSERT(atomic_get(&mismatches) == 0);
+	for (int i = 0; i < entities.count(); ++i) {
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(entities[i], "test_component_position_t");
+		CUTE_TEST_ASSERT(position->x == i + 1);
+	}
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+CUTE_TEST_CASE(test_ecs_component_ids, "Fetch components by integer id and by type.");
+int test_ecs_component_ids()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_type<test_component_position_t>();
+	component_id_t position_id = ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_health_t");
+	ecs_component_set_type<test_component_health_t>();
+	component_id_t health_id = ecs_component_end();
+
+	CUTE_TEST_ASSERT(position_id != INVALID_COMPONENT_ID);
+	CUTE_TEST_ASSERT(health_id != position_id);
+	CUTE_TEST_ASSERT(ecs_component_id<test_component_position_t>() == position_id);
+	CUTE_TEST_ASSERT(ecs_component_id<test_component_health_t>() == health_id);
+	CUTE_TEST_ASSERT(ecs_component_get_id("test_component_health_t") == health_id);
+	CUTE_TEST_ASSERT(ecs_component_get_id("not_a_component") == INVALID_COMPONENT_ID);
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dot");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_end();
+
+	entity_t e = entity_make("Dot");
+	CUTE_TEST_ASSERT(entity_has_component<test_component_position_t>(e));
+	CUTE_TEST_ASSERT(!entity_has_component<test_component_health_t>(e));
+	CUTE_TEST_ASSERT(!entity_get_component(e, health_id));
+
+	test_component_position_t* position = entity_get_component<test_component_position_t>(e);
+	CUTE_TEST_ASSERT(position);
+	CUTE_TEST_ASSERT(position == entity_get_component(e, "test_component_position_t"));
+	CUTE_TEST_ASSERT(position == entity_get_component(e, position_id));
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void update_test_view_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	ecs_view<test_component_position_t, test_component_velocity_t, test_component_health_t> view(arrays, count);
+	ecs_span_t<test_component_position_t> positions = view.get<test_component_position_t>();
+	ecs_span_t<test_component_velocity_t> velocities = view.get<test_component_velocity_t>();
+	for (int i = 0; i < view.count; ++i) {
+		positions[i].x += velocities[i].dx;
+	}
+	for (test_component_health_t& health : view.get<test_component_health_t>()) {
+		health.hp += 1;
+	}
+	*(int*)udata += count;
+}
+
+CUTE_TEST_CASE(test_ecs_view, "Access components within systems through typed views.");
+int test_ecs_view()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_type<test_component_position_t>();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_velocity_t");
+	ecs_component_set_type<test_component_velocity_t>();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_health_t");
+	ecs_component_set_type<test_component_health_t>();
+	ecs_component_end();
+
+	CUTE_TEST_ASSERT(ecs_component_get_size(ecs_component_id<test_component_velocity_t>()) == sizeof(test_component_velocity_t));
+	CUTE_TEST_ASSERT(ecs_component_get_size(INVALID_COMPONENT_ID) == 0);
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Mover");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_velocity_t");
+	ecs_entity_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Living Mover");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_velocity_t");
+	ecs_entity_add_component("test_component_health_t");
+	ecs_entity_end();
+
+	int updated = 0;
+	ecs_system_begin();
+	ecs_system_set_update(update_test_view_system);
+	ecs_system_require_component("test_component_position_t");
+	ecs_system_require_component("test_component_velocity_t");
+	ecs_system_set_optional_update_udata(&updated);
+	ecs_system_end();
+
+	entity_t mover = entity_make("Mover");
+	entity_t living = entity_make("Living Mover");
+	*entity_get_component<test_component_position_t>(mover) = test_component_position_t();
+	*entity_get_component<test_component_position_t>(living) = test_component_position_t();
+	*entity_get_component<test_component_health_t>(living) = test_component_health_t();
+	entity_get_component<test_component_velocity_t>(mover)->dx = 2;
+	entity_get_component<test_component_velocity_t>(living)->dx = 3;
+
+	ecs_run_systems(0);
+	ecs_run_systems(0);
+
+	CUTE_TEST_ASSERT(updated == 4);
+	CUTE_TEST_ASSERT(entity_get_component<test_component_position_t>(mover)->x == 4);
+	CUTE_TEST_ASSERT(entity_get_component<test_component_position_t>(living)->x == 6);
+	CUTE_TEST_ASSERT(entity_get_component<test_component_health_t>(living)->hp == 2);
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+int s_prototype_serialize_count;
+cute::error_t test_component_collider_counting_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	s_prototype_serialize_count++;
+	return test_component_collider_serialize(kv, reading, entity, component, udata);
+}
+
+void test_component_sprite_post_construct(entity_t entity, void* component, void* udata)
+{
+	test_component_sprite_t* sprite = (test_component_sprite_t*)component;
+	sprite->img_id += entity.handle;
+}
+
+CUTE_TEST_CASE(test_ecs_prototypes, "Construct components by copying baked prototypes.");
+int test_ecs_prototypes()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_size(sizeof(test_component_collider_t));
+	ecs_component_set_name(CUTE_STRINGIZE(test_component_collider_t));
+	ecs_component_set_optional_serializer(test_component_collider_counting_serialize);
+	ecs_component_set_optional_prototype();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_size(sizeof(test_component_sprite_t));
+	ecs_component_set_name(CUTE_STRINGIZE(test_component_sprite_t));
+	ecs_component_set_optional_serializer(test_component_sprite_serialize);
+	ecs_component_set_optional_post_construct(test_component_sprite_post_construct);
+	ecs_component_end();
+
+	const char* base_schema_string = CUTE_STRINGIZE(
+		entity_type = "Projectile",
+		test_component_collider_t = {
+			type = 4,
+			radius = 3
+		},
+		test_component_sprite_t = { },
+	);
+	const char* derived_schema_string = CUTE_STRINGIZE(
+		entity_type = "BigProjectile",
+		inherits_from = "Projectile",
+		test_component_collider_t = {
+			type = 5,
+			radius = 10
+		},
+		test_component_sprite_t = { },
+	);
+
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(base_schema_string);
+	ecs_entity_end();
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(derived_schema_string);
+	ecs_entity_end();
+
+	// Baking runs the serializer once for the base, and twice for the derived type (once per schema in the chain).
+	CUTE_TEST_ASSERT(s_prototype_serialize_count == 3);
+
+	for (int i = 0; i < 100; ++i) {
+		entity_t e = entity_make("BigProjectile");
+		test_component_collider_t* collider = (test_component_collider_t*)entity_get_component(e, "test_component_collider_t");
+		CUTE_TEST_ASSERT(collider->type == 5);
+		CUTE_TEST_ASSERT(collider->radius == 10.0f);
+		test_component_sprite_t* sprite = (test_component_sprite_t*)entity_get_component(e, "test_component_sprite_t");
+		CUTE_TEST_ASSERT(sprite->img_id == 7 + e.handle);
+	}
+
+	entity_t e = entity_make("Projectile");
+	test_component_collider_t* collider = (test_component_collider_t*)entity_get_component(e, "test_component_collider_t");
+	CUTE_TEST_ASSERT(collider->type == 4);
+	CUTE_TEST_ASSERT(collider->radius == 3.0f);
+
+	// No further serializer calls for baked components.
+	CUTE_TEST_ASSERT(s_prototype_serialize_count == 3);
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+int s_health_cleanup_count;
+void test_component_health_cleanup(entity_t entity, void* component, void* udata)
+{
+	s_health_cleanup_count++;
+}
+
+struct test_component_link_t
+{
+	entity_t other;
+};
+
+void test_component_link_cleanup(entity_t entity, void* component, void* udata)
+{
+	// Destroying entities from within a cleanup moves rows around mid-batch.
+	test_component_link_t* link = (test_component_link_t*)component;
+	if (entity_is_valid(link->other)) entity_destroy(link->other);
+}
+
+CUTE_TEST_CASE(test_ecs_make_destroy_many, "Make and destroy entities in bulk.");
+int test_ecs_make_destroy_many()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_type<test_component_position_t>();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_health_t");
+	ecs_component_set_type<test_component_health_t>();
+	ecs_component_set_optional_cleanup(test_component_health_cleanup);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Mob");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_health_t");
+	ecs_entity_end();
+
+	const int count = 1000;
+	array<entity_t> entities;
+	entities.ensure_count(count);
+	CUTE_TEST_ASSERT(!entity_make_many("Mob", count, entities.data()).is_error());
+	CUTE_TEST_ASSERT(entity_make_many("NotAnEntityType", count, entities.data()).is_error());
+	entity_t single = entity_make("Mob");
+	for (int i = 0; i < count; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(entities[i]));
+		entity_get_component<test_component_position_t>(entities[i])->x = i;
+	}
+
+	// Destroy every third entity, with a duplicate and an already destroyed entity mixed in.
+	array<entity_t> doomed;
+	for (int i = 0; i < count; i += 3) doomed.add(entities[i]);
+	doomed.add(entities[0]);
+	entity_destroy(entities[1]);
+	doomed.add(entities[1]);
+	s_health_cleanup_count = 0;
+	entity_destroy_many(doomed.data(), doomed.count());
+	CUTE_TEST_ASSERT(s_health_cleanup_count == (count + 2) / 3);
+
+	for (int i = 0; i < count; ++i) {
+		bool destroyed = i % 3 == 0 || i == 1;
+		CUTE_TEST_ASSERT(entity_is_valid(entities[i]) == !destroyed);
+		if (!destroyed) CUTE_TEST_ASSERT(entity_get_component<test_component_position_t>(entities[i])->x == i);
+	}
+	CUTE_TEST_ASSERT(entity_is_valid(single));
+
+	// Freed slots are reused.
+	CUTE_TEST_ASSERT(!entity_make_many("Mob", count, entities.data()).is_error());
+	for (int i = 0; i < count; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(entities[i]));
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_link_t");
+	ecs_component_set_type<test_component_link_t>();
+	ecs_component_set_optional_cleanup(test_component_link_cleanup);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Linked");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_link_t");
+	ecs_entity_end();
+
+	// The first half of the linked entities is destroyed in a batch. Each one destroys an entity from
+	// the second half on cleanup, and the first few destroy a mob or another entity from the batch.
+	const int linked_count = 100;
+	const int half = linked_count / 2;
+	array<entity_t> linked;
+	linked.ensure_count(linked_count);
+	CUTE_TEST_ASSERT(!entity_make_many("Linked", linked_count, linked.data()).is_error());
+	for (int i = 0; i < linked_count; ++i) {
+		entity_get_component<test_component_position_t>(linked[i])->x = i;
+		entity_t other = INVALID_ENTITY;
+		if (i < 10) other = entities[i];
+		else if (i == 10) other = linked[11];
+		else if (i < half) other = linked[i + half];
+		entity_get_component<test_component_link_t>(linked[i])->other = other;
+	}
+	entity_destroy_many(linked.data(), half);
+	for (int i = 0; i < linked_count; ++i) {
+		bool destroyed = i < half || (i >= half + 11);
+		CUTE_TEST_ASSERT(entity_is_valid(linked[i]) == !destroyed);
+		if (!destroyed) CUTE_TEST_ASSERT(entity_get_component<test_component_position_t>(linked[i])->x == i);
+	}
+	for (int i = 0; i < count; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(entities[i]) == (i >= 10));
+	}
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+CUTE_TEST_CASE(test_ecs_snapshot, "Save and load all entities with a binary snapshot.");
+int test_ecs_snapshot()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_size(sizeof(test_component_transform_t));
+	ecs_component_set_name(CUTE_STRINGIZE(test_component_transform_t));
+	ecs_component_set_optional_serializer(test_component_transform_serialize);
+	ecs_component_set_optional_pod();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_size(sizeof(test_component_octorok_t));
+	ecs_component_set_name(CUTE_STRINGIZE(test_component_octorok_t));
+	ecs_component_set_optional_serializer(test_component_octorok_serialize);
+	ecs_component_end();
+
+	const char* octorok_schema_string = CUTE_STRINGIZE(
+		entity_type = "Octorok",
+		test_component_transform_t = { },
+		test_component_octorok_t = { },
+	);
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(octorok_schema_string);
+	ecs_entity_end();
+
+	entity_t e[4];
+	CUTE_TEST_ASSERT(!entity_make_many("Octorok", 4, e).is_error());
+	for (int i = 0; i < 4; ++i) {
+		test_component_transform_t* transform = (test_component_transform_t*)entity_get_component(e[i], "test_component_transform_t");
+		transform->x = (float)i;
+		transform->y = (float)-i;
+		test_component_octorok_t* octorok = (test_component_octorok_t*)entity_get_component(e[i], "test_component_octorok_t");
+		octorok->ai_state = 10 + i;
+		octorok->buddy = e[(i + 1) % 4];
+	}
+	test_component_octorok_t* octorok = (test_component_octorok_t*)entity_get_component(e[3], "test_component_octorok_t");
+	octorok->buddy = e[1];
+	entity_destroy(e[0]);
+
+	void* snapshot;
+	size_t size;
+	CUTE_TEST_ASSERT(!ecs_save_snapshot(&snapshot, &size).is_error());
+
+	// Truncated snapshots are rejected without modifying any entities.
+	CUTE_TEST_ASSERT(ecs_load_snapshot(snapshot, size - 1).is_error());
+	CUTE_TEST_ASSERT(entity_is_valid(e[1]));
+
+	// So are corrupt handle tables and serialized components.
+	uint8_t* corrupt = (uint8_t*)CUTE_ALLOC(size, NULL);
+	CUTE_MEMCPY(corrupt, snapshot, size);
+	int handle_count_offset = 8 + 4 + 4 + (4 + 7) + 4 + 4 + 4 + 4 + 4; // Header, "Octorok", entity type, entity count, then the handle table's size, freelist and free count.
+	int bad_handle_count = 1000;
+	CUTE_MEMCPY(corrupt + handle_count_offset, &bad_handle_count, sizeof(int));
+	CUTE_TEST_ASSERT(ecs_load_snapshot(corrupt, size).is_error());
+	CUTE_TEST_ASSERT(entity_is_valid(e[1]));
+	CUTE_MEMCPY(corrupt, snapshot, size);
+	for (size_t i = 0; i + 10 <= size; ++i) {
+		if (!CUTE_MEMCMP(corrupt + i, "components", 10)) corrupt[i] = 'x';
+	}
+	CUTE_TEST_ASSERT(ecs_load_snapshot(corrupt, size).is_error());
+	CUTE_FREE(corrupt, NULL);
+	for (int i = 1; i < 4; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(e[i]));
+		octorok = (test_component_octorok_t*)entity_get_component(e[i], "test_component_octorok_t");
+		CUTE_TEST_ASSERT(octorok->ai_state == 10 + i);
+	}
+
+	// Scramble the world, then restore it.
+	entity_t scramble[8];
+	entity_destroy_many(e + 1, 3);
+	CUTE_TEST_ASSERT(!entity_make_many("Octorok", 8, scramble).is_error());
+	CUTE_TEST_ASSERT(!ecs_load_snapshot(snapshot, size).is_error());
+	CUTE_FREE(snapshot, NULL);
+
+	CUTE_TEST_ASSERT(!entity_is_valid(e[0]));
+	for (int i = 1; i < 4; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(e[i]));
+		test_component_transform_t* transform = (test_component_transform_t*)entity_get_component(e[i], "test_component_transform_t");
+		CUTE_TEST_ASSERT(transform->x == (float)i);
+		CUTE_TEST_ASSERT(transform->y == (float)-i);
+		octorok = (test_component_octorok_t*)entity_get_component(e[i], "test_component_octorok_t");
+		CUTE_TEST_ASSERT(octorok->ai_state == 10 + i);
+		CUTE_TEST_ASSERT(octorok->buddy == e[i == 3 ? 1 : i + 1]);
+	}
+
+	// Handles keep working after loading.
+	entity_t fresh = entity_make("Octorok");
+	CUTE_TEST_ASSERT(entity_is_valid(fresh));
+	for (int i = 1; i < 4; ++i) CUTE_TEST_ASSERT(fresh != e[i]);
+	entity_destroy(fresh);
+
+	// Components that are neither plain old data nor have a serializer may own pointers, so they
+	// can't be saved.
+	ecs_component_begin();
+	ecs_component_set_size(sizeof(test_component_sprite_t));
+	ecs_component_set_name(CUTE_STRINGIZE(test_component_sprite_t));
+	ecs_component_end();
+
+	// Schemas are copied, so they may be temporary.
+	const char* sprite_schema_string = CUTE_STRINGIZE(
+		entity_type = "Sprite",
+		test_component_sprite_t = { },
+	);
+	char sprite_schema[128];
+	CUTE_STRNCPY(sprite_schema, sprite_schema_string, sizeof(sprite_schema));
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(sprite_schema);
+	CUTE_MEMSET(sprite_schema, 0, sizeof(sprite_schema));
+	ecs_entity_end();
+	CUTE_MEMSET(sprite_schema, 'x', sizeof(sprite_schema) - 1);
+
+	CUTE_TEST_ASSERT(entity_is_valid(entity_make("Sprite")));
+	CUTE_TEST_ASSERT(ecs_save_snapshot(&snapshot, &size).is_error());
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+int s_changed_positions;
+int s_changed_tables;
+bool s_move_first_dot;
+
+void update_test_move_first_dot_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	if (!s_move_first_dot || !count) return;
+	test_component_position_t* positions = (test_component_position_t*)ecs_arrays_find_components(arrays, ecs_component_id<test_component_position_t>());
+	positions[0].x++;
+	ecs_arrays_mark_dirty(arrays, ecs_component_id<test_component_position_t>(), 0);
+}
+
+void update_test_replicate_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	component_id_t id = ecs_component_id<test_component_position_t>();
+	if (!ecs_arrays_changed(arrays, id)) return;
+	s_changed_tables++;
+	for (int i = 0; i < count; ++i) {
+		if (ecs_arrays_changed(arrays, id, i)) s_changed_positions++;
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_change_tracking, "Visit only components changed since a system last ran.");
+int test_ecs_change_tracking()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_type<test_component_position_t>();
+	ecs_component_set_optional_change_tracking();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_health_t");
+	ecs_component_set_type<test_component_health_t>();
+	ecs_component_end();
+
+	ecs_system_begin();
+	ecs_system_require_component_write("test_component_position_t");
+	ecs_system_set_update(update_test_move_first_dot_system);
+	ecs_system_end();
+
+	ecs_system_begin();
+	ecs_system_require_component_read("test_component_position_t");
+	ecs_system_set_update(update_test_replicate_system);
+	ecs_system_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dot");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_health_t");
+	ecs_entity_end();
+
+	entity_t e[10];
+	CUTE_TEST_ASSERT(!entity_make_many("Dot", 10, e).is_error());
+
+	// New entities count as changed.
+	s_move_first_dot = false;
+	s_changed_tables = s_changed_positions = 0;
+	ecs_run_systems(0);
+	CUTE_TEST_ASSERT(s_changed_tables == 1);
+	CUTE_TEST_ASSERT(s_changed_positions == 10);
+
+	// Nothing changed, the whole collection is skipped.
+	s_changed_tables = s_changed_positions = 0;
+	ecs_run_systems(0);
+	CUTE_TEST_ASSERT(s_changed_tables == 0);
+
+	// Writes outside of systems.
+	uint64_t tick = ecs_get_change_tick();
+	entity_get_component_for_write<test_component_position_t>(e[3])->x = 5;
+	ecs_mark_dirty(e[7], "test_component_position_t");
+	entity_get_component<test_component_position_t>(e[8])->x = 5; // Not tracked.
+	CUTE_TEST_ASSERT(entity_component_changed_since(e[3], ecs_component_id<test_component_position_t>(), tick - 1));
+	CUTE_TEST_ASSERT(!entity_component_changed_since(e[8], ecs_component_id<test_component_position_t>(), tick - 1));
+	CUTE_TEST_ASSERT(entity_component_changed_since(e[8], ecs_component_id<test_component_health_t>(), tick)); // Untracked.
+	s_changed_tables = s_changed_positions = 0;
+	ecs_run_systems(0);
+	CUTE_TEST_ASSERT(s_changed_positions == 2);
+
+	// Writes from an earlier system in the same frame.
+	s_move_first_dot = true;
+	s_changed_tables = s_changed_positions = 0;
+	ecs_run_systems(0);
+	CUTE_TEST_ASSERT(s_changed_positions == 1);
+
+	// Change ticks follow their rows as entities are destroyed.
+	s_move_first_dot = false;
+	entity_destroy(e[0]);
+	entity_destroy_many(e + 1, 2);
+	tick = ecs_get_change_tick();
+	ecs_mark_dirty(e[9], "test_component_position_t");
+	for (int i = 3; i < 10; ++i) {
+		CUTE_TEST_ASSERT(entity_component_changed_since(e[i], ecs_component_id<test_component_position_t>(), tick - 1) == (i == 9));
+	}
+	s_changed_tables = s_changed_positions = 0;
+	ecs_run_systems(0);
+	CUTE_TEST_ASSERT(s_changed_positions == 1);
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void update_test_spawner_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	test_component_position_t* positions = (test_component_position_t*)ecs_arrays_find_components(arrays, ecs_component_id<test_component_position_t>());
+	entity_t* entities = ecs_arrays_get_entities(arrays);
+	for (int i = 0; i < count; ++i) {
+		int x = positions[i].x;
+		if (x % 10 == 0) {
+			entity_t spark = entity_delayed_make("Spark");
+			test_component_position_t position;
+			position.x = x;
+			entity_delayed_set_component(spark, position);
+		} else if (x % 10 == 5) {
+			entity_delayed_destroy(entities[i]);
+		}
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_delayed_commands, "Make and destroy entities from parallel systems with delayed commands.");
+int test_ecs_delayed_commands()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_type<test_component_position_t>();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_health_t");
+	ecs_component_set_type<test_component_health_t>();
+	ecs_component_end();
+
+	ecs_system_begin();
+	ecs_system_require_component_read("test_component_position_t");
+	ecs_system_require_component_read("test_component_health_t");
+	ecs_system_set_update(update_test_spawner_system);
+	ecs_system_set_optional_parallel_for(64);
+	ecs_system_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dot");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_health_t");
+	ecs_entity_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Spark");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_end();
+
+	const int count = 1000;
+	array<entity_t> dots;
+	dots.ensure_count(count);
+	CUTE_TEST_ASSERT(!entity_make_many("Dot", count, dots.data()).is_error());
+	for (int i = 0; i < count; ++i) {
+		entity_get_component<test_component_position_t>(dots[i])->x = i;
+	}
+
+	ecs_run_systems(0);
+
+	for (int i = 0; i < count; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(dots[i]) == (i % 10 != 5));
+	}
+
+	// Playback is deterministic, so sparks are made in the same order as the dots were iterated.
+	entity_collection_t* sparks = app->ecs_world->entity_collections.find(1);
+	CUTE_TEST_ASSERT(sparks->entity_handles.count() == count / 10);
+	for (int i = 0; i < sparks->entity_handles.count(); ++i) {
+		entity_t spark = { sparks->entity_handles[i] };
+		CUTE_TEST_ASSERT(entity_get_component<test_component_position_t>(spark)->x == i * 10);
+	}
+
+	// Delayed commands from outside of systems wait for a flush.
+	entity_t spark = entity_delayed_make("Spark");
+	entity_delayed_destroy(dots[0]);
+	CUTE_TEST_ASSERT(entity_is_valid(dots[0]));
+	CUTE_TEST_ASSERT(!entity_is_valid(spark));
+	ecs_flush_delayed_commands();
+	CUTE_TEST_ASSERT(!entity_is_valid(dots[0]));
+	CUTE_TEST_ASSERT(sparks->entity_handles.count() == count / 10 + 1);
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+CUTE_TEST_CASE(test_ecs_stats, "Query per-system timings and memory per component table.");
+int test_ecs_stats()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_type<test_component_position_t>();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_velocity_t");
+	ecs_component_set_type<test_component_velocity_t>();
+	ecs_component_end();
+
+	ecs_system_begin();
+	ecs_system_set_name("move");
+	ecs_system_require_component_write("test_component_position_t");
+	ecs_system_require_component_read("test_component_velocity_t");
+	ecs_system_set_update(update_test_move_system);
+	ecs_system_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Mover");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_velocity_t");
+	ecs_entity_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dot");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_end();
+
+	entity_t e[300];
+	CUTE_TEST_ASSERT(!entity_make_many("Mover", 300, e).is_error());
+	entity_destroy(e[0]);
+	entity_make("Dot");
+	ecs_run_systems(0);
+
+	array<ecs_system_stats_t> system_stats;
+	ecs_get_system_stats(&system_stats);
+	CUTE_TEST_ASSERT(system_stats.count() == 1);
+	CUTE_TEST_ASSERT(!CUTE_STRCMP(system_stats[0].name, "move"));
+	CUTE_TEST_ASSERT(system_stats[0].collections_updated == 1);
+	CUTE_TEST_ASSERT(system_stats[0].entities_updated == 299);
+	CUTE_TEST_ASSERT(system_stats[0].update_seconds >= 0);
+
+	array<ecs_entity_type_stats_t> entity_type_stats;
+	ecs_get_entity_type_stats(&entity_type_stats);
+	CUTE_TEST_ASSERT(entity_type_stats.count() == 2);
+	CUTE_TEST_ASSERT(!CUTE_STRCMP(entity_type_stats[0].entity_type, "Mover"));
+	CUTE_TEST_ASSERT(entity_type_stats[0].entity_count == 299);
+	CUTE_TEST_ASSERT(entity_type_stats[0].handle_capacity - entity_type_stats[0].handles_free >= 299);
+	CUTE_TEST_ASSERT(entity_type_stats[1].entity_count == 1);
+
+	array<ecs_component_table_stats_t> table_stats;
+	ecs_get_component_table_stats(&table_stats);
+	CUTE_TEST_ASSERT(table_stats.count() == 3);
+	CUTE_TEST_ASSERT(!CUTE_STRCMP(table_stats[0].component_type, "test_component_position_t"));
+	CUTE_TEST_ASSERT(table_stats[0].count == 299);
+	CUTE_TEST_ASSERT(table_stats[0].capacity >= 299);
+	CUTE_TEST_ASSERT(table_stats[0].bytes_used == 299 * sizeof(test_component_position_t));
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+struct test_ecs_world_t
+{
+	ecs_world_t* world;
+	int speed;
+	bool ok;
+};
+
+void update_test_world_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	FIND_COMPONENTS(test_component_position_t);
+	for (int i = 0; i < count; ++i) {
+		test_component_position_ts[i].x += *(int*)udata;
+	}
+}
+
+int test_ecs_world_thread(void* udata)
+{
+	test_ecs_world_t* w = (test_ecs_world_t*)udata;
+	ecs_set_world(w->world);
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_size(sizeof(test_component_position_t));
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dot");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_end();
+
+	ecs_system_begin();
+	ecs_system_set_update(update_test_world_system);
+	ecs_system_require_component_write("test_component_position_t");
+	ecs_system_set_optional_update_udata(&w->speed);
+	ecs_system_set_optional_parallel_for(16);
+	ecs_system_end();
+
+	entity_t entities[100];
+	entity_make_many("Dot", 100, entities);
+	for (int i = 0; i < 100; ++i) {
+		((test_component_position_t*)entity_get_component(entities[i], "test_component_position_t"))->x = 0;
+	}
+
+	for (int i = 0; i < 1000; ++i) {
+		ecs_run_systems(0);
+		entity_delayed_destroy(entity_delayed_make("Dot"));
+		ecs_flush_delayed_commands();
+	}
+
+	w->ok = ecs_get_world() == w->world;
+	for (int i = 0; i < 100; ++i) {
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(entities[i], "test_component_position_t");
+		if (position->x != w->speed * 1000) w->ok = false;
+	}
+
+	ecs_set_world(NULL);
+	return 0;
+}
+
+struct test_ecs_other_world_t
+{
+	ecs_world_t* world;
+	ecs_world_t* other;
+	entity_t entity;
+	int x;
+};
+
+void update_test_other_world_system(float dt, ecs_arrays_t* arrays, int count, void* udata)
+{
+	// Look up an entity of the same type in another world while iterating this one.
+	test_ecs_other_world_t* w = (test_ecs_other_world_t*)udata;
+	ecs_set_world(w->other);
+	test_component_position_t* position = (test_component_position_t*)entity_get_component(w->entity, "test_component_position_t");
+	w->x = position ? position->x : -1;
+	ecs_set_world(w->world);
+}
+
+CUTE_TEST_CASE(test_ecs_worlds, "Run independent worlds on different threads at once.");
+int test_ecs_worlds()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_world_t* default_world = ecs_get_world();
+	test_ecs_world_t worlds[4];
+	thread_t* threads[4];
+	for (int i = 0; i < 4; ++i) {
+		worlds[i].world = ecs_world_make();
+		worlds[i].speed = i + 1;
+		worlds[i].ok = false;
+		CUTE_TEST_ASSERT(worlds[i].world != default_world);
+	}
+	for (int i = 0; i < 4; ++i) {
+		threads[i] = thread_create(test_ecs_world_thread, "world", worlds + i);
+	}
+	for (int i = 0; i < 4; ++i) {
+		CUTE_TEST_ASSERT(!thread_wait(threads[i]).is_error());
+		CUTE_TEST_ASSERT(worlds[i].ok);
+	}
+
+	// Worlds running at the same time may share a threadpool.
+	threadpool_t* pool = threadpool_create(3);
+	test_ecs_world_t shared_worlds[4];
+	for (int i = 0; i < 4; ++i) {
+		shared_worlds[i].world = ecs_world_make(pool);
+		shared_worlds[i].speed = i + 1;
+		shared_worlds[i].ok = false;
+	}
+	for (int i = 0; i < 4; ++i) {
+		threads[i] = thread_create(test_ecs_world_thread, "shared world", shared_worlds + i);
+	}
+	for (int i = 0; i < 4; ++i) {
+		CUTE_TEST_ASSERT(!thread_wait(threads[i]).is_error());
+		CUTE_TEST_ASSERT(shared_worlds[i].ok);
+	}
+	for (int i = 0; i < 4; ++i) {
+		ecs_world_destroy(shared_worlds[i].world);
+	}
+	threadpool_destroy(pool);
+
+	// The default world never saw any of the registrations.
+	CUTE_TEST_ASSERT(ecs_get_world() == default_world);
+	CUTE_TEST_ASSERT(!ecs_is_entity_type_valid("Dot"));
+
+	// Run a world from the main thread.
+	ecs_set_world(worlds[0].world);
+	CUTE_TEST_ASSERT(ecs_is_entity_type_valid("Dot"));
+	ecs_set_world(NULL);
+	ecs_run_systems(worlds[0].world, 0);
+	CUTE_TEST_ASSERT(ecs_get_world() == default_world);
+
+	// Systems may switch worlds, and still find entities of the same type in the other world.
+	test_ecs_other_world_t other;
+	other.world = worlds[0].world;
+	other.other = worlds[1].world;
+	other.x = 0;
+	ecs_set_world(worlds[1].world);
+	other.entity = entity_make("Dot");
+	((test_component_position_t*)entity_get_component(other.entity, "test_component_position_t"))->x = 12345;
+	ecs_set_world(worlds[0].world);
+	ecs_system_begin();
+	ecs_system_set_update(update_test_other_world_system);
+	ecs_system_require_component("test_component_position_t");
+	ecs_system_set_optional_update_udata(&other);
+	ecs_system_end();
+	ecs_run_systems(0);
+	CUTE_TEST_ASSERT(other.x == 12345);
+	ecs_set_world(NULL);
+
+	for (int i = 0; i < 4; ++i) {
+		ecs_world_destroy(worlds[i].world);
+	}
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+uint64_t test_ecs_sort_key(entity_t entity, void* udata)
+{
+	return (uint64_t)entity_get_component<test_component_position_t>(entity)->x;
+}
+
+bool test_ecs_is_sorted(entity_t* entities, int count)
+{
+	const test_component_position_t* first = NULL;
+	for (int i = 0; i < count; ++i) {
+		// Each entity must still own its own component.
+		const test_component_position_t* position = entity_get_component<test_component_position_t>(entities[i]);
+		if (position->x != entity_get_component<test_component_health_t>(entities[i])->hp) return false;
+		if (!first || position < first) first = position;
+	}
+
+	// Components are laid out in ascending key order.
+	for (int i = 0; i < count; ++i) {
+		if (first[i].x != i) return false;
+	}
+	return true;
+}
+
+CUTE_TEST_CASE(test_ecs_sort, "Reorder entities within a collection by key.");
+int test_ecs_sort()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_type<test_component_position_t>();
+	ecs_component_set_optional_change_tracking();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_health_t");
+	ecs_component_set_type<test_component_health_t>();
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dot");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_health_t");
+	ecs_entity_end();
+
+	const int count = 1000;
+	entity_t entities[count];
+	CUTE_TEST_ASSERT(!entity_make_many("Dot", count, entities).is_error());
+	for (int i = 0; i < count; ++i) {
+		int x = (i * 7919) % count;
+		entity_get_component<test_component_position_t>(entities[i])->x = x;
+		entity_get_component<test_component_health_t>(entities[i])->hp = x;
+	}
+	CUTE_TEST_ASSERT(!test_ecs_is_sorted(entities, count));
+
+	CUTE_TEST_ASSERT(ecs_sort_collection("Nope", test_ecs_sort_key).is_error());
+	CUTE_TEST_ASSERT(!ecs_sort_collection("Dot", test_ecs_sort_key).is_error());
+	CUTE_TEST_ASSERT(test_ecs_is_sorted(entities, count));
+	for (int i = 0; i < count; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(entities[i]));
+	}
+
+	// Reverse all keys, then sort a little bit at a time.
+	for (int i = 0; i < count; ++i) {
+		test_component_position_t* position = entity_get_component<test_component_position_t>(entities[i]);
+		position->x = count - 1 - position->x;
+		entity_get_component<test_component_health_t>(entities[i])->hp = position->x;
+	}
+	CUTE_TEST_ASSERT(!test_ecs_is_sorted(entities, count));
+	CUTE_TEST_ASSERT(ecs_sort_collection_incremental("Nope", test_ecs_sort_key) == -1);
+
+	int calls = 0;
+	int quiet_calls = 0;
+	while (quiet_calls < 2 * count / 64 && calls < 10000) {
+		int moved = ecs_sort_collection_incremental("Dot", test_ecs_sort_key, NULL, 64);
+		quiet_calls = moved ? 0 : quiet_calls + 1;
+		++calls;
+	}
+	CUTE_TEST_ASSERT(calls < 10000);
+	CUTE_TEST_ASSERT(test_ecs_is_sorted(entities, count));
+
+	// Destroying after sorting still finds the right rows.
+	entity_destroy(entities[0]);
+	CUTE_TEST_ASSERT(!entity_is_valid(entities[0]));
+	for (int i = 1; i < count; ++i) {
+		CUTE_TEST_ASSERT(entity_get_component<test_component_position_t>(entities[i])->x == entity_get_component<test_component_health_t>(entities[i])->hp);
+	}
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+struct alignas(32) test_component_simd_t
+{
+	float v[8];
+};
+
+CUTE_TEST_CASE(test_ecs_alignment, "Align components for SIMD.");
+int test_ecs_alignment()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_position_t");
+	ecs_component_set_size(sizeof(test_component_position_t));
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_simd_t");
+	ecs_component_set_type<test_component_simd_t>();
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("padded");
+	ecs_component_set_size(12);
+	ecs_component_set_alignment(64);
+	component_id_t padded_id = ecs_component_end();
+
+	CUTE_TEST_ASSERT(ecs_component_get_size(padded_id) == 64);
+	CUTE_TEST_ASSERT(ecs_component_get_size(ecs_component_id<test_component_simd_t>()) == sizeof(test_component_simd_t));
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Vector");
+	ecs_entity_add_component("test_component_position_t");
+	ecs_entity_add_component("test_component_simd_t");
+	ecs_entity_add_component("padded");
+	ecs_entity_end();
+
+	entity_t entities[600];
+	for (int i = 0; i < 300; ++i) entities[i] = entity_make("Vector");
+	CUTE_TEST_ASSERT(!entity_make_many("Vector", 300, entities + 300).is_error());
+
+	for (int i = 0; i < 600; ++i) {
+		CUTE_TEST_ASSERT(((uintptr_t)entity_get_component<test_component_simd_t>(entities[i]) & 31) == 0);
+		CUTE_TEST_ASSERT(((uintptr_t)entity_get_component(entities[i], padded_id) & 63) == 0);
+	}
+
+	app_destroy();
+
+	return 0;
+}
@@ -283,6 +283,49 @@ int test_kv_std_vector()
 	return 0;
 }
 
+CUTE_TEST_CASE(test_kv_many_objects, "Parsing many objects, each with fields written after a nested object.");
+int test_kv_many_objects()
+{
+	kv_t* kv = kv_make();
+	kv_write_mode(kv);
+
+	int count = 1000;
+	kv_array_begin(kv, &count, "objects");
+	for (int i = 0; i < count; ++i) {
+		kv_object_begin(kv);
+			kv_object_begin(kv, "nested");
+				kv_key(kv, "a"); kv_val(kv, &i);
+			kv_object_end(kv);
+			kv_key(kv, "b"); kv_val(kv, &i);
+		kv_object_end(kv);
+	}
+	kv_array_end(kv);
+
+	CUTE_TEST_ASSERT(!kv_error_state(kv).is_error());
+	size_t size = kv_size_written(kv);
+	CUTE_TEST_ASSERT(!kv_parse(kv, kv_get_buffer(kv), size).is_error());
+
+	kv_array_begin(kv, &count, "objects");
+	CUTE_TEST_ASSERT(count == 1000);
+	for (int i = 0; i < count; ++i) {
+		int a = -1, b = -1;
+		kv_object_begin(kv);
+			kv_object_begin(kv, "nested");
+				kv_key(kv, "a"); kv_val(kv, &a);
+			kv_object_end(kv);
+			kv_key(kv, "b"); kv_val(kv, &b);
+		kv_object_end(kv);
+		CUTE_TEST_ASSERT(a == i);
+		CUTE_TEST_ASSERT(b == i);
+	}
+	kv_array_end(kv);
+	CUTE_TEST_ASSERT(!kv_error_state(kv).is_error());
+
+	kv_destroy(kv);
+
+	return 0;
+}
+
 CUTE_TEST_CASE(test_kv_write_delta_basic, "Writing keys and values with base delta.");
 int test_kv_write_delta_basic()
 {
@@ -0,0 +1,213 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute_concurrency.h>
+using namespace cute;
+
+CUTE_TEST_CASE(test_mpmc_queue_basic, "Fill up and empty an MPMC queue, one at a time and in batches.");
+int test_mpmc_queue_basic()
+{
+	mpmc_queue_t* queue = mpmc_queue_create(6, sizeof(int));
+	CUTE_TEST_CHECK_POINTER(queue);
+
+	// Capacity rounds up to 8.
+	for (int i = 0; i < 8; ++i) {
+		CUTE_TEST_ASSERT(mpmc_queue_try_push(queue, &i));
+	}
+	int val = 8;
+	CUTE_TEST_ASSERT(!mpmc_queue_try_push(queue, &val));
+	for (int i = 0; i < 8; ++i) {
+		CUTE_TEST_ASSERT(mpmc_queue_try_pop(queue, &val));
+		CUTE_TEST_ASSERT(val == i);
+	}
+	CUTE_TEST_ASSERT(!mpmc_queue_try_pop(queue, &val));
+
+	// Batches wrap around the end of the queue, and stop once it's full or empty.
+	int in[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	int out[10] = { 0 };
+	for (int iters = 0; iters < 10; ++iters) {
+		CUTE_TEST_ASSERT(mpmc_queue_try_push_many(queue, in, 3) == 3);
+		CUTE_TEST_ASSERT(mpmc_queue_try_push_many(queue, in + 3, 7) == 5);
+		CUTE_TEST_ASSERT(mpmc_queue_try_pop_many(queue, out, 2) == 2);
+		CUTE_TEST_ASSERT(mpmc_queue_try_pop_many(queue, out + 2, 10) == 6);
+		for (int i = 0; i < 8; ++i) {
+			CUTE_TEST_ASSERT(out[i] == i);
+		}
+		CUTE_TEST_ASSERT(mpmc_queue_try_pop_many(queue, out, 10) == 0);
+		CUTE_TEST_ASSERT(mpmc_queue_try_push(queue, &val));
+		CUTE_TEST_ASSERT(mpmc_queue_try_pop(queue, &val));
+	}
+
+	mpmc_queue_destroy(queue);
+
+	return 0;
+}
+
+struct test_queue_threads_t
+{
+	mpmc_queue_t* queue;
+	spsc_ring_t* ring;
+	int producer_index;
+	atomic_int_t* popped;
+	atomic_int_t* sum;
+	atomic_int_t* errors;
+};
+
+#define TEST_QUEUE_VALUES_PER_PRODUCER 20000
+#define TEST_QUEUE_PRODUCER_COUNT 3
+
+int test_mpmc_queue_producer(void* udata)
+{
+	test_queue_threads_t* data = (test_queue_threads_t*)udata;
+	int batch[16];
+	int i = 0;
+	while (i < TEST_QUEUE_VALUES_PER_PRODUCER) {
+		// Alternate between single and batched pushes.
+		if (i & 1) {
+			int n = 0;
+			while (n < 16 && i + n < TEST_QUEUE_VALUES_PER_PRODUCER) {
+				batch[n] = (i + n) * TEST_QUEUE_PRODUCER_COUNT + data->producer_index;
+				++n;
+			}
+			i += mpmc_queue_try_push_many(data->queue, batch, n);
+		} else {
+			int val = i * TEST_QUEUE_PRODUCER_COUNT + data->producer_index;
+			if (mpmc_queue_try_push(data->queue, &val)) ++i;
+		}
+	}
+	return 0;
+}
+
+int test_mpmc_queue_consumer(void* udata)
+{
+	test_queue_threads_t* data = (test_queue_threads_t*)udata;
+	int total = TEST_QUEUE_VALUES_PER_PRODUCER * TEST_QUEUE_PRODUCER_COUNT;
+	int last_seen[TEST_QUEUE_PRODUCER_COUNT] = { -1, -1, -1 };
+	int batch[8];
+	while (atomic_get(data->popped) < total) {
+		int n = mpmc_queue_try_pop_many(data->queue, batch, 8);
+		for (int i = 0; i < n; ++i) {
+			// Values from a single producer must come out in the order they went in.
+			int producer = batch[i] % TEST_QUEUE_PRODUCER_COUNT;
+			int index = batch[i] / TEST_QUEUE_PRODUCER_COUNT;
+			if (index <= last_seen[producer]) atomic_add(data->errors, 1);
+			last_seen[producer] = index;
+			atomic_add(data->sum, batch[i] & 0xFF);
+		}
+		atomic_add(data->popped, n);
+	}
+	return 0;
+}
+
+CUTE_TEST_CASE(test_mpmc_queue_threads, "Run several producer and consumer threads on one MPMC queue, and make sure every value arrives once.");
+int test_mpmc_queue_threads()
+{
+	mpmc_queue_t* queue = mpmc_queue_create(64, sizeof(int));
+	CUTE_TEST_CHECK_POINTER(queue);
+
+	atomic_int_t popped = atomic_zero();
+	atomic_int_t sum = atomic_zero();
+	atomic_int_t errors = atomic_zero();
+	test_queue_threads_t data[TEST_QUEUE_PRODUCER_COUNT];
+	thread_t* producers[TEST_QUEUE_PRODUCER_COUNT];
+	thread_t* consumers[TEST_QUEUE_PRODUCER_COUNT];
+	for (int i = 0; i < TEST_QUEUE_PRODUCER_COUNT; ++i) {
+		data[i].queue = queue;
+		data[i].ring = NULL;
+		data[i].producer_index = i;
+		data[i].popped = &popped;
+		data[i].sum = &sum;
+		data[i].errors = &errors;
+		producers[i] = thread_create(test_mpmc_queue_producer, "producer", data + i);
+		consumers[i] = thread_create(test_mpmc_queue_consumer, "consumer", data + i);
+	}
+	for (int i = 0; i < TEST_QUEUE_PRODUCER_COUNT; ++i) {
+		CUTE_TEST_ASSERT(!thread_wait(producers[i]).is_error());
+		CUTE_TEST_ASSERT(!thread_wait(consumers[i]).is_error());
+	}
+
+	int expected_sum = 0;
+	for (int i = 0; i < TEST_QUEUE_VALUES_PER_PRODUCER * TEST_QUEUE_PRODUCER_COUNT; ++i) {
+		expected_sum += i & 0xFF;
+	}
+	CUTE_TEST_ASSERT(atomic_get(&popped) == TEST_QUEUE_VALUES_PER_PRODUCER * TEST_QUEUE_PRODUCER_COUNT);
+	CUTE_TEST_ASSERT(atomic_get(&sum) == expected_sum);
+	CUTE_TEST_ASSERT(atomic_get(&errors) == 0);
+
+	mpmc_queue_destroy(queue);
+
+	return 0;
+}
+
+int test_spsc_ring_producer(void* udata)
+{
+	test_queue_threads_t* data = (test_queue_threads_t*)udata;
+	int batch[13];
+	int i = 0;
+	while (i < TEST_QUEUE_VALUES_PER_PRODUCER) {
+		int n = 0;
+		while (n < 13 && i + n < TEST_QUEUE_VALUES_PER_PRODUCER) {
+			batch[n] = i + n;
+			++n;
+		}
+		i += spsc_ring_try_push_many(data->ring, batch, n);
+	}
+	return 0;
+}
+
+CUTE_TEST_CASE(test_spsc_ring, "Fill up and empty an SPSC ring, then stream values through it from another thread.");
+int test_spsc_ring()
+{
+	spsc_ring_t* ring = spsc_ring_create(16, sizeof(int));
+	CUTE_TEST_CHECK_POINTER(ring);
+
+	int val;
+	for (int i = 0; i < 16; ++i) {
+		CUTE_TEST_ASSERT(spsc_ring_try_push(ring, &i));
+	}
+	CUTE_TEST_ASSERT(!spsc_ring_try_push(ring, &val));
+	for (int i = 0; i < 16; ++i) {
+		CUTE_TEST_ASSERT(spsc_ring_try_pop(ring, &val));
+		CUTE_TEST_ASSERT(val == i);
+	}
+	CUTE_TEST_ASSERT(!spsc_ring_try_pop(ring, &val));
+
+	test_queue_threads_t data;
+	data.queue = NULL;
+	data.ring = ring;
+	thread_t* producer = thread_create(test_spsc_ring_producer, "producer", &data);
+
+	int expected = 0;
+	int batch[7];
+	while (expected < TEST_QUEUE_VALUES_PER_PRODUCER) {
+		int n = spsc_ring_try_pop_many(ring, batch, 7);
+		for (int i = 0; i < n; ++i) {
+			CUTE_TEST_ASSERT(batch[i] == expected);
+			++expected;
+		}
+	}
+	CUTE_TEST_ASSERT(!thread_wait(producer).is_error());
+	CUTE_TEST_ASSERT(!spsc_ring_try_pop(ring, &val));
+
+	spsc_ring_destroy(ring);
+
+	return 0;
+}
@@ -0,0 +1,480 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute_concurrency.h>
+using namespace cute;
+
+struct test_threadpool_counter_t
+{
+	threadpool_t* pool;
+	atomic_int_t count;
+	atomic_int_t children;
+};
+
+void test_threadpool_increment_task(void* param)
+{
+	test_threadpool_counter_t* counter = (test_threadpool_counter_t*)param;
+	atomic_add(&counter->count, 1);
+}
+
+void test_threadpool_spawn_task(void* param)
+{
+	test_threadpool_counter_t* counter = (test_threadpool_counter_t*)param;
+	for (int i = 0; i < 8; ++i) {
+		atomic_add(&counter->children, 1);
+		threadpool_add_task(counter->pool, test_threadpool_increment_task, counter);
+	}
+}
+
+void test_threadpool_spawn_and_wait_task(void* param)
+{
+	// Waiting from within a task must not wait on the task itself, or on other tasks doing the same.
+	test_threadpool_counter_t* counter = (test_threadpool_counter_t*)param;
+	test_threadpool_counter_t own;
+	own.pool = counter->pool;
+	own.count = atomic_zero();
+	for (int i = 0; i < 8; ++i) {
+		threadpool_add_task(counter->pool, test_threadpool_increment_task, &own);
+	}
+	threadpool_kick_and_wait(counter->pool);
+	if (atomic_get(&own.count) == 8) atomic_add(&counter->count, 1);
+}
+
+CUTE_TEST_CASE(test_threadpool_many_tasks, "Run many small tasks for several frames, and make sure each one ran exactly once.");
+int test_threadpool_many_tasks()
+{
+	threadpool_t* pool = threadpool_create(4);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	test_threadpool_counter_t counter;
+	counter.pool = pool;
+	counter.count = atomic_zero();
+	counter.children = atomic_zero();
+
+	for (int frame = 0; frame < 20; ++frame) {
+		atomic_set(&counter.count, 0);
+		for (int i = 0; i < 5000; ++i) {
+			threadpool_add_task(pool, test_threadpool_increment_task, &counter);
+		}
+		threadpool_kick_and_wait(pool);
+		CUTE_TEST_ASSERT(atomic_get(&counter.count) == 5000);
+	}
+
+	threadpool_destroy(pool);
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_threadpool_nested_tasks, "Tasks add more tasks from worker threads, and kick and wait waits on all of them, even from within tasks.");
+int test_threadpool_nested_tasks()
+{
+	threadpool_t* pool = threadpool_create(4);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	test_threadpool_counter_t counter;
+	counter.pool = pool;
+	counter.count = atomic_zero();
+	counter.children = atomic_zero();
+
+	for (int frame = 0; frame < 20; ++frame) {
+		atomic_set(&counter.count, 0);
+		atomic_set(&counter.children, 0);
+		for (int i = 0; i < 500; ++i) {
+			threadpool_add_task(pool, test_threadpool_spawn_task, &counter);
+		}
+		threadpool_kick_and_wait(pool);
+		CUTE_TEST_ASSERT(atomic_get(&counter.children) == 500 * 8);
+		CUTE_TEST_ASSERT(atomic_get(&counter.count) == 500 * 8);
+	}
+
+	for (int frame = 0; frame < 20; ++frame) {
+		atomic_set(&counter.count, 0);
+		for (int i = 0; i < 100; ++i) {
+			threadpool_add_task(pool, test_threadpool_spawn_and_wait_task, &counter);
+		}
+		threadpool_kick_and_wait(pool);
+		CUTE_TEST_ASSERT(atomic_get(&counter.count) == 100);
+	}
+
+	threadpool_destroy(pool);
+
+	return 0;
+}
+
+struct test_threadpool_stage_t
+{
+	atomic_int_t* stage;
+	atomic_int_t* errors;
+	int expected_stage;
+};
+
+void test_threadpool_stage_task(void* param)
+{
+	test_threadpool_stage_t* stage = (test_threadpool_stage_t*)param;
+	if (atomic_get(stage->stage) != stage->expected_stage) atomic_add(stage->errors, 1);
+}
+
+void test_threadpool_advance_task(void* param)
+{
+	test_threadpool_stage_t* stage = (test_threadpool_stage_t*)param;
+	if (atomic_get(stage->stage) != stage->expected_stage) atomic_add(stage->errors, 1);
+	atomic_add(stage->stage, 1);
+}
+
+CUTE_TEST_CASE(test_threadpool_counters, "Chain groups of tasks with counters and continuations, and wait on a single counter.");
+int test_threadpool_counters()
+{
+	threadpool_t* pool = threadpool_create(4);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	for (int frame = 0; frame < 20; ++frame) {
+		// Four groups of 100 tasks each, where every group only starts once the previous group and a
+		// single "advance" task in between have finished. Every task checks it runs in the right stage.
+		atomic_int_t stage = atomic_zero();
+		atomic_int_t errors = atomic_zero();
+		test_threadpool_stage_t stages[8];
+		task_counter_t counters[8] = { };
+		for (int i = 0; i < 8; ++i) {
+			stages[i].stage = &stage;
+			stages[i].errors = &errors;
+			stages[i].expected_stage = i / 2;
+		}
+
+		for (int i = 0; i < 100; ++i) {
+			threadpool_add_task(pool, test_threadpool_stage_task, stages + 0, counters + 0);
+		}
+		for (int i = 1; i < 8; ++i) {
+			if (i & 1) {
+				threadpool_add_continuation(pool, counters + i - 1, test_threadpool_advance_task, stages + i, counters + i);
+			} else {
+				for (int j = 0; j < 100; ++j) {
+					threadpool_add_continuation(pool, counters + i - 1, test_threadpool_stage_task, stages + i, counters + i);
+				}
+			}
+		}
+
+		// Waiting on the last counter waits on the whole chain.
+		threadpool_wait_counter(pool, counters + 7);
+		CUTE_TEST_ASSERT(atomic_get(&stage) == 4);
+		CUTE_TEST_ASSERT(atomic_get(&errors) == 0);
+		for (int i = 0; i < 8; ++i) {
+			CUTE_TEST_ASSERT(atomic_get(&counters[i].count) == 0);
+		}
+
+		// Continuations on a finished counter start right away.
+		atomic_set(&stage, 0);
+		threadpool_add_continuation(pool, counters + 0, test_threadpool_advance_task, stages + 0, counters + 1);
+		threadpool_wait_counter(pool, counters + 1);
+		CUTE_TEST_ASSERT(atomic_get(&stage) == 1);
+		CUTE_TEST_ASSERT(atomic_get(&errors) == 0);
+	}
+
+	threadpool_destroy(pool);
+
+	return 0;
+}
+
+struct test_threadpool_race_t
+{
+	test_threadpool_counter_t* counter;
+	task_counter_t* dependency;
+	task_counter_t* done;
+	atomic_int_t started;
+	atomic_int_t added;
+};
+
+void test_threadpool_finish_dependency_task(void* param)
+{
+	// Only finish once continuations are being added.
+	test_threadpool_race_t* race = (test_threadpool_race_t*)param;
+	while (!atomic_get(&race->started)) { }
+	atomic_add(&race->counter->count, 1);
+}
+
+void test_threadpool_add_continuations_task(void* param)
+{
+	// Keep adding continuations until the dependency finishes, so some are added right as it does.
+	test_threadpool_race_t* race = (test_threadpool_race_t*)param;
+	atomic_add(&race->started, 1);
+	for (int i = 0; i < 10000 && atomic_get(&race->dependency->count); ++i) {
+		threadpool_add_continuation(race->counter->pool, race->dependency, test_threadpool_increment_task, race->counter, race->done);
+		atomic_add(&race->added, 1);
+	}
+}
+
+CUTE_TEST_CASE(test_threadpool_continuation_race, "Add continuations while the dependency's last task is finishing, and make sure none are lost.");
+int test_threadpool_continuation_race()
+{
+	threadpool_t* pool = threadpool_create(4);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	test_threadpool_counter_t counter;
+	counter.pool = pool;
+	counter.count = atomic_zero();
+	counter.children = atomic_zero();
+
+	for (int i = 0; i < 200; ++i) {
+		// A lost continuation would never decrement `done`, so waiting on it would hang.
+		task_counter_t dependency = { };
+		task_counter_t adders = { };
+		task_counter_t done = { };
+		test_threadpool_race_t race;
+		race.counter = &counter;
+		race.dependency = &dependency;
+		race.done = &done;
+		race.started = atomic_zero();
+		race.added = atomic_zero();
+		atomic_set(&counter.count, 0);
+		threadpool_add_task(pool, test_threadpool_finish_dependency_task, &race, &dependency);
+		for (int j = 0; j < 3; ++j) {
+			threadpool_add_task(pool, test_threadpool_add_continuations_task, &race, &adders);
+		}
+		threadpool_wait_counter(pool, &adders);
+		threadpool_wait_counter(pool, &done);
+		CUTE_TEST_ASSERT(atomic_get(&counter.count) == 1 + atomic_get(&race.added));
+		CUTE_TEST_ASSERT(atomic_get(&dependency.count) == 0);
+	}
+
+	threadpool_destroy(pool);
+
+	return 0;
+}
+
+void test_parallel_for_fn(int begin, int end, void* udata)
+{
+	int* values = (int*)udata;
+	for (int i = begin; i < end; ++i) {
+		values[i] += i;
+	}
+}
+
+void test_parallel_reduce_fn(int begin, int end, void* partial, void* udata)
+{
+	int* values = (int*)udata;
+	uint64_t* sum = (uint64_t*)partial;
+	for (int i = begin; i < end; ++i) {
+		*sum += (uint64_t)values[i];
+	}
+}
+
+void test_parallel_combine_fn(void* result, const void* partial, void* udata)
+{
+	*(uint64_t*)result += *(const uint64_t*)partial;
+}
+
+CUTE_TEST_CASE(test_parallel_for_and_reduce, "Run parallel for and parallel reduce over ranges with different grain sizes.");
+int test_parallel_for_and_reduce()
+{
+	threadpool_t* pool = threadpool_create(4);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	const int count = 100000;
+	int* values = (int*)CUTE_ALLOC(sizeof(int) * count, NULL);
+	int grains[] = { 0, 1, 7, 1000, count, count * 2 };
+	threadpool_t* pools[] = { pool, NULL };
+
+	for (int p = 0; p < 2; ++p) {
+		for (int g = 0; g < (int)(sizeof(grains) / sizeof(*grains)); ++g) {
+			CUTE_MEMSET(values, 0, sizeof(int) * count);
+			parallel_for(pools[p], 0, count, grains[g], test_parallel_for_fn, values);
+			for (int i = 0; i < count; ++i) {
+				CUTE_TEST_ASSERT(values[i] == i);
+			}
+
+			uint64_t sum = 0;
+			parallel_reduce(pools[p], 0, count, grains[g], &sum, sizeof(sum), test_parallel_reduce_fn, test_parallel_combine_fn, values);
+			CUTE_TEST_ASSERT(sum == (uint64_t)count * (count - 1) / 2);
+
+			// Only part of the range.
+			sum = 0;
+			parallel_reduce(pools[p], 100, 200, grains[g], &sum, sizeof(sum), test_parallel_reduce_fn, test_parallel_combine_fn, values);
+			CUTE_TEST_ASSERT(sum == (uint64_t)(100 + 199) * 100 / 2);
+		}
+	}
+
+	// Empty ranges do nothing.
+	parallel_for(pool, 5, 5, 0, test_parallel_for_fn, values);
+	uint64_t sum = 3;
+	parallel_reduce(pool, 5, 2, 0, &sum, sizeof(sum), test_parallel_reduce_fn, test_parallel_combine_fn, values);
+	CUTE_TEST_ASSERT(sum == 3);
+
+	CUTE_FREE(values, NULL);
+	threadpool_destroy(pool);
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_atomic_cas, "Compare and swap reports whether the swap happened.");
+int test_atomic_cas()
+{
+	atomic_int_t atomic = atomic_zero();
+	CUTE_TEST_ASSERT(!atomic_cas(&atomic, 0, 5).is_error());
+	CUTE_TEST_ASSERT(atomic_get(&atomic) == 5);
+	CUTE_TEST_ASSERT(atomic_cas(&atomic, 0, 7).is_error());
+	CUTE_TEST_ASSERT(atomic_get(&atomic) == 5);
+
+	int a, b;
+	void* ptr = &a;
+	CUTE_TEST_ASSERT(!atomic_ptr_cas(&ptr, &a, &b).is_error());
+	CUTE_TEST_ASSERT(ptr == &b);
+	CUTE_TEST_ASSERT(atomic_ptr_cas(&ptr, &a, &a).is_error());
+	CUTE_TEST_ASSERT(ptr == &b);
+
+	return 0;
+}
+
+struct test_completion_t
+{
+	completion_queue_t* queue;
+	thread_id_t main_thread;
+	atomic_int_t invoked;
+	int called;
+	int wrong_thread;
+	int last_value;
+	int out_of_order;
+};
+
+void test_completion_callback(error_t status, void* param, void* promise_udata)
+{
+	test_completion_t* data = (test_completion_t*)promise_udata;
+	if (thread_id() != data->main_thread) data->wrong_thread++;
+	int value = (int)(size_t)param;
+	if (value != data->last_value + 1) data->out_of_order++;
+	data->last_value = value;
+	data->called++;
+}
+
+void test_completion_task(void* param)
+{
+	test_completion_t* data = (test_completion_t*)param;
+	promise_t promise(test_completion_callback, data, data->queue);
+	promise.invoke(error_success(), (void*)(size_t)(atomic_add(&data->invoked, 1) + 1));
+}
+
+CUTE_TEST_CASE(test_completion_queue, "Invoke promises on worker threads, and make sure the callbacks only run once drained on the main thread.");
+int test_completion_queue()
+{
+	threadpool_t* pool = threadpool_create(4);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	test_completion_t data;
+	data.queue = completion_queue_create();
+	data.main_thread = thread_id();
+	data.invoked = atomic_zero();
+	data.called = 0;
+	data.wrong_thread = 0;
+	data.last_value = 0;
+	data.out_of_order = 0;
+
+	for (int frame = 0; frame < 10; ++frame) {
+		for (int i = 0; i < 1000; ++i) {
+			threadpool_add_task(pool, test_completion_task, &data);
+		}
+		threadpool_kick(pool);
+
+		// Drain while the workers are still posting, like a game loop would.
+		while (data.called < (frame + 1) * 1000) {
+			completion_queue_drain(data.queue);
+		}
+		threadpool_kick_and_wait(pool);
+		CUTE_TEST_ASSERT(completion_queue_drain(data.queue) == 0);
+	}
+
+	// Values are handed out in the order promises were invoked, but invoking and posting aren't
+	// atomic together, so only check ordering when a single thread posts.
+	data.last_value = 0;
+	data.out_of_order = 0;
+	for (int i = 1; i <= 100; ++i) {
+		completion_queue_post(data.queue, test_completion_callback, &data, error_success(), (void*)(size_t)i);
+	}
+	CUTE_TEST_ASSERT(completion_queue_drain(data.queue) == 100);
+
+	CUTE_TEST_ASSERT(data.called == 10 * 1000 + 100);
+	CUTE_TEST_ASSERT(data.wrong_thread == 0);
+	CUTE_TEST_ASSERT(data.out_of_order == 0);
+
+	// Promises without a queue still call back right away.
+	promise_t direct(test_completion_callback, &data);
+	direct.invoke(error_success(), (void*)(size_t)101);
+	CUTE_TEST_ASSERT(data.called == 10 * 1000 + 101);
+
+	completion_queue_destroy(data.queue);
+	threadpool_destroy(pool);
+
+	return 0;
+}
+
+void test_threadpool_busy_task(void* param)
+{
+	test_threadpool_counter_t* counter = (test_threadpool_counter_t*)param;
+	int x = 0;
+	for (int i = 0; i < 1000; ++i) x += i * i;
+	atomic_add(&counter->count, x ? 1 : 0);
+}
+
+CUTE_TEST_CASE(test_threadpool_stats, "Run tasks on named and pinned workers, and check the per-worker statistics add up.");
+int test_threadpool_stats()
+{
+	threadpool_options_t options = { };
+	options.thread_name = "test_worker";
+	options.pin_to_cores = 1;
+	options.first_core = 1;
+	threadpool_t* pool = threadpool_create(4, options);
+	CUTE_TEST_CHECK_POINTER(pool);
+
+	test_threadpool_counter_t counter;
+	counter.pool = pool;
+	counter.count = atomic_zero();
+	counter.children = atomic_zero();
+
+	for (int frame = 0; frame < 10; ++frame) {
+		for (int i = 0; i < 1000; ++i) {
+			threadpool_add_task(pool, test_threadpool_busy_task, &counter);
+		}
+		threadpool_kick_and_wait(pool);
+	}
+	CUTE_TEST_ASSERT(atomic_get(&counter.count) == 10 * 1000);
+
+	// Every task is counted exactly once, either on a worker or on the helping thread.
+	int tasks_run = 0;
+	for (int i = 0; i <= threadpool_thread_count(pool); ++i) {
+		worker_stats_t stats = threadpool_get_stats(pool, i);
+		CUTE_TEST_ASSERT(stats.tasks_run >= 0);
+		CUTE_TEST_ASSERT(stats.steals >= 0 && stats.steals <= stats.tasks_run);
+		CUTE_TEST_ASSERT(stats.busy_seconds >= 0 && stats.idle_seconds >= 0);
+		tasks_run += stats.tasks_run;
+	}
+	CUTE_TEST_ASSERT(tasks_run == 10 * 1000);
+
+	threadpool_reset_stats(pool);
+	for (int i = 0; i <= threadpool_thread_count(pool); ++i) {
+		worker_stats_t stats = threadpool_get_stats(pool, i);
+		CUTE_TEST_ASSERT(stats.tasks_run == 0);
+		CUTE_TEST_ASSERT(stats.steals == 0);
+	}
+
+	threadpool_destroy(pool);
+
+	// Cores that don't exist are rejected.
+	CUTE_TEST_ASSERT(thread_set_affinity(-1).is_error());
+
+	return 0;
+}